@@ -105,6 +105,20 @@ LoopFillZerobss:
   cmp r2, r3
   bcc FillZerobss
 
+/* Paint the stack so we can tell later how much of it was used. The pattern
+   must match STACK_PAINT in 88mph/system/stack.h */
+  ldr r2, =_sstack
+  ldr r3, =0xA5A5A5A5
+  mov r1, sp
+  b LoopPaintStack
+
+PaintStack:
+  str r3, [r2], #4
+
+LoopPaintStack:
+  cmp r2, r1
+  bcc PaintStack
+
 /* Call the clock system intitialization function.*/
     bl  SystemInit
 /* Call static constructors */
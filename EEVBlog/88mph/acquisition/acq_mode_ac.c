@@ -0,0 +1,203 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/acq_mode_ac.h"
+
+#include "acquisition/acq_modes.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "system/timer.h"
+#include "system/clock.h"
+#include "hardware/hy3131.h"
+
+// registers for volts ac
+// first dimension is submode, second is register
+// for now, these are the DCV settings, which at least get the range dividers
+// right. the AC coupling and RMS setup haven't been captured from the stock
+// firmware yet, so until then the RMS value won't be right
+
+static const uint8_t volts_ac_regs[4][20] = {
+    // ACV 5.0000V
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    // ACV 50.000V
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,   9,0x28,0xA0,0x80,0xC7,   8,0x2C},
+    // ACV 500.00V
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,0x90,   0,0x28,0xA0,0x80,0xC7,   8,0x2C},
+    // ACV 1000.0V (600.0V)
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   9,   0,0x28,0xA0,0x80,0xC7,   8,0x2C}
+};
+
+// registers for amps ac
+// these are placeholders too. the shunt selection is done by
+// the input jacks, so the HY settings just need the right gain
+static const uint8_t amps_ac_regs[3][20] = {
+    // ACA 5000.0uA
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    // ACA 500.00mA
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    // ACA 10.000A
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20}
+};
+
+static const rdg_exponent_t amps_ac_exponents[3] = {
+    RDG_EXPONENT_MICRO, RDG_EXPONENT_MILLI, RDG_EXPONENT_NONE
+};
+
+static const rdg_decimal_t amps_ac_decimals[3] = {
+    RDG_DECIMAL_1000d0, RDG_DECIMAL_100d00, RDG_DECIMAL_10d000
+};
+
+// calibrate the mean square into square millicounts
+// DC is approximately (counts*100)/6, so this is that squared. the mean
+// square is 40 bits and 2500 is under 12, so it fits easily. the root is
+// left for the measurement mode, which only needs one per displayed reading
+static HOT_FUNC uint64_t rms_mean_square(int64_t mean_square) {
+    return ((uint64_t)mean_square*2500)/9;
+}
+
+// the modes only differ in their tables and units, so they share this
+static HOT_FUNC void ac_handle_event(acq_event_t event, int64_t value,
+        const uint8_t (*regs)[20], acq_submode_t* submode) {
+    switch (event) {
+        case ACQ_EVENT_START:
+        case ACQ_EVENT_SET_SUBMODE: {
+            // starting and setting submodes is the same
+            // clear acquisitions that aren't for this mode
+            acq_clear_readings();
+            // program new register set into the HY3131
+            *submode = (acq_submode_t)value;
+            hy_write_regs(0x20, 20, &regs[*submode][0]);
+            // the RMS interrupt is the only one we care about
+            acq_set_int_mask(HY_REG_INT_RMS);
+            break;
+        }
+
+        case ACQ_EVENT_STOP: {
+            acq_set_int_mask(0x00);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
+
+HOT_FUNC void acq_mode_func_volts_ac(acq_event_t event, int64_t value) {
+    static acq_submode_t submode = 0;
+
+    if (event == ACQ_EVENT_NEW_RMS) {
+        reading_t reading = {
+            0, // millicounts, rooted by the measurement mode
+            timer_1ms_ticks, // time_ms
+            acq_get_irq_time_us(), // time_us
+            RDG_UNIT_VOLTS, // unit
+            RDG_EXPONENT_NONE, // exponent
+            // the ranges line up with the decimal points just like DC
+            submode, // decimal point
+            RDG_KIND_MAIN, // kind
+            rms_mean_square(value) // mean_square
+        };
+        acq_put_reading(&reading);
+    } else {
+        ac_handle_event(event, value, volts_ac_regs, &submode);
+    }
+}
+
+HOT_FUNC void acq_mode_func_amps_ac(acq_event_t event, int64_t value) {
+    static acq_submode_t submode = 0;
+
+    if (event == ACQ_EVENT_NEW_RMS) {
+        reading_t reading = {
+            0, // millicounts, rooted by the measurement mode
+            timer_1ms_ticks, // time_ms
+            acq_get_irq_time_us(), // time_us
+            RDG_UNIT_AMPS, // unit
+            amps_ac_exponents[submode], // exponent
+            amps_ac_decimals[submode], // decimal point
+            RDG_KIND_MAIN, // kind
+            rms_mean_square(value) // mean_square
+        };
+        acq_put_reading(&reading);
+    } else {
+        ac_handle_event(event, value, amps_ac_regs, &submode);
+    }
+}
+
+HOT_FUNC void acq_mode_func_volts_dual(acq_event_t event, int64_t value) {
+    static acq_submode_t submode = 0;
+
+    reading_t reading = {
+        0, // millicounts
+        timer_1ms_ticks, // time_ms
+        acq_get_irq_time_us(), // time_us
+        RDG_UNIT_VOLTS, // unit
+        RDG_EXPONENT_NONE, // exponent
+        submode, // decimal point
+        RDG_KIND_MAIN, // kind
+        0 // mean_square
+    };
+
+    switch (event) {
+        case ACQ_EVENT_START:
+        case ACQ_EVENT_SET_SUBMODE: {
+            acq_clear_readings();
+            submode = (acq_submode_t)value;
+            hy_write_regs(0x20, 20, &volts_ac_regs[submode][0]);
+            // the same front end pass gives us both
+            acq_set_int_mask(HY_REG_INT_AD1 | HY_REG_INT_RMS);
+            break;
+        }
+
+        case ACQ_EVENT_NEW_AD1: {
+            // dc on the main screen. this assumes the ac setup leaves AD1
+            // scaled like volts dc, which can't be checked until the ac
+            // registers are captured
+            reading.millicounts = ((int32_t)value*100)/6;
+            acq_put_reading(&reading);
+            break;
+        }
+
+        case ACQ_EVENT_NEW_RMS: {
+            // ac on the sub screen
+            reading.mean_square = rms_mean_square(value);
+            reading.kind = RDG_KIND_SUB;
+            acq_put_reading(&reading);
+            break;
+        }
+
+        case ACQ_EVENT_STOP: {
+            acq_set_int_mask(0x00);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef ACQUISITION_ACQ_MODE_AC_H
+#define ACQUISITION_ACQ_MODE_AC_H
+
+#include <stdint.h>
+
+#include "acquisition/acq_modes.h"
+
+// this file defines the acquisition mode funcs for the true RMS AC modes
+// the HY3131 squares and averages the samples itself, so all we get is the
+// mean square once per RMS computation
+
+void acq_mode_func_volts_ac(acq_event_t event, int64_t value);
+void acq_mode_func_amps_ac(acq_event_t event, int64_t value);
+// dc volts from AD1 and ac volts from the RMS channel at the same time
+void acq_mode_func_volts_dual(acq_event_t event, int64_t value);
+
+#endif
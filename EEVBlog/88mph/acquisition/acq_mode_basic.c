@@ -25,6 +25,7 @@
 #include "acquisition/acquisition.h"
 #include "acquisition/reading.h"
 #include "system/timer.h"
+#include "system/clock.h"
 #include "hardware/hy3131.h"
 
 // registers for volts dc
@@ -45,7 +46,7 @@ static const uint8_t volts_dc_regs[4][20] = {
      0x22,   0,   9,   0,0x28,0xA0,0x80,0xC7,   8,0x2C}
 };
 
-void acq_mode_func_volts_dc(acq_event_t event, int64_t value) {
+HOT_FUNC void acq_mode_func_volts_dc(acq_event_t event, int64_t value) {
     static acq_submode_t submode = 0;
 
     switch (event) {
@@ -71,11 +72,13 @@ void acq_mode_func_volts_dc(acq_event_t event, int64_t value) {
                 // approximately calibrate by dividing by 60
                 (ad1*100)/6, // millicounts
                 timer_1ms_ticks, // time_ms
+                acq_get_irq_time_us(), // time_us
                 RDG_UNIT_VOLTS, // unit
                 RDG_EXPONENT_NONE, // exponent
                 // conveniently, decimal point loc is the same as the submode
                 submode, // decimal point
-                RDG_KIND_MAIN // kind
+                RDG_KIND_MAIN, // kind
+                0 // mean_square
             };
 
             // tell the new reading to the measurement engine
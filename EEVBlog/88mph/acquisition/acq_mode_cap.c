@@ -0,0 +1,147 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/acq_mode_cap.h"
+
+#include "acquisition/acq_modes.h"
+#include "acquisition/acq_mode_freq.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "system/timer.h"
+#include "hardware/hy3131.h"
+
+// registers for each charge current, smallest first
+// the capacitance settings haven't been captured from the stock firmware
+// yet, so these are all the DCV 5V settings until then
+static const uint8_t cap_regs[CAP_NUM_RANGES][20] = {
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20}
+};
+
+// picofarads per second of cycle time with each current. that's the
+// current over the voltage swing. these are nominal until they can be
+// calibrated, and take a 20ms cycle to 20nF, 200nF, 2uF, 20uF and 200uF
+static const uint64_t cap_pf_per_s[CAP_NUM_RANGES] = {
+    1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL
+};
+
+// formats in picofarads, so the conversion doesn't need big powers of 10
+static const freq_format_t cap_formats[] = {
+    {RDG_EXPONENT_NANO, RDG_DECIMAL_10d000, 0}, // 99.999nF
+    {RDG_EXPONENT_NANO, RDG_DECIMAL_100d00, 1}, // 999.99nF
+    {RDG_EXPONENT_MICRO, RDG_DECIMAL_1d0000, 2}, // 9.9999uF
+    {RDG_EXPONENT_MICRO, RDG_DECIMAL_10d000, 3}, // 99.999uF
+    {RDG_EXPONENT_MICRO, RDG_DECIMAL_100d00, 4}, // 999.99uF
+    {RDG_EXPONENT_MILLI, RDG_DECIMAL_1d0000, 5}, // 9.9999mF
+    {RDG_EXPONENT_MILLI, RDG_DECIMAL_10d000, 6}, // 99.999mF
+};
+
+#define MIN_GATE_COUNTS ((uint64_t)FREQ_REF_HZ*CAP_MIN_GATE_MS/1000)
+#define RANGE_DOWN_COUNTS ((uint64_t)FREQ_REF_HZ*CAP_RANGE_DOWN_US/1000000)
+#define RANGE_UP_COUNTS ((uint64_t)FREQ_REF_HZ*CAP_RANGE_UP_MS/1000)
+
+// the current range survives switching modes, so measuring the same
+// capacitor again doesn't start over from the smallest current
+static uint8_t range = 0;
+// the counts since the last reading
+static uint64_t cycles = 0, counts = 0;
+// when the current range started waiting for a cycle
+static uint32_t wait_start_ms = 0;
+
+// switch to a charge current and start counting from scratch
+// writing the registers restarts the counter, so the cycle that was going
+// on with the old current doesn't get mixed in
+static void set_range(uint8_t r) {
+    range = r;
+    hy_write_regs(0x20, 20, &cap_regs[range][0]);
+    cycles = 0;
+    counts = 0;
+    wait_start_ms = timer_1ms_ticks;
+}
+
+void acq_mode_func_cap(acq_event_t event, int64_t value) {
+    switch (event) {
+        case ACQ_EVENT_START:
+        case ACQ_EVENT_SET_SUBMODE: {
+            // there's only the one submode. the range is picked here
+            acq_clear_readings();
+            set_range(range);
+            acq_set_int_mask(HY_REG_INT_CT);
+            break;
+        }
+
+        case ACQ_EVENT_NEW_CT: {
+            const acq_ct_t* ct = (const acq_ct_t*)(uint32_t)value;
+            cycles += ct->cta;
+            counts += ct->ctb;
+            if (cycles == 0) {
+                // still waiting for the first cycle. if it's taking too
+                // long, the capacitor is too big for this current, so
+                // there's no point waiting for it to finish
+                if (range < CAP_NUM_RANGES-1 &&
+                        timer_1ms_ticks - wait_start_ms >= CAP_RANGE_UP_MS) {
+                    set_range(range+1);
+                }
+                break;
+            }
+            // a big capacitor's cycle is long enough by itself, so it's
+            // shown as soon as it finishes. small ones get averaged over
+            // however many fit in the minimum gate
+            if (counts < MIN_GATE_COUNTS) {
+                break;
+            }
+
+            // C = (counts/ref)/cycles * pF/s
+            freq_put_ratio(counts*cap_pf_per_s[range], cycles*FREQ_REF_HZ,
+                RDG_UNIT_FARADS, cap_formats, NUM_FORMATS(cap_formats));
+
+            // and see if the next one would be better with another current
+            if (range > 0 && counts < cycles*RANGE_DOWN_COUNTS) {
+                set_range(range-1);
+            } else if (range < CAP_NUM_RANGES-1 &&
+                    counts > cycles*RANGE_UP_COUNTS) {
+                set_range(range+1);
+            } else {
+                cycles = 0;
+                counts = 0;
+                wait_start_ms = timer_1ms_ticks;
+            }
+            break;
+        }
+
+        case ACQ_EVENT_STOP: {
+            acq_set_int_mask(0x00);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef ACQUISITION_ACQ_MODE_CAP_H
+#define ACQUISITION_ACQ_MODE_CAP_H
+
+#include <stdint.h>
+
+#include "acquisition/acq_modes.h"
+
+// this file defines the acquisition mode func for capacitance
+// the HY charges and discharges the capacitor with a constant current and
+// the counter times the cycles against its reference clock, just like a
+// period. the capacitance is the cycle time times the current over the
+// voltage swing. the current is picked so a cycle takes a sensible time
+
+// how many charge currents there are to pick from
+#define CAP_NUM_RANGES (5)
+// small capacitors cycle very quickly, so a reading is made from every cycle
+// in at least this long. that's plenty of reference counts for 5 digits
+#define CAP_MIN_GATE_MS (50)
+// a cycle shorter than this goes to the next smaller current, so there's
+// enough counts in each cycle
+#define CAP_RANGE_DOWN_US (2000)
+// a cycle longer than this goes to the next larger current. it doesn't wait
+// for the cycle to finish, so a big capacitor only costs this long per range
+// on the way up. the currents are 10x apart, so a cycle that was just
+// outside one of these limits ends up 10x inside the other
+#define CAP_RANGE_UP_MS (200)
+
+void acq_mode_func_cap(acq_event_t event, int64_t value);
+
+#endif
\ No newline at end of file
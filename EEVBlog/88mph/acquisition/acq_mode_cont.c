@@ -0,0 +1,148 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "acquisition/acq_mode_cont.h"
+
+#include "acquisition/acq_modes.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "system/timer.h"
+#include "system/clock.h"
+#include "system/trace.h"
+#include "hardware/hy3131.h"
+#include "hardware/buzzer.h"
+
+// registers for continuity and diode
+// the ohms source settings haven't been captured from the stock firmware
+// yet, so these are the DCV 5V settings until then
+static const uint8_t cont_regs[2][20] = {
+    // continuity 500.00 ohms
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20},
+    // diode 5.0000V
+    {   0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+     0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20}
+};
+
+static const rdg_unit_t cont_units[2] = {RDG_UNIT_OHMS, RDG_UNIT_VOLTS};
+static const rdg_decimal_t cont_decimals[2] = {
+    RDG_DECIMAL_100d00, RDG_DECIMAL_1d0000
+};
+
+// the threshold as a raw AD1 value, so the comparison is all the sample
+// has to go through. 500.00 ohms puts 100 counts in an ohm, and the
+// millicounts are calibrated by multiplying by 100/6 like volts dc
+#define CONT_THRESHOLD_RAW (CONT_THRESHOLD_OHMS*100*1000*6/100)
+
+static cont_latency_t latency;
+static bool beeping = false;
+static uint32_t last_irq_us = 0;
+
+HOT_FUNC void acq_mode_func_continuity(acq_event_t event, int64_t value) {
+    static acq_submode_t submode = 0;
+
+    switch (event) {
+        case ACQ_EVENT_START:
+        case ACQ_EVENT_SET_SUBMODE: {
+            acq_clear_readings();
+            submode = (acq_submode_t)value;
+            hy_write_regs(0x20, 20, &cont_regs[submode][0]);
+            acq_set_int_mask(HY_REG_INT_AD1);
+            beeping = false;
+            buzzer_stop();
+            break;
+        }
+
+        case ACQ_EVENT_NEW_AD1: {
+            int32_t ad1 = (int32_t)value;
+            uint32_t irq_us = acq_get_irq_time_us();
+
+            if (submode == ACQ_MODE_CONTINUITY_SUBMODE_CONT) {
+                // open probes can read 0 or go negative, and those aren't
+                // shorts
+                if (ad1 >= 0 && ad1 < CONT_THRESHOLD_RAW) {
+                    buzzer_beep(CONT_BEEP_10MS);
+                    if (!beeping) {
+                        // this is the sample the probes touched in
+                        uint32_t us = TIMER_US_NOW() - irq_us;
+                        latency.beeps++;
+                        latency.last_us = us;
+                        if (us > latency.max_us) {
+                            latency.max_us = us;
+                        }
+                        latency.sample_us = irq_us - last_irq_us;
+                        beeping = true;
+                        trace_event(TRACE_BEEP, us);
+                    }
+                } else if (beeping) {
+                    // and stop as soon as they come off
+                    buzzer_stop();
+                    beeping = false;
+                }
+            }
+            last_irq_us = irq_us;
+
+            // the display still gets the filtered value like normal
+            reading_t reading = {
+                (ad1*100)/6, // millicounts
+                timer_1ms_ticks, // time_ms
+                irq_us, // time_us
+                cont_units[submode], // unit
+                RDG_EXPONENT_NONE, // exponent
+                cont_decimals[submode], // decimal point
+                RDG_KIND_MAIN, // kind
+                0 // mean_square
+            };
+            acq_put_reading(&reading);
+            break;
+        }
+
+        case ACQ_EVENT_STOP: {
+            acq_set_int_mask(0x00);
+            if (beeping) {
+                buzzer_stop();
+                beeping = false;
+            }
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
+
+// get a copy of the beeper's latency measurements
+void acq_cont_get_latency(cont_latency_t* l) {
+    __disable_irq();
+    *l = latency;
+    __enable_irq();
+}
+
+void acq_cont_reset_latency(void) {
+    __disable_irq();
+    latency.beeps = 0;
+    latency.last_us = 0;
+    latency.max_us = 0;
+    latency.sample_us = 0;
+    __enable_irq();
+}
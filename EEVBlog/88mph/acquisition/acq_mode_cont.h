@@ -0,0 +1,55 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef ACQUISITION_ACQ_MODE_CONT_H
+#define ACQUISITION_ACQ_MODE_CONT_H
+
+#include <stdint.h>
+
+#include "acquisition/acq_modes.h"
+
+// this file defines the acquisition mode func for continuity and diodes
+// the beeper has to answer within a few ms, so instead of waiting for the
+// measurement filter and the system job, the acquisition job compares each
+// raw AD1 sample against the threshold and drives the buzzer itself
+
+// continuity beeps below this many ohms
+#define CONT_THRESHOLD_OHMS (30)
+// how long each sample below the threshold keeps the buzzer going, in 10ms
+// units. it has to outlast the time between samples so the tone is steady
+#define CONT_BEEP_10MS (5)
+
+typedef struct {
+    // how many times the beeper has started
+    uint32_t beeps;
+    // microseconds from the HY's interrupt for the first sample below the
+    // threshold to the buzzer turning on, last time and worst ever
+    uint32_t last_us;
+    uint32_t max_us;
+    // microseconds between the last two samples. the probes could have
+    // touched any time in there, so the real latency is up to this much more
+    uint32_t sample_us;
+} cont_latency_t;
+
+void acq_mode_func_continuity(acq_event_t event, int64_t value);
+
+// get a copy of the beeper's latency measurements
+void acq_cont_get_latency(cont_latency_t* latency);
+void acq_cont_reset_latency(void);
+
+#endif
@@ -0,0 +1,187 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/acq_mode_freq.h"
+
+#include "acquisition/acq_modes.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "system/timer.h"
+#include "system/clock.h"
+#include "hardware/hy3131.h"
+
+// registers for the frequency counter
+// for now, these are the DCV 5V settings, so the input at least goes through
+// the V jack's divider. the counter's gate and trigger setup haven't been
+// captured from the stock firmware yet
+static const uint8_t freq_regs[20] = {
+       0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+    0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20
+};
+
+#define GATE_COUNTS ((uint64_t)FREQ_REF_HZ*FREQ_GATE_MS/1000)
+#define TIMEOUT_COUNTS ((uint64_t)FREQ_REF_HZ*FREQ_TIMEOUT_MS/1000)
+
+static const freq_format_t hz_formats[] = {
+    {RDG_EXPONENT_NONE, RDG_DECIMAL_1d0000, -4}, // 9.9999Hz
+    {RDG_EXPONENT_NONE, RDG_DECIMAL_10d000, -3}, // 99.999Hz
+    {RDG_EXPONENT_NONE, RDG_DECIMAL_100d00, -2}, // 999.99Hz
+    {RDG_EXPONENT_KILO, RDG_DECIMAL_1d0000, -1}, // 9.9999kHz
+    {RDG_EXPONENT_KILO, RDG_DECIMAL_10d000, 0}, // 99.999kHz
+    {RDG_EXPONENT_KILO, RDG_DECIMAL_100d00, 1}, // 999.99kHz
+    {RDG_EXPONENT_MEGA, RDG_DECIMAL_1d0000, 2}, // 9.9999MHz
+};
+
+static const freq_format_t period_formats[] = {
+    {RDG_EXPONENT_MICRO, RDG_DECIMAL_10d000, -9}, // 99.999us
+    {RDG_EXPONENT_MICRO, RDG_DECIMAL_100d00, -8}, // 999.99us
+    {RDG_EXPONENT_MILLI, RDG_DECIMAL_1d0000, -7}, // 9.9999ms
+    {RDG_EXPONENT_MILLI, RDG_DECIMAL_10d000, -6}, // 99.999ms
+    {RDG_EXPONENT_MILLI, RDG_DECIMAL_100d00, -5}, // 999.99ms
+    {RDG_EXPONENT_NONE, RDG_DECIMAL_1d0000, -4}, // 9.9999s
+    {RDG_EXPONENT_NONE, RDG_DECIMAL_10d000, -3}, // 99.999s
+};
+
+static const freq_format_t duty_formats[] = {
+    {RDG_EXPONENT_NONE, RDG_DECIMAL_100d00, -2}, // 100.00%
+};
+
+static const uint64_t pow10[13] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL
+};
+
+// true if num/den is less than 10^e, without dividing
+static bool less_than_pow10(uint64_t num, uint64_t den, int e) {
+    if (e >= 0) {
+        return num < den*pow10[e];
+    } else {
+        return num*pow10[-e] < den;
+    }
+}
+
+// put num/den (in the base unit) into a reading
+// this picks the finest format that fits under 100000 counts, then does the
+// one and only division to get the millicounts
+// the gate keeps den small enough that none of this overflows 64 bits
+void freq_put_ratio(uint64_t num, uint64_t den, rdg_unit_t unit,
+        const freq_format_t* formats, int num_formats) {
+    const freq_format_t* f = &formats[0];
+    if (den == 0) {
+        // nothing was counted, so call it 0
+        num = 0;
+        den = 1;
+    } else {
+        for (int fi=0; fi<num_formats; fi++) {
+            f = &formats[fi];
+            if (less_than_pow10(num, den, 5+f->count_exp)) {
+                break;
+            }
+        }
+    }
+
+    int scale = 3-f->count_exp;
+    uint64_t mc;
+    if (scale >= 0) {
+        mc = (num*pow10[scale])/den;
+    } else {
+        mc = num/(den*pow10[-scale]);
+    }
+
+    reading_t reading = {
+        (int32_t)mc, // millicounts
+        timer_1ms_ticks, // time_ms
+        acq_get_irq_time_us(), // time_us
+        unit, // unit
+        f->exponent, // exponent
+        f->decimal, // decimal point
+        RDG_KIND_MAIN, // kind
+        0 // mean_square
+    };
+    acq_put_reading(&reading);
+}
+
+void acq_mode_func_freq(acq_event_t event, int64_t value) {
+    static acq_submode_t submode = 0;
+    // the counts over every HY gate since the last reading
+    // these are what make the counters wider than 24 bits
+    static uint64_t cta = 0, ctb = 0, ctc = 0;
+
+    switch (event) {
+        case ACQ_EVENT_START:
+        case ACQ_EVENT_SET_SUBMODE: {
+            // starting and setting submodes is the same
+            // clear acquisitions that aren't for this mode
+            acq_clear_readings();
+            submode = (acq_submode_t)value;
+            cta = 0;
+            ctb = 0;
+            ctc = 0;
+            // all the submodes use the same settings, but reprogram anyway
+            // so the counter starts a fresh gate
+            hy_write_regs(0x20, 20, freq_regs);
+            acq_set_int_mask(HY_REG_INT_CT);
+            break;
+        }
+
+        case ACQ_EVENT_NEW_CT: {
+            const acq_ct_t* ct = (const acq_ct_t*)(uint32_t)value;
+            cta += ct->cta;
+            ctb += ct->ctb;
+            ctc += ct->ctc;
+            // keep the gate open until it's long enough and has seen a whole
+            // period, or until it's obvious there's no signal
+            bool done = (ctb >= GATE_COUNTS && cta > 0) ||
+                ctb >= TIMEOUT_COUNTS;
+            if (!done) {
+                break;
+            }
+
+            if (submode == ACQ_MODE_FREQ_SUBMODE_HZ) {
+                // f = cta/(ctb/ref)
+                freq_put_ratio(cta*FREQ_REF_HZ, cta ? ctb : 0,
+                    RDG_UNIT_HERTZ, hz_formats, NUM_FORMATS(hz_formats));
+            } else if (submode == ACQ_MODE_FREQ_SUBMODE_PERIOD) {
+                // T = (ctb/ref)/cta
+                freq_put_ratio(ctb, cta*FREQ_REF_HZ, RDG_UNIT_SECONDS,
+                    period_formats, NUM_FORMATS(period_formats));
+            } else {
+                // duty = ctc/ctb
+                freq_put_ratio(ctc*100, ctb, RDG_UNIT_PERCENT,
+                    duty_formats, NUM_FORMATS(duty_formats));
+            }
+            cta = 0;
+            ctb = 0;
+            ctc = 0;
+            break;
+        }
+
+        case ACQ_EVENT_STOP: {
+            acq_set_int_mask(0x00);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
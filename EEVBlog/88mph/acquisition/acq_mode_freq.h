@@ -0,0 +1,60 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef ACQUISITION_ACQ_MODE_FREQ_H
+#define ACQUISITION_ACQ_MODE_FREQ_H
+
+#include <stdint.h>
+
+#include "acquisition/acq_modes.h"
+#include "acquisition/reading.h"
+
+// this file defines the acquisition mode func for the frequency counter
+// it does reciprocal counting: the HY counts its reference clock over a whole
+// number of input periods, so the resolution doesn't depend on the input
+// frequency
+
+// the HY's reference clock for the counter
+// the counter runs off the HY's own crystal
+#define FREQ_REF_HZ (4915200UL)
+// a reading is made once the gate has been open this long and has seen at
+// least one whole input period. that's 491520 reference counts, which is
+// plenty for 5 digits. slower inputs just make the gate as long as a period
+#define FREQ_GATE_MS (100)
+// if the gate has been open this long without seeing a whole period, there's
+// no signal and the reading is 0
+#define FREQ_TIMEOUT_MS (2000)
+
+// how a reading can be displayed, finest first
+typedef struct {
+    rdg_exponent_t exponent;
+    rdg_decimal_t decimal;
+    // one count on the display is 10^count_exp of the base unit
+    int8_t count_exp;
+} freq_format_t;
+
+#define NUM_FORMATS(f) ((int)(sizeof(f)/sizeof(f[0])))
+
+void acq_mode_func_freq(acq_event_t event, int64_t value);
+
+// put num/den of the base unit into a reading in the finest of the formats
+// it fits in. the other counter modes use this too
+void freq_put_ratio(uint64_t num, uint64_t den, rdg_unit_t unit,
+    const freq_format_t* formats, int num_formats);
+
+#endif
@@ -0,0 +1,113 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/acq_mode_temp.h"
+
+#include "acquisition/acq_modes.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "acquisition/thermocouple.h"
+#include "system/timer.h"
+#include "system/clock.h"
+#include "system/health.h"
+#include "hardware/hy3131.h"
+
+// registers for the thermocouple
+// the 50mV range settings haven't been captured from the stock firmware
+// yet, so this is the DCV 5V setup until then
+static const uint8_t temp_regs[20] = {
+       0,   0,0x13,0x8A,   5,0x40,   0,0x4D,0x31,   1,
+    0x22,   0,   0,0x90,0x28,0xA0,0x80,0xC7,   0,0x20
+};
+
+// the thermocouple's cold junction is where it plugs into the meter, and
+// the closest thing to there we can measure is the micro's die. it's a bit
+// warmer than the terminals, but much better than nothing. it only changes
+// once per health scan, so only look its voltage up then
+static int32_t cj_mdegc = 0;
+static int32_t cj_uv = 0;
+
+static void update_cold_junction(void) {
+    int32_t mdegc;
+    if (!health_get_die_temp_mc(&mdegc)) {
+        mdegc = TEMP_CJ_DEFAULT_MDEGC;
+    }
+    if (mdegc != cj_mdegc) {
+        cj_mdegc = mdegc;
+        cj_uv = tc_mdegc_to_uv(mdegc);
+    }
+}
+
+HOT_FUNC void acq_mode_func_temp(acq_event_t event, int64_t value) {
+    static acq_submode_t submode = 0;
+
+    switch (event) {
+        case ACQ_EVENT_START:
+        case ACQ_EVENT_SET_SUBMODE: {
+            acq_clear_readings();
+            submode = (acq_submode_t)value;
+            hy_write_regs(0x20, 20, temp_regs);
+            acq_set_int_mask(HY_REG_INT_AD1);
+            // make sure the cache gets filled the first time
+            cj_mdegc = INT32_MIN;
+            update_cold_junction();
+            break;
+        }
+
+        case ACQ_EVENT_NEW_AD1: {
+            int32_t ad1 = (int32_t)value;
+            update_cold_junction();
+            // on the 50.000mV range a count is a microvolt, and the
+            // millicounts are calibrated by multiplying by 100/6 like volts dc
+            int32_t uv = ad1/60;
+            // the thermocouple only sees the difference between its ends,
+            // so add back what the cold junction would have made
+            int32_t mdeg = tc_uv_to_mdegc(uv + cj_uv);
+            rdg_unit_t unit = RDG_UNIT_DEG_C;
+            if (submode == ACQ_MODE_TEMP_SUBMODE_DEG_F) {
+                mdeg = mdeg*9/5 + 32000;
+                unit = RDG_UNIT_DEG_F;
+            }
+            reading_t reading = {
+                // a count is a tenth of a degree
+                mdeg*10, // millicounts
+                timer_1ms_ticks, // time_ms
+                acq_get_irq_time_us(), // time_us
+                unit, // unit
+                RDG_EXPONENT_NONE, // exponent
+                RDG_DECIMAL_1000d0, // decimal point
+                RDG_KIND_MAIN, // kind
+                0 // mean_square
+            };
+            acq_put_reading(&reading);
+            break;
+        }
+
+        case ACQ_EVENT_STOP: {
+            acq_set_int_mask(0x00);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef ACQUISITION_ACQ_MODE_TEMP_H
+#define ACQUISITION_ACQ_MODE_TEMP_H
+
+#include <stdint.h>
+
+#include "acquisition/acq_modes.h"
+
+// this file defines the acquisition mode func for type K thermocouples
+// every AD1 sample gets cold junction compensated and linearized, so the
+// measurement engine only ever sees temperatures
+
+// the cold junction temperature to assume until the health scan has
+// measured the die, in thousandths of a degree C
+#define TEMP_CJ_DEFAULT_MDEGC (25000)
+
+void acq_mode_func_temp(acq_event_t event, int64_t value);
+
+#endif
\ No newline at end of file
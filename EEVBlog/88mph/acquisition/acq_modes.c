@@ -22,10 +22,29 @@
 
 #include "acquisition/acquisition.h"
 #include "acquisition/acq_mode_basic.h"
+#include "acquisition/acq_mode_ac.h"
+#include "acquisition/acq_mode_freq.h"
+#include "acquisition/acq_mode_cont.h"
+#include "acquisition/acq_mode_temp.h"
+#include "acquisition/acq_mode_cap.h"
 
-const acq_mode_func acq_mode_funcs[2] = {
+const acq_mode_func acq_mode_funcs[ACQ_NUM_MODES] = {
     // ACQ_MODE_MISC
     acq_mode_func_misc,
     // ACQ_MODE_VOLTS_DC
-    acq_mode_func_volts_dc
+    acq_mode_func_volts_dc,
+    // ACQ_MODE_VOLTS_AC
+    acq_mode_func_volts_ac,
+    // ACQ_MODE_AMPS_AC
+    acq_mode_func_amps_ac,
+    // ACQ_MODE_FREQ
+    acq_mode_func_freq,
+    // ACQ_MODE_VOLTS_DUAL
+    acq_mode_func_volts_dual,
+    // ACQ_MODE_CONTINUITY
+    acq_mode_func_continuity,
+    // ACQ_MODE_TEMP
+    acq_mode_func_temp,
+    // ACQ_MODE_CAP
+    acq_mode_func_cap
 };
\ No newline at end of file
@@ -27,7 +27,15 @@
 
 typedef enum {
     ACQ_MODE_MISC=0,
-    ACQ_MODE_VOLTS_DC
+    ACQ_MODE_VOLTS_DC,
+    ACQ_MODE_VOLTS_AC,
+    ACQ_MODE_AMPS_AC,
+    ACQ_MODE_FREQ,
+    ACQ_MODE_VOLTS_DUAL,
+    ACQ_MODE_CONTINUITY,
+    ACQ_MODE_TEMP,
+    ACQ_MODE_CAP,
+    ACQ_NUM_MODES
 } acq_mode_t;
 
 // each mode starts its submodes at 0!!!
@@ -37,7 +45,38 @@ typedef enum {
     ACQ_MODE_VOLTS_DC_SUBMODE_5d0000=0,
     ACQ_MODE_VOLTS_DC_SUBMODE_50d000,
     ACQ_MODE_VOLTS_DC_SUBMODE_500d00,
-    ACQ_MODE_VOLTS_DC_SUBMODE_1000d0
+    ACQ_MODE_VOLTS_DC_SUBMODE_1000d0,
+
+    ACQ_MODE_VOLTS_AC_SUBMODE_5d0000=0,
+    ACQ_MODE_VOLTS_AC_SUBMODE_50d000,
+    ACQ_MODE_VOLTS_AC_SUBMODE_500d00,
+    ACQ_MODE_VOLTS_AC_SUBMODE_1000d0,
+
+    ACQ_MODE_AMPS_AC_SUBMODE_5000d0u=0,
+    ACQ_MODE_AMPS_AC_SUBMODE_500d00m,
+    ACQ_MODE_AMPS_AC_SUBMODE_10d000,
+
+    // the frequency counter's submodes pick what it shows, not a range.
+    // it autoranges
+    ACQ_MODE_FREQ_SUBMODE_HZ=0,
+    ACQ_MODE_FREQ_SUBMODE_PERIOD,
+    ACQ_MODE_FREQ_SUBMODE_DUTY,
+
+    // dc and ac volts at the same time, with the same ranges
+    ACQ_MODE_VOLTS_DUAL_SUBMODE_5d0000=0,
+    ACQ_MODE_VOLTS_DUAL_SUBMODE_50d000,
+    ACQ_MODE_VOLTS_DUAL_SUBMODE_500d00,
+    ACQ_MODE_VOLTS_DUAL_SUBMODE_1000d0,
+
+    ACQ_MODE_CONTINUITY_SUBMODE_CONT=0,
+    ACQ_MODE_CONTINUITY_SUBMODE_DIODE,
+
+    // type K thermocouple, in either unit
+    ACQ_MODE_TEMP_SUBMODE_DEG_C=0,
+    ACQ_MODE_TEMP_SUBMODE_DEG_F,
+
+    // capacitance always autoranges
+    ACQ_MODE_CAP_SUBMODE_AUTO=0
 
 } acq_submode_t;
 
@@ -51,11 +90,27 @@ typedef enum {
     // switch submodes, value is new submode
     ACQ_EVENT_SET_SUBMODE,
     // new measurement available, value is new measurement
-    ACQ_EVENT_NEW_AD1
+    ACQ_EVENT_NEW_AD1,
+    // new RMS computation available, value is the unsigned 40 bit mean square
+    // of the AD1 samples, in counts squared
+    ACQ_EVENT_NEW_RMS,
+    // the frequency counter finished a gate, value is a pointer to an acq_ct_t
+    ACQ_EVENT_NEW_CT
 } acq_event_t;
 
+// what the frequency counter counted during one of the HY's gates
+// cta counts whole input periods, ctb counts the reference clock during
+// exactly those periods, and ctc counts the reference clock while the input
+// was high. the registers are only 24 bits, so ctb has already been extended
+// if the HY said it overflowed
+typedef struct {
+    uint32_t cta;
+    uint32_t ctb;
+    uint32_t ctc;
+} acq_ct_t;
+
 typedef void (*acq_mode_func)(acq_event_t event, int64_t value);
 
-extern const acq_mode_func acq_mode_funcs[2];
+extern const acq_mode_func acq_mode_funcs[ACQ_NUM_MODES];
 
 #endif
\ No newline at end of file
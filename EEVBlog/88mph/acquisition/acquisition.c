@@ -25,12 +25,31 @@
 #include "acquisition/acquisition.h"
 
 #include "acquisition/acq_modes.h"
+#include "acquisition/capture.h"
 #include "system/job.h"
+#include "system/clock.h"
+#include "system/idle.h"
+#include "system/deadline.h"
+#include "system/trace.h"
+#include "system/timer.h"
+#include "system/profile.h"
 #include "hardware/hy3131.h"
 #include "hardware/gpio.h"
 
 static acq_mode_func curr_acq_mode_func = 0;
+static acq_mode_t curr_acq_mode = ACQ_MODE_MISC;
 static volatile uint8_t curr_int_mask = 0;
+// timestamp of the interrupt that the acquisition job is handling
+static uint32_t curr_irq_time_us = 0;
+
+// if a mode is running, and whether it's asking for a faster clock
+static bool acq_running = false;
+static bool acq_clock_requested = false;
+// the jobs' total busy time and deadline trouble the last time the load was
+// checked, and when that was
+static uint32_t load_last_ms;
+static uint32_t load_last_busy_us;
+static uint32_t load_last_troubles;
 
 // turn on the acquisition engine
 void acq_init(void) {
@@ -38,15 +57,16 @@ void acq_init(void) {
     GPIO_PINSET(HW_PWR_CTL);
     // turn on the 4V analog supply
     GPIO_PINSET(HW_PWR_CTL2);
-    // give the HY3131 a bit of time to power up
-    // who knows if this is necessary, but it feels good
-    HAL_Delay(10);
+    // wait for the HY3131 to power up. if it never answers, carry on
+    // anyway, and it'll just never give us any readings
+    hy_wait_ready(HY_READY_TIMEOUT_MS);
     // initialize it
     curr_int_mask = 0;
     hy_init();
     // switch to the 'off' mode manually
     // cause there should be no previous mode func to call
     curr_acq_mode_func = acq_mode_funcs[ACQ_MODE_MISC];
+    curr_acq_mode = ACQ_MODE_MISC;
     curr_acq_mode_func(ACQ_EVENT_START, (int64_t)ACQ_MODE_MISC_SUBMODE_OFF);
     // the off mode tells the HY to not send us interrupts
 }
@@ -65,10 +85,25 @@ void acq_deinit(void) {
     GPIO_PINRST(HW_PWR_CTL);
 }
 
+// read one of the HY's 24 bit data registers and sign extend it to 32
+static HOT_FUNC int32_t read_s24(uint8_t reg) {
+    uint8_t regbuf[3];
+    hy_read_regs(reg, 3, regbuf);
+    int32_t val = regbuf[2] << 16 | regbuf[1] << 8 | regbuf[0];
+    if (val & 0x800000) {
+        val |= 0xFF000000;
+    }
+    return val;
+}
+
 // do the acquisition job
 // check the HY3131 and calculate new acquisitions
-void acq_handle_job_acquisition(void) {
-    uint8_t regbuf[5];
+HOT_FUNC void acq_handle_job_acquisition(uint32_t irq_time_us) {
+    uint8_t regbuf[10];
+
+    // remember when the HY told us about this so the mode funcs can
+    // stamp their readings with it
+    curr_irq_time_us = irq_time_us;
 
     // read which interrupts are pending
     // this also clears the pending interrupts
@@ -76,17 +111,42 @@ void acq_handle_job_acquisition(void) {
     hy_read_regs(HY_REG_INTF, 1, &which_ints);
     // only handle pending interrupts which are enabled
     which_ints &= curr_int_mask;
+    // one interrupt can have results from several channels, and the mode
+    // gets told about each of them
     if (which_ints & HY_REG_INT_AD1) {
-        // read the 24 bit AD1 register
-        hy_read_regs(HY_REG_AD1_DATA, 3, regbuf);
-        int32_t val = regbuf[2] << 16 | regbuf[1] << 8 | regbuf[0];
-        // sign extend 24 bits to 32
-        if (val & 0x800000) {
-            val |= 0xFF000000;
-        }
+        int32_t val = read_s24(HY_REG_AD1_DATA);
+        // give the raw sample to the capture, if it's running
+        capture_put_sample(val, irq_time_us);
         // tell the current acquisition mode about it
         curr_acq_mode_func(ACQ_EVENT_NEW_AD1, val);
     }
+    if (which_ints & HY_REG_INT_RMS) {
+        // read the 40 bit RMS register
+        // it's the mean square, so it's never negative
+        hy_read_regs(HY_REG_RMS_DATA, 5, regbuf);
+        int64_t ms = (int64_t)regbuf[4] << 32 | (uint32_t)regbuf[3] << 24 |
+            regbuf[2] << 16 | regbuf[1] << 8 | regbuf[0];
+        curr_acq_mode_func(ACQ_EVENT_NEW_RMS, ms);
+    }
+    if (which_ints & HY_REG_INT_CT) {
+        // read the counter status and all three 24 bit counters at once
+        hy_read_regs(HY_REG_CTSTA, 10, regbuf);
+        acq_ct_t ct;
+        ct.ctc = regbuf[3] << 16 | regbuf[2] << 8 | regbuf[1];
+        ct.ctb = regbuf[6] << 16 | regbuf[5] << 8 | regbuf[4];
+        ct.cta = regbuf[9] << 16 | regbuf[8] << 8 | regbuf[7];
+        // put back the bit that fell off the top of ctb
+        if (regbuf[0] & HY_REG_CTSTA_CTBOV) {
+            ct.ctb += 1UL << 24;
+        }
+        curr_acq_mode_func(ACQ_EVENT_NEW_CT, (int64_t)(uint32_t)&ct);
+    }
+}
+
+// get the microsecond timestamp of the interrupt currently being handled
+// mode funcs use this to timestamp their readings
+uint32_t acq_get_irq_time_us(void) {
+    return curr_irq_time_us;
 }
 
 void acq_set_int_mask(uint8_t mask) {
@@ -105,22 +165,99 @@ void acq_set_int_mask(uint8_t mask) {
     job_resume(JOB_ACQUISITION, acq_enabled);
 }
 
+// everything the acquisition and measurement jobs have been busy for
+static uint32_t load_busy_us(void) {
+    prof_counter_t acq, meas;
+    prof_get(PROF_JOB_ACQUISITION, &acq);
+    prof_get(PROF_JOB_MEASUREMENT, &meas);
+    return acq.total_us + meas.total_us;
+}
+
+// and every time they've fallen behind
+static uint32_t load_troubles(void) {
+    return deadline_get_count(DEADLINE_ACQ_LATE) +
+        deadline_get_count(DEADLINE_ACQ_MISSED) +
+        deadline_get_count(DEADLINE_MEAS_BACKLOG) +
+        deadline_get_count(DEADLINE_MEAS_DROP);
+}
+
+static void load_restart(void) {
+    load_last_ms = timer_1ms_ticks;
+    load_last_busy_us = load_busy_us();
+    load_last_troubles = load_troubles();
+}
+
+// called by the system job to see if the low clock level can keep up
+void acq_process(void) {
+    if (!acq_running) return;
+    uint32_t elapsed_ms = timer_1ms_ticks - load_last_ms;
+    if (elapsed_ms < ACQ_LOAD_INTERVAL_MS) return;
+
+    uint32_t total_busy_us = load_busy_us();
+    uint32_t busy_us = total_busy_us - load_last_busy_us;
+    bool trouble = load_troubles() != load_last_troubles;
+    bool reset = total_busy_us < load_last_busy_us;
+    load_restart();
+    if (reset) {
+        // somebody zeroed the profile counters, so this interval's busy
+        // time is garbage
+        return;
+    }
+    // how busy the jobs would be at the low level, in percent
+    // the measurement job's time includes the acquisition job
+    // interrupting it, so this errs on the busy side
+    uint32_t pct = (uint32_t)(((uint64_t)busy_us*clock_get_hclk()) /
+        ((uint64_t)elapsed_ms*10*clock_get_level_hclk(CLOCK_LEVEL_LOW)));
+
+    if (!acq_clock_requested && (trouble || pct > ACQ_LOAD_UP_PCT)) {
+        acq_clock_requested = true;
+        clock_request(CLOCK_REQ_ACQUISITION);
+    } else if (acq_clock_requested && !trouble &&
+            pct < ACQ_LOAD_DOWN_PCT) {
+        acq_clock_requested = false;
+        clock_release(CLOCK_REQ_ACQUISITION);
+    }
+}
+
 void acq_set_mode(acq_mode_t mode, acq_submode_t submode) {
+    // unless we're turning off, start out fast enough to keep up with
+    // anything. acq_process lets the clock go once it sees how busy the
+    // new mode actually keeps the jobs.
+    bool turning_off = (mode == ACQ_MODE_MISC &&
+        submode == ACQ_MODE_MISC_SUBMODE_OFF);
+    if (!turning_off) {
+        acq_clock_requested = true;
+        clock_request(CLOCK_REQ_ACQUISITION);
+        idle_hold(IDLE_HOLD_ACQUISITION);
+    }
+    trace_event(TRACE_ACQ_MODE, mode << 8 | submode);
     // the acq job might try to interrupt us during this process, so pause it
     bool acq_enabled = job_disable(JOB_ACQUISITION);
     // turn off the current mode
     curr_acq_mode_func(ACQ_EVENT_STOP, 0);
     // figure out which mode func goes with this mode
     curr_acq_mode_func = acq_mode_funcs[mode];
+    curr_acq_mode = mode;
     // and start it up
     curr_acq_mode_func(ACQ_EVENT_START, (int64_t)submode);
+    // the interrupts will come at a different rate now
+    deadline_acq_restart();
     job_resume(JOB_ACQUISITION, acq_enabled);
+    acq_running = !turning_off;
+    load_restart();
+    if (turning_off) {
+        acq_clock_requested = false;
+        clock_release(CLOCK_REQ_ACQUISITION);
+        idle_release(IDLE_HOLD_ACQUISITION);
+    }
 }
 
 void acq_set_submode(acq_submode_t submode) {
+    trace_event(TRACE_ACQ_MODE, curr_acq_mode << 8 | submode);
     // the acq job might try to interrupt us during this process, so pause it
     bool acq_enabled = job_disable(JOB_ACQUISITION);
     curr_acq_mode_func(ACQ_EVENT_SET_SUBMODE, (int64_t)submode);
+    deadline_acq_restart();
     job_resume(JOB_ACQUISITION, acq_enabled);
 }
 
@@ -132,21 +269,41 @@ void acq_set_submode(acq_submode_t submode) {
 static volatile reading_t queue[ACQ_READING_QUEUE_SIZE];
 static volatile int q_head = 0;
 static volatile int q_tail = 0;
+static rdg_queue_stats_t q_stats;
 
 // put a reading into the queue. if there is no space it's just dropped
-void acq_put_reading(reading_t* reading) {
+HOT_FUNC void acq_put_reading(reading_t* reading) {
     // can be called from any job, so protect ourselves!
     __disable_irq();
     // buffer head cause it's volatile
     // but we know we can't get interrupted
     int q_h = q_head;
+    q_stats.puts++;
+    uint32_t depth;
+    bool dropped = false;
     if (((q_h+1)&Q_MASK) != q_tail) {
         // we have space
         queue[q_h] = *reading;
         q_head = (q_h+1) & Q_MASK;
+        depth = (q_head - q_tail) & Q_MASK;
+        if (depth > q_stats.max_depth) {
+            q_stats.max_depth = depth;
+        }
+    } else {
+        q_stats.drops++;
+        depth = Q_MASK;
+        dropped = true;
     }
     __enable_irq();
 
+    trace_event(TRACE_ACQ_PUT, depth);
+    // tell the deadline monitor if the measurement job isn't keeping up
+    if (dropped) {
+        deadline_record(DEADLINE_MEAS_DROP, depth);
+    } else if (depth == DEADLINE_BACKLOG_DEPTH) {
+        deadline_record(DEADLINE_MEAS_BACKLOG, depth);
+    }
+
     // the measurement engine is certainly interested in this new reading
     job_schedule(JOB_MEASUREMENT);
 }
@@ -177,6 +334,13 @@ void acq_clear_readings(void) {
     __enable_irq();
 }
 
+// get a copy of the queue's statistics
+void acq_get_queue_stats(rdg_queue_stats_t* stats) {
+    __disable_irq();
+    *stats = q_stats;
+    __enable_irq();
+}
+
 // misc mode handler
 void acq_mode_func_misc(acq_event_t event, int64_t value) {
     // for now, all this mode should be doing is turning off
@@ -32,11 +32,26 @@ void acq_deinit(void);
 
 // do the acquisition job
 // check the HY3131 and calculate new acquisitions
-void acq_handle_job_acquisition(void);
+// irq_time_us is the microsecond timestamp of the HY3131's interrupt
+void acq_handle_job_acquisition(uint32_t irq_time_us);
+
+// get the microsecond timestamp of the interrupt currently being handled
+// mode funcs use this to timestamp their readings
+uint32_t acq_get_irq_time_us(void);
 
 // set the HY interrupt mask register
 void acq_set_int_mask(uint8_t mask);
 
+// while a mode is running, the acquisition and measurement jobs are checked
+// this often to see if the low clock level can keep up with them
+#define ACQ_LOAD_INTERVAL_MS (500)
+// the clock is asked to go faster when the jobs would be busy more than
+// this percent of the time at the low level, and let go again once they'd
+// be under ACQ_LOAD_DOWN_PCT. missed deadlines always ask for it.
+#define ACQ_LOAD_UP_PCT (60)
+#define ACQ_LOAD_DOWN_PCT (40)
+// called by the system job to check
+void acq_process(void);
 
 // set acquisition state
 void acq_set_mode(acq_mode_t mode, acq_submode_t submode);
@@ -51,6 +66,8 @@ void acq_put_reading(reading_t* reading);
 bool acq_get_reading(reading_t* reading);
 // empty the queue of all readings
 void acq_clear_readings(void);
+// get a copy of the queue's statistics
+void acq_get_queue_stats(rdg_queue_stats_t* stats);
 
 void acq_mode_func_misc(acq_event_t event, int64_t value);
 
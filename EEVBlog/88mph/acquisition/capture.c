@@ -0,0 +1,227 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/capture.h"
+
+#include "system/job.h"
+#include "system/clock.h"
+#include "system/text.h"
+#include "storage/dump.h"
+
+#define CAP_MASK (CAPTURE_BUF_SIZE-1)
+
+static capture_sample_t cap_buf[CAPTURE_BUF_SIZE];
+// how many samples have been put in the buffer since arming
+// the buffer is a ring, so sample n is at cap_buf[n & CAP_MASK]
+static uint32_t cap_pos = 0;
+// sample number of the trigger
+static uint32_t cap_trig_pos = 0;
+// sample number where we stop, once triggered
+static uint32_t cap_end_pos = 0;
+
+static uint32_t cap_pre = 0;
+static uint32_t cap_post = 0;
+static capture_trig_t cap_trig = CAPTURE_TRIG_NOW;
+static int32_t cap_level = 0;
+// the last sample, for edge triggers
+static int32_t cap_prev = 0;
+
+static volatile capture_state_t cap_state = CAPTURE_IDLE;
+
+// start capturing. pre samples are kept from before the trigger, and post
+// samples after it. pre+post must be less than CAPTURE_BUF_SIZE, since the
+// trigger sample needs a spot too. returns false if it's too many.
+// level is in raw AD1 counts. refused while the capture is being dumped.
+bool capture_arm(uint32_t pre, uint32_t post,
+        capture_trig_t trig, int32_t level) {
+    if (pre >= CAPTURE_BUF_SIZE || post >= CAPTURE_BUF_SIZE-pre ||
+            capture_is_dumping()) {
+        return false;
+    }
+    // the acquisition job has to keep up with every sample
+    clock_request(CLOCK_REQ_CAPTURE);
+    // the acq job might try to interrupt us during this process, so pause it
+    bool acq_enabled = job_disable(JOB_ACQUISITION);
+    cap_pos = 0;
+    cap_pre = pre;
+    cap_post = post;
+    cap_trig = trig;
+    cap_level = level;
+    // starting at the level means the first sample can't look like an edge
+    cap_prev = level;
+    cap_state = CAPTURE_ARMED;
+    job_resume(JOB_ACQUISITION, acq_enabled);
+    return true;
+}
+
+// stop capturing and throw away the samples
+// returns false if the capture is being dumped, so they have to stay
+bool capture_abort(void) {
+    if (capture_is_dumping()) {
+        return false;
+    }
+    cap_state = CAPTURE_IDLE;
+    clock_release(CLOCK_REQ_CAPTURE);
+    return true;
+}
+
+// called by the system job to notice when the capture is done
+void capture_process(void) {
+    // the clock is switched from here instead of the acquisition job
+    // so the hot path doesn't have to wait for it
+    if (cap_state == CAPTURE_DONE) {
+        clock_release(CLOCK_REQ_CAPTURE);
+    }
+}
+
+capture_state_t capture_get_state(void) {
+    return cap_state;
+}
+
+// how many samples there are to look at. 0 if the capture isn't done
+uint32_t capture_get_count(void) {
+    if (cap_state != CAPTURE_DONE) {
+        return 0;
+    }
+    return cap_pre + 1 + cap_post;
+}
+
+// which of those samples was the trigger
+uint32_t capture_get_trigger_index(void) {
+    return cap_pre;
+}
+
+// get sample number index, from 0 up to capture_get_count()
+// returns false if there's no such sample
+bool capture_get_sample(uint32_t index, capture_sample_t* sample) {
+    if (index >= capture_get_count()) {
+        return false;
+    }
+    *sample = cap_buf[(cap_trig_pos - cap_pre + index) & CAP_MASK];
+    return true;
+}
+
+// records for the dumper are a capture_sample_t, little endian
+static bool dump_get_record(uint32_t index, uint8_t* record) {
+    capture_sample_t s;
+    if (!capture_get_sample(index, &s)) {
+        return false;
+    }
+    for (int bi=0; bi<4; bi++) {
+        record[bi] = (uint8_t)(s.ad1 >> (8*bi));
+        record[4+bi] = (uint8_t)(s.time_us >> (8*bi));
+    }
+    return true;
+}
+
+// lines are the sample number relative to the trigger, then the sample
+static uint8_t dump_format_record(uint32_t index, char* text) {
+    capture_sample_t s;
+    if (!capture_get_sample(index, &s)) {
+        return 0;
+    }
+    uint8_t n = text_put_int(text, (int32_t)index - (int32_t)cap_pre);
+    text[n++] = ',';
+    n += text_put_uint(text+n, s.time_us);
+    text[n++] = ',';
+    n += text_put_int(text+n, s.ad1);
+    text[n++] = '\n';
+    return n;
+}
+
+static dump_source_t cap_dump_source = {
+    DUMP_ID_CAPTURE, // id
+    "CAPTURE.CSV", // filename
+    "n,time_us,ad1\n", // csv_header
+    0, // count
+    0, // marker
+    sizeof(capture_sample_t), // record_size
+    dump_get_record, // get_record
+    dump_format_record // format_record
+};
+
+// send the capture out with the dumper. returns false if the capture isn't
+// done or the dumper is busy with something else
+bool capture_dump(dump_dest_t dest) {
+    if (cap_state != CAPTURE_DONE) {
+        return false;
+    }
+    cap_dump_source.count = capture_get_count();
+    cap_dump_source.marker = capture_get_trigger_index();
+    return dump_start(&cap_dump_source, dest);
+}
+
+// true while the dumper is sending the capture out
+bool capture_is_dumping(void) {
+    return dump_is_busy_with(DUMP_ID_CAPTURE);
+}
+
+// called by the acquisition job with every AD1 sample
+// this happens at the HY3131's full rate, so it must be quick!
+void capture_put_sample(int32_t ad1, uint32_t time_us) {
+    capture_state_t state = cap_state;
+    if (state == CAPTURE_IDLE || state == CAPTURE_DONE) {
+        return;
+    }
+
+    uint32_t pos = cap_pos;
+    cap_buf[pos & CAP_MASK].ad1 = ad1;
+    cap_buf[pos & CAP_MASK].time_us = time_us;
+    cap_pos = pos+1;
+
+    if (state == CAPTURE_TRIGGERED) {
+        if (pos+1 == cap_end_pos) {
+            cap_state = CAPTURE_DONE;
+            // let whoever is waiting know
+            job_schedule(JOB_SYSTEM);
+        }
+        return;
+    }
+
+    // we're armed, but can't trigger until the pre-trigger samples are in
+    int32_t prev = cap_prev;
+    cap_prev = ad1;
+    if (pos < cap_pre) {
+        return;
+    }
+    bool triggered;
+    switch (cap_trig) {
+        case CAPTURE_TRIG_ABOVE: triggered = ad1 >= cap_level; break;
+        case CAPTURE_TRIG_BELOW: triggered = ad1 <= cap_level; break;
+        case CAPTURE_TRIG_RISE:
+            triggered = prev < cap_level && ad1 >= cap_level; break;
+        case CAPTURE_TRIG_FALL:
+            triggered = prev > cap_level && ad1 <= cap_level; break;
+        default: triggered = true; break;
+    }
+    if (!triggered) {
+        return;
+    }
+
+    cap_trig_pos = pos;
+    cap_end_pos = pos+1+cap_post;
+    if (cap_post == 0) {
+        cap_state = CAPTURE_DONE;
+        job_schedule(JOB_SYSTEM);
+    } else {
+        cap_state = CAPTURE_TRIGGERED;
+    }
+}
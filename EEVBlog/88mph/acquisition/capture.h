@@ -0,0 +1,99 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef ACQUISITION_CAPTURE_H
+#define ACQUISITION_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "storage/dump.h"
+
+// this file captures raw AD1 samples into RAM, like a little oscilloscope
+// samples are taken straight from the HY3131 in the acquisition job, before
+// the mode funcs see them, so there's no filtering at all. the acquisition
+// keeps running in whatever mode and range it's in, so that decides what
+// the samples mean and how fast they come.
+
+// must be power of 2!!
+// each sample is 8 bytes, so this is 16KB
+#define CAPTURE_BUF_SIZE (2048)
+
+typedef struct {
+    // raw 24 bit AD1 value, sign extended
+    int32_t ad1;
+    // timestamp of the HY3131 interrupt it came from
+    uint32_t time_us;
+} capture_sample_t;
+
+typedef enum {
+    // not doing anything
+    CAPTURE_IDLE = 0,
+    // collecting pre-trigger samples and waiting for the trigger
+    CAPTURE_ARMED,
+    // triggered, collecting post-trigger samples
+    CAPTURE_TRIGGERED,
+    // buffer is full of samples and ready to look at
+    CAPTURE_DONE
+} capture_state_t;
+
+typedef enum {
+    // trigger on the first sample after the pre-trigger samples are in
+    CAPTURE_TRIG_NOW = 0,
+    // trigger when a sample is at or above the level
+    CAPTURE_TRIG_ABOVE,
+    // trigger when a sample is at or below the level
+    CAPTURE_TRIG_BELOW,
+    // trigger when the samples go from below the level to at or above it
+    CAPTURE_TRIG_RISE,
+    // trigger when the samples go from above the level to at or below it
+    CAPTURE_TRIG_FALL
+} capture_trig_t;
+
+// start capturing. pre samples are kept from before the trigger, and post
+// samples after it. pre+post must be less than CAPTURE_BUF_SIZE, since the
+// trigger sample needs a spot too. returns false if it's too many.
+// level is in raw AD1 counts. refused while the capture is being dumped.
+bool capture_arm(uint32_t pre, uint32_t post,
+    capture_trig_t trig, int32_t level);
+// stop capturing and throw away the samples
+// returns false if the capture is being dumped, so they have to stay
+bool capture_abort(void);
+// called by the system job to notice when the capture is done
+void capture_process(void);
+capture_state_t capture_get_state(void);
+
+// how many samples there are to look at. 0 if the capture isn't done
+uint32_t capture_get_count(void);
+// which of those samples was the trigger
+uint32_t capture_get_trigger_index(void);
+// get sample number index, from 0 up to capture_get_count()
+// returns false if there's no such sample
+bool capture_get_sample(uint32_t index, capture_sample_t* sample);
+
+// send the capture out with the dumper. returns false if the capture isn't
+// done or the dumper is busy with something else
+bool capture_dump(dump_dest_t dest);
+// true while the dumper is sending the capture out
+bool capture_is_dumping(void);
+
+// called by the acquisition job with every AD1 sample
+// this happens at the HY3131's full rate, so it must be quick!
+void capture_put_sample(int32_t ad1, uint32_t time_us);
+
+#endif
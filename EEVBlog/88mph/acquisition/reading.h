@@ -63,6 +63,8 @@ typedef enum {
 // this controls the reading's kind, and thus its fate
 typedef enum {
     RDG_KIND_MAIN, // main screen reading
+    RDG_KIND_SUB, // sub screen reading, e.g. a dB level
+    RDG_NUM_KINDS
 } rdg_kind_t;
 
 typedef struct {
@@ -73,6 +75,10 @@ typedef struct {
     // the milliseconds the reading was taken at
     // used for logging purposes
     uint32_t time_ms;
+    // the microsecond timestamp of the HY3131 interrupt the reading came from
+    // this is much more precise, but it wraps every 71.6 minutes
+    // used for anything that cares about the exact sample timing
+    uint32_t time_us;
     // the base unit of the reading
     rdg_unit_t unit;
     // the unit's exponent and decimal position
@@ -83,6 +89,22 @@ typedef struct {
     rdg_decimal_t decimal;
     // what the reading's purpose is in life
     rdg_kind_t kind;
+    // for readings out of the RMS converter, the mean square in square
+    // millicounts. averaging has to happen before the root, so the
+    // acquisition leaves millicounts at 0 and the measurement mode roots this
+    // once per displayed reading. 0 for everything else
+    uint64_t mean_square;
 } reading_t;
 
+// readings get passed between jobs in queues
+// this tracks how well a queue is keeping up
+typedef struct {
+    // how many readings were put in
+    uint32_t puts;
+    // how many were dropped because the queue was full
+    uint32_t drops;
+    // the most readings that have ever been in the queue at once
+    uint32_t max_depth;
+} rdg_queue_stats_t;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+
+#include "acquisition/thermocouple.h"
+
+#include "acquisition/typek_table.h"
+#include "system/clock.h"
+
+#define TC_TYPEK_STEP (1<<TC_TYPEK_SHIFT)
+
+// microvolts to thousandths of a degree C
+HOT_FUNC int32_t tc_uv_to_mdegc(int32_t uv) {
+    if (uv <= TC_TYPEK_MIN_UV) {
+        return tc_typek_mdegc[0];
+    } else if (uv > TC_TYPEK_MAX_UV) {
+        uv = TC_TYPEK_MAX_UV;
+    }
+    // the table is evenly spaced, so the entry below is just a shift away
+    uint32_t off = (uint32_t)(uv - TC_TYPEK_MIN_UV);
+    uint32_t i = off >> TC_TYPEK_SHIFT;
+    int32_t frac = (int32_t)(off & (TC_TYPEK_STEP-1));
+    int32_t t0 = tc_typek_mdegc[i];
+    // entries are at most 2C apart, so this can't overflow
+    return t0 + (((tc_typek_mdegc[i+1]-t0)*frac) >> TC_TYPEK_SHIFT);
+}
+
+// and back, for cold junction compensation
+int32_t tc_mdegc_to_uv(int32_t mdegc) {
+    if (mdegc <= tc_typek_mdegc[0]) {
+        return TC_TYPEK_MIN_UV;
+    }
+    // the temperatures always go up, so find the pair around it
+    uint32_t lo = 0, hi = TC_TYPEK_ENTRIES-1;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo+hi)/2;
+        if (tc_typek_mdegc[mid] <= mdegc) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    int32_t span = tc_typek_mdegc[hi] - tc_typek_mdegc[lo];
+    int32_t frac = mdegc - tc_typek_mdegc[lo];
+    if (frac > span) {
+        frac = span;
+    }
+    return TC_TYPEK_MIN_UV + (int32_t)(lo << TC_TYPEK_SHIFT) +
+        (frac << TC_TYPEK_SHIFT)/span;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef ACQUISITION_THERMOCOUPLE_H
+#define ACQUISITION_THERMOCOUPLE_H
+
+#include <stdint.h>
+
+// this file converts between type K thermocouple voltage and temperature
+// the table in typek_table.c is generated by tools/gen_typek.py from the
+// NIST reference function, and gen_typek.py --check checks this math
+// against it. if you change one, change the other!
+
+// microvolts to thousandths of a degree C
+// it's a shift, a mask and one multiply, so it's fine for every sample.
+// voltages off the end of the table are clamped to -200C and 1372C
+int32_t tc_uv_to_mdegc(int32_t uv);
+
+// and back, for cold junction compensation. this has to search the table,
+// so don't call it for every sample
+int32_t tc_mdegc_to_uv(int32_t mdegc);
+
+#endif
\ No newline at end of file
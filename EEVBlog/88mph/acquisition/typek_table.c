@@ -0,0 +1,145 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// generated by tools/gen_typek.py, don't edit!
+
+#include <stdint.h>
+
+#include "acquisition/typek_table.h"
+
+const int32_t tc_typek_mdegc[TC_TYPEK_ENTRIES] = {
+    -199777, -195694, -191791, -188044, -184433, -180943, -177561, -174277,
+    -171081, -167965, -164924, -161951, -159041, -156190, -153394, -150649,
+    -147952, -145299, -142690, -140120, -137589, -135093, -132632, -130203,
+    -127805, -125436, -123095, -120782, -118494, -116230, -113991, -111773,
+    -109578, -107404, -105249, -103114, -100998, -98900, -96819, -94754,
+    -92706, -90674, -88656, -86654, -84665, -82690, -80728, -78780,
+    -76843, -74919, -73006, -71105, -69215, -67336, -65467, -63608,
+    -61759, -59919, -58089, -56268, -54455, -52652, -50856, -49069,
+    -47289, -45518, -43753, -41997, -40247, -38504, -36768, -35039,
+    -33316, -31600, -29890, -28186, -26487, -24795, -23108, -21427,
+    -19750, -18080, -16414, -14753, -13097, -11445, -9798, -8155,
+    -6517, -4882, -3251, -1624, 0, 1621, 3238, 4853,
+    6464, 8072, 9678, 11280, 12880, 14477, 16072, 17664,
+    19253, 20840, 22424, 24006, 25586, 27164, 28739, 30313,
+    31884, 33453, 35021, 36586, 38150, 39712, 41273, 42832,
+    44389, 45945, 47499, 49052, 50604, 52155, 53704, 55253,
+    56800, 58346, 59892, 61437, 62981, 64524, 66067, 67609,
+    69151, 70692, 72233, 73774, 75315, 76855, 78396, 79936,
+    81477, 83018, 84559, 86100, 87642, 89184, 90726, 92269,
+    93813, 95357, 96902, 98448, 99994, 101542, 103090, 104640,
+    106190, 107742, 109295, 110848, 112404, 113960, 115517, 117076,
+    118637, 120198, 121761, 123326, 124891, 126459, 128027, 129598,
+    131169, 132742, 134317, 135893, 137470, 139049, 140630, 142211,
+    143795, 145379, 146965, 148552, 150140, 151730, 153321, 154913,
+    156506, 158100, 159695, 161292, 162889, 164487, 166085, 167685,
+    169285, 170886, 172487, 174089, 175691, 177294, 178897, 180500,
+    182104, 183708, 185311, 186915, 188519, 190122, 191726, 193329,
+    194932, 196534, 198136, 199738, 201339, 202940, 204540, 206139,
+    207738, 209336, 210934, 212530, 214126, 215721, 217315, 218908,
+    220500, 222091, 223682, 225271, 226859, 228446, 230033, 231618,
+    233202, 234785, 236367, 237948, 239527, 241106, 242684, 244260,
+    245836, 247410, 248984, 250556, 252127, 253697, 255266, 256834,
+    258402, 259968, 261533, 263097, 264660, 266222, 267783, 269343,
+    270903, 272461, 274019, 275575, 277131, 278686, 280240, 281793,
+    283346, 284897, 286448, 287998, 289547, 291096, 292644, 294191,
+    295737, 297283, 298828, 300372, 301916, 303459, 305002, 306543,
+    308085, 309625, 311165, 312705, 314243, 315782, 317319, 318856,
+    320393, 321929, 323465, 325000, 326534, 328068, 329602, 331135,
+    332667, 334200, 335731, 337262, 338793, 340323, 341853, 343382,
+    344911, 346440, 347968, 349495, 351022, 352549, 354076, 355601,
+    357127, 358652, 360177, 361701, 363225, 364749, 366272, 367795,
+    369317, 370839, 372361, 373882, 375403, 376923, 378443, 379963,
+    381483, 383002, 384520, 386039, 387557, 389074, 390592, 392109,
+    393625, 395142, 396658, 398174, 399689, 401204, 402719, 404233,
+    405747, 407261, 408774, 410288, 411800, 413313, 414825, 416337,
+    417849, 419360, 420872, 422382, 423893, 425403, 426913, 428423,
+    429933, 431442, 432951, 434460, 435968, 437476, 438984, 440492,
+    442000, 443507, 445014, 446521, 448027, 449534, 451040, 452546,
+    454052, 455557, 457063, 458568, 460073, 461578, 463082, 464587,
+    466091, 467595, 469099, 470603, 472106, 473610, 475113, 476616,
+    478119, 479622, 481125, 482628, 484130, 485632, 487135, 488637,
+    490139, 491641, 493142, 494644, 496146, 497647, 499149, 500650,
+    502151, 503653, 505154, 506655, 508156, 509657, 511158, 512659,
+    514159, 515660, 517161, 518662, 520162, 521663, 523164, 524664,
+    526165, 527666, 529166, 530667, 532167, 533668, 535169, 536670,
+    538170, 539671, 541172, 542673, 544174, 545674, 547175, 548676,
+    550178, 551679, 553180, 554681, 556183, 557684, 559186, 560687,
+    562189, 563691, 565193, 566695, 568197, 569700, 571202, 572705,
+    574207, 575710, 577213, 578716, 580219, 581723, 583226, 584730,
+    586234, 587738, 589242, 590747, 592251, 593756, 595261, 596766,
+    598272, 599777, 601283, 602789, 604295, 605802, 607308, 608815,
+    610322, 611830, 613337, 614845, 616353, 617861, 619370, 620879,
+    622388, 623897, 625407, 626917, 628427, 629937, 631448, 632959,
+    634471, 635982, 637494, 639006, 640519, 642032, 643545, 645058,
+    646572, 648086, 649601, 651116, 652631, 654146, 655662, 657178,
+    658695, 660212, 661729, 663247, 664765, 666283, 667802, 669321,
+    670840, 672360, 673880, 675401, 676922, 678443, 679965, 681487,
+    683010, 684533, 686056, 687580, 689104, 690629, 692154, 693679,
+    695205, 696732, 698259, 699786, 701313, 702842, 704370, 705899,
+    707429, 708959, 710489, 712020, 713551, 715083, 716615, 718148,
+    719681, 721215, 722749, 724283, 725818, 727354, 728890, 730427,
+    731964, 733501, 735039, 736578, 738117, 739656, 741196, 742737,
+    744278, 745819, 747362, 748904, 750447, 751991, 753535, 755080,
+    756625, 758171, 759717, 761264, 762811, 764359, 765907, 767456,
+    769006, 770556, 772107, 773658, 775209, 776762, 778314, 779868,
+    781422, 782976, 784531, 786087, 787643, 789200, 790757, 792315,
+    793873, 795432, 796992, 798552, 800113, 801674, 803236, 804798,
+    806361, 807925, 809489, 811054, 812619, 814185, 815752, 817319,
+    818887, 820455, 822024, 823594, 825164, 826734, 828306, 829878,
+    831450, 833023, 834597, 836171, 837746, 839322, 840898, 842475,
+    844052, 845630, 847209, 848788, 850368, 851948, 853529, 855111,
+    856693, 858276, 859860, 861444, 863029, 864614, 866200, 867787,
+    869374, 870962, 872550, 874139, 875729, 877320, 878911, 880502,
+    882095, 883688, 885281, 886875, 888470, 890066, 891662, 893259,
+    894856, 896454, 898053, 899652, 901252, 902853, 904454, 906056,
+    907659, 909262, 910866, 912470, 914075, 915681, 917288, 918895,
+    920503, 922111, 923720, 925330, 926940, 928551, 930163, 931776,
+    933389, 935002, 936617, 938232, 939848, 941464, 943081, 944699,
+    946317, 947936, 949556, 951177, 952798, 954420, 956042, 957665,
+    959289, 960914, 962539, 964165, 965791, 967419, 969047, 970675,
+    972305, 973935, 975566, 977197, 978829, 980462, 982096, 983730,
+    985365, 987001, 988637, 990275, 991912, 993551, 995190, 996830,
+    998471, 1000113, 1001755, 1003398, 1005042, 1006686, 1008331, 1009977,
+    1011624, 1013271, 1014919, 1016568, 1018218, 1019868, 1021519, 1023171,
+    1024824, 1026477, 1028132, 1029787, 1031442, 1033099, 1034756, 1036414,
+    1038073, 1039733, 1041393, 1043054, 1044716, 1046379, 1048043, 1049707,
+    1051373, 1053039, 1054706, 1056373, 1058042, 1059711, 1061381, 1063052,
+    1064724, 1066397, 1068070, 1069745, 1071420, 1073096, 1074773, 1076451,
+    1078130, 1079809, 1081490, 1083171, 1084853, 1086536, 1088220, 1089905,
+    1091591, 1093278, 1094965, 1096654, 1098343, 1100033, 1101725, 1103417,
+    1105110, 1106804, 1108499, 1110195, 1111892, 1113590, 1115289, 1116989,
+    1118689, 1120391, 1122094, 1123798, 1125503, 1127208, 1128915, 1130623,
+    1132332, 1134041, 1135752, 1137464, 1139177, 1140891, 1142606, 1144322,
+    1146039, 1147758, 1149477, 1151197, 1152919, 1154641, 1156365, 1158089,
+    1159815, 1161542, 1163270, 1165000, 1166730, 1168461, 1170194, 1171928,
+    1173663, 1175399, 1177136, 1178874, 1180614, 1182355, 1184097, 1185840,
+    1187584, 1189330, 1191077, 1192825, 1194574, 1196324, 1198076, 1199829,
+    1201583, 1203339, 1205096, 1206854, 1208613, 1210373, 1212135, 1213899,
+    1215663, 1217429, 1219196, 1220964, 1222734, 1224505, 1226278, 1228051,
+    1229827, 1231603, 1233381, 1235160, 1236941, 1238723, 1240506, 1242291,
+    1244077, 1245864, 1247653, 1249444, 1251235, 1253029, 1254823, 1256619,
+    1258417, 1260216, 1262016, 1263818, 1265621, 1267426, 1269232, 1271040,
+    1272849, 1274659, 1276471, 1278285, 1280100, 1281916, 1283734, 1285554,
+    1287375, 1289197, 1291021, 1292847, 1294674, 1296502, 1298332, 1300164,
+    1301997, 1303831, 1305668, 1307505, 1309344, 1311185, 1313027, 1314870,
+    1316716, 1318562, 1320410, 1322260, 1324111, 1325964, 1327818, 1329674,
+    1331531, 1333390, 1335250, 1337111, 1338974, 1340839, 1342705, 1344573,
+    1346442, 1348312, 1350184, 1352057, 1353932, 1355808, 1357686, 1359565,
+    1361445, 1363327, 1365210, 1367095, 1368981, 1370868, 1372757,
+};
\ No newline at end of file
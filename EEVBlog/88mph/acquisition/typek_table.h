@@ -0,0 +1,35 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// generated by tools/gen_typek.py, don't edit!
+
+#ifndef ACQUISITION_TYPEK_TABLE_H
+#define ACQUISITION_TYPEK_TABLE_H
+
+#include <stdint.h>
+
+// type K temperature in thousandths of a degree C at every
+// (1<<TC_TYPEK_SHIFT) microvolts from TC_TYPEK_MIN_UV
+#define TC_TYPEK_MIN_UV (-5888)
+#define TC_TYPEK_MAX_UV (54886)
+#define TC_TYPEK_SHIFT (6)
+#define TC_TYPEK_ENTRIES (951)
+
+extern const int32_t tc_typek_mdegc[TC_TYPEK_ENTRIES];
+
+#endif
\ No newline at end of file
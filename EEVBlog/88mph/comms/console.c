@@ -0,0 +1,833 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "comms/console.h"
+
+#include "comms/uart.h"
+#include "comms/stream.h"
+#include "system/job.h"
+#include "system/profile.h"
+#include "system/text.h"
+#include "system/idle.h"
+#include "system/clock.h"
+#include "system/boot.h"
+#include "system/deadline.h"
+#include "system/trace.h"
+#include "system/stack.h"
+#include "system/bench.h"
+#include "system/health.h"
+#include "measurement/measurement.h"
+#include "measurement/meas_modes.h"
+#include "measurement/bus.h"
+#include "measurement/minmax.h"
+#include "measurement/autohold.h"
+#include "measurement/relative.h"
+#include "measurement/decibel.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "acquisition/capture.h"
+#include "acquisition/acq_mode_cont.h"
+#include "storage/dump.h"
+#include "storage/logger.h"
+
+// the most bytes we'll look at in one call to console_process
+#define CONSOLE_MAX_BYTES (32)
+// the longest command line we accept
+#define CONSOLE_LINE_SIZE (48)
+// the most words in one command line, including the command
+#define CONSOLE_MAX_ARGS (6)
+
+static char line[CONSOLE_LINE_SIZE];
+static uint8_t line_len = 0;
+// set if the line got too long, so we throw the whole thing out
+static bool line_overflowed = false;
+
+// replies are built up here, then sent as a frame
+static char out[STREAM_MAX_PAYLOAD];
+static uint8_t out_len = 0;
+
+// the help is much more than fits in the UART buffer, so it's sent a line
+// at a time as the buffer drains. this is the next command to list, and
+// help_running is set until they've all gone out
+static uint8_t help_next = 0;
+static bool help_running = false;
+
+void console_init(void) {
+    line_len = 0;
+    line_overflowed = false;
+    out_len = 0;
+    help_running = false;
+}
+
+// send the reply line built so far, if there is one
+// if the UART is too busy, it's lost and this returns false. we never wait.
+static bool out_end(void) {
+    if (!out_len) {
+        return true;
+    }
+    bool sent = stream_send_frame(STREAM_FRAME_CONSOLE, (uint8_t*)out,
+        out_len);
+    out_len = 0;
+    return sent;
+}
+
+static void out_str(const char* s) {
+    while (*s && out_len < STREAM_MAX_PAYLOAD) {
+        out[out_len++] = *s++;
+    }
+}
+
+static void out_uint(uint32_t v) {
+    char buf[11];
+    buf[text_put_uint(buf, v)] = '\0';
+    out_str(buf);
+}
+
+static void out_int(int32_t v) {
+    char buf[12];
+    buf[text_put_int(buf, v)] = '\0';
+    out_str(buf);
+}
+
+// out_str, then a number, then a space
+static void out_field(const char* name, uint32_t v) {
+    out_str(name);
+    out_uint(v);
+    out_str(" ");
+}
+
+// parse a decimal number. returns false if it's not one, or it doesn't
+// fit in 32 bits
+static bool parse_uint(const char* s, uint32_t* v) {
+    if (!s || !*s) return false;
+    uint32_t n = 0;
+    while (*s) {
+        if (*s < '0' || *s > '9') return false;
+        uint32_t d = (uint32_t)(*s++ - '0');
+        if (n > (UINT32_MAX - d)/10) return false;
+        n = n*10 + d;
+    }
+    *v = n;
+    return true;
+}
+
+// same, but there may be a minus sign
+static bool parse_int(const char* s, int32_t* v) {
+    uint32_t n;
+    if (s && *s == '-') {
+        if (!parse_uint(s+1, &n)) return false;
+        *v = -(int32_t)n;
+        return true;
+    }
+    if (!parse_uint(s, &n)) return false;
+    *v = (int32_t)n;
+    return true;
+}
+
+// the commands!
+// argv[0] is the command name, and argc is at least 1
+
+static void cmd_help(int argc, char** argv);
+
+// names for the measurement modes, in the same order as meas_mode_t
+// modes whose register setup hasn't been captured from the stock firmware
+// yet have no name, so they can't be picked
+static const char* const mode_names[MEAS_NUM_MODES] = {
+    "off",
+    "vdc",
+    NULL, // vac
+    NULL, // aac
+    NULL, // hz
+    NULL, // vdual
+    NULL, // cont
+    NULL, // temp
+    NULL // cap
+};
+
+static void cmd_mode(int argc, char** argv) {
+    if (argc == 2) {
+        for (int mi=0; mi<sizeof(mode_names)/sizeof(mode_names[0]); mi++) {
+            if (mode_names[mi] && !strcmp(argv[1], mode_names[mi])) {
+                meas_set_mode((meas_mode_t)mi);
+                out_str("ok");
+                return;
+            }
+        }
+    }
+    out_str("modes:");
+    for (int mi=0; mi<sizeof(mode_names)/sizeof(mode_names[0]); mi++) {
+        if (mode_names[mi]) {
+            out_str(" ");
+            out_str(mode_names[mi]);
+        }
+    }
+}
+
+static void cmd_range(int argc, char** argv) {
+    uint32_t v;
+    if (argc == 2 && parse_uint(argv[1], &v) && v < 256) {
+        meas_set_range((uint8_t)v);
+    }
+    out_field("range ", meas_get_range());
+}
+
+static void cmd_filter(int argc, char** argv) {
+    uint32_t v;
+    if (argc == 2 && parse_uint(argv[1], &v) && v < 256) {
+        meas_set_filter((uint8_t)v);
+    }
+    out_field("filter ", meas_get_filter());
+}
+
+static void cmd_rate(int argc, char** argv) {
+    uint32_t v;
+    if (argc == 2 && parse_uint(argv[1], &v) && v < 256) {
+        stream_set_rate((uint8_t)v);
+        out_str("ok");
+    } else {
+        out_str("usage: rate LOG2_DECIMATION");
+    }
+}
+
+static void cmd_stream(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "on")) {
+        stream_set_enabled(true);
+    } else if (argc == 2 && !strcmp(argv[1], "off")) {
+        stream_set_enabled(false);
+    } else {
+        out_str("usage: stream on|off");
+        return;
+    }
+    out_str("ok");
+}
+
+static void cmd_baud(int argc, char** argv) {
+    uint32_t v, min, max;
+    uart_get_baud_range(&min, &max);
+    if (argc == 2) {
+        if (!parse_uint(argv[1], &v) || v < min || v > max) {
+            // still at the old rate, so the PC can hear this
+            out_field("baud must be from ", min);
+            out_field("to ", max);
+            return;
+        }
+        // say goodbye at the old rate, since the PC won't hear it otherwise
+        out_field("baud ", v);
+        out_end();
+        uart_set_baud(v);
+        return;
+    } else if (argc != 1) {
+        out_str("usage: baud [N]");
+        return;
+    }
+    out_field("baud ", uart_get_baud());
+}
+
+static void out_queue_stats(const char* name, rdg_queue_stats_t* qs) {
+    out_str(name);
+    out_field(" puts ", qs->puts);
+    out_field("drops ", qs->drops);
+    out_field("max ", qs->max_depth);
+}
+
+static const char* const bus_sub_names[BUS_NUM_SUBS] = {
+    "disp", "bar", "stream", "log"
+};
+
+static const char* const work_level_names[JOB_NUM_LEVELS] = {
+    "work_hi", "work", "work_lo"
+};
+
+static void cmd_stats(int argc, char** argv) {
+    rdg_queue_stats_t qs;
+    acq_get_queue_stats(&qs);
+    out_queue_stats("acq", &qs);
+    out_end();
+    for (int si=0; si<BUS_NUM_SUBS; si++) {
+        bus_get_stats((bus_sub_t)si, &qs);
+        out_queue_stats(bus_sub_names[si], &qs);
+        out_end();
+    }
+    for (int li=0; li<JOB_NUM_LEVELS; li++) {
+        job_work_stats_t ws;
+        job_get_work_stats((job_level_t)li, &ws);
+        out_str(work_level_names[li]);
+        out_field(" runs ", ws.runs);
+        out_field("drops ", ws.drops);
+        out_end();
+    }
+
+    stream_stats_t ss;
+    stream_get_stats(&ss);
+    out_field("stream sent ", ss.frames_sent);
+    out_field("dropped ", ss.frames_dropped);
+    out_field("skipped ", ss.readings_skipped);
+    out_field("decim ", ss.decimation);
+}
+
+static const char* const prof_names[PROF_NUM_COUNTERS] = {
+    "acq", "meas", "sys", "10ms", "work_hi", "work", "work_lo"
+};
+
+static void cmd_prof(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        prof_reset();
+        out_str("ok");
+        return;
+    }
+    for (int pi=0; pi<PROF_NUM_COUNTERS; pi++) {
+        prof_counter_t pc;
+        prof_get((prof_counter_id_t)pi, &pc);
+        out_str(prof_names[pi]);
+        out_field(" runs ", pc.runs);
+        out_field("last ", pc.last_us);
+        out_field("max ", pc.max_us);
+        out_field("avg ", pc.runs ? pc.total_us/pc.runs : 0);
+        if (pi < PROF_NUM_COUNTERS-1) {
+            out_end();
+        }
+    }
+}
+
+// names for the capture triggers, in the same order as capture_trig_t
+static const char* const trig_names[] = {
+    "now", "above", "below", "rise", "fall"
+};
+
+static const char* const capture_state_names[] = {
+    "idle", "armed", "triggered", "done"
+};
+
+static void cmd_capture(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "abort")) {
+        if (!capture_abort()) {
+            out_str("capture is being dumped");
+            return;
+        }
+    } else if (argc >= 3) {
+        uint32_t pre, post;
+        int32_t level = 0;
+        int ti = 0;
+        bool ok = parse_uint(argv[1], &pre) && parse_uint(argv[2], &post);
+        if (ok && argc >= 4) {
+            for (ti=0; ti<sizeof(trig_names)/sizeof(trig_names[0]); ti++) {
+                if (!strcmp(argv[3], trig_names[ti])) break;
+            }
+            ok = ti < sizeof(trig_names)/sizeof(trig_names[0]);
+            // everything but now needs a level
+            if (ok && ti != CAPTURE_TRIG_NOW) {
+                ok = argc == 5 && parse_int(argv[4], &level);
+            }
+        }
+        if (!ok) {
+            out_str("usage: capture PRE POST [now|above|below|rise|fall LEVEL]");
+            return;
+        }
+        if (capture_is_dumping()) {
+            out_str("capture is being dumped");
+            return;
+        }
+        if (!capture_arm(pre, post, (capture_trig_t)ti, level)) {
+            out_field("too many samples, max ", CAPTURE_BUF_SIZE);
+            return;
+        }
+    }
+    out_str("capture ");
+    out_str(capture_state_names[capture_get_state()]);
+    out_str(" ");
+    out_field("samples ", capture_get_count());
+    out_field("trig ", capture_get_trigger_index());
+}
+
+static const char* const dump_status_names[] = {
+    "idle", "busy", "failed"
+};
+
+static void cmd_dump(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "abort")) {
+        dump_abort();
+    } else if (argc == 2 && (!strcmp(argv[1], "uart") ||
+            !strcmp(argv[1], "sd"))) {
+        dump_dest_t dest = argv[1][0] == 'u' ? DUMP_TO_UART : DUMP_TO_SD;
+        if (!capture_dump(dest)) {
+            out_str("can't dump now");
+            return;
+        }
+    } else if (argc != 1) {
+        out_str("usage: dump [uart|sd|abort]");
+        return;
+    }
+    uint32_t done, total;
+    dump_status_t status = dump_get_status(&done, &total);
+    out_str("dump ");
+    out_str(dump_status_names[status]);
+    out_str(" ");
+    out_field("done ", done);
+    out_field("of ", total);
+}
+
+static const char* const idle_state_names[IDLE_NUM_STATES] = {
+    "run", "sleep", "tickless", "stop"
+};
+
+static void cmd_power(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        idle_reset_residency();
+        out_str("ok");
+        return;
+    }
+    idle_residency_t r;
+    idle_get_residency(&r);
+    for (int si=0; si<IDLE_NUM_STATES; si++) {
+        out_str(idle_state_names[si]);
+        out_field(" ms ", (uint32_t)(r.us[si]/1000));
+        out_field("entries ", r.entries[si]);
+        if (si < IDLE_NUM_STATES-1) {
+            out_end();
+        }
+    }
+}
+
+static const char* const clock_level_names[CLOCK_NUM_LEVELS] = {
+    "low", "normal", "high"
+};
+
+static void cmd_clock(int argc, char** argv) {
+    out_str("clock ");
+    out_str(clock_level_names[clock_get_level()]);
+    out_str(" ");
+    out_field("hz ", clock_get_hclk());
+    out_field("reqs ", clock_get_requests());
+    out_end();
+    out_str("switches");
+    for (int li=0; li<CLOCK_NUM_LEVELS; li++) {
+        out_str(" ");
+        out_str(clock_level_names[li]);
+        out_str(" ");
+        out_uint(clock_get_switches((clock_level_t)li));
+    }
+}
+
+static const char* const bench_names[BENCH_NUM_COUNTERS] = {
+    "acq", "hy_read"
+};
+
+static void cmd_bench(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        bench_reset();
+        out_str("ok");
+        return;
+    }
+    out_field("bench hz ", clock_get_hclk());
+    out_field("ws ", clock_get_latency());
+    out_field("ram ", CLOCK_HOT_IN_RAM);
+    for (int bi=0; bi<BENCH_NUM_COUNTERS; bi++) {
+        bench_counter_t bc;
+        bench_get((bench_counter_id_t)bi, &bc);
+        out_end();
+        out_str(bench_names[bi]);
+        out_field(" runs ", bc.runs);
+        out_field("min ", bc.runs ? bc.min : 0);
+        out_field("max ", bc.max);
+        out_field("avg ", bc.runs ? (uint32_t)(bc.total/bc.runs) : 0);
+    }
+}
+
+static const char* const deadline_event_names[DEADLINE_NUM_EVENTS] = {
+    "acq_late", "acq_missed", "meas_backlog", "meas_drop", "10ms_overrun"
+};
+
+static void cmd_deadline(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        deadline_reset();
+    } else if (argc == 3 && !strcmp(argv[1], "icon")) {
+        deadline_set_icon(!strcmp(argv[2], "on"));
+    } else if (argc != 1) {
+        out_str("usage: deadline [reset|icon on|off]");
+        return;
+    }
+    out_str(deadline_get_icon() ? "icon on" : "icon off");
+    for (int ei=0; ei<DEADLINE_NUM_EVENTS; ei++) {
+        out_end();
+        out_str(deadline_event_names[ei]);
+        out_field(" count ", deadline_get_count((deadline_event_t)ei));
+    }
+    // then the latest ones, newest first
+    deadline_entry_t e;
+    for (uint8_t age=0; deadline_get_entry(age, &e); age++) {
+        out_end();
+        out_str(deadline_event_names[e.event]);
+        out_field(" at_us ", e.time_us);
+        out_field("arg ", e.arg);
+    }
+}
+
+static void cmd_trace(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "on")) {
+        trace_start();
+    } else if (argc == 2 && !strcmp(argv[1], "off")) {
+        trace_stop();
+    } else if (argc == 2 && !strcmp(argv[1], "clear")) {
+        trace_clear();
+    } else if (argc == 2 && (!strcmp(argv[1], "uart") ||
+            !strcmp(argv[1], "sd"))) {
+        dump_dest_t dest = argv[1][0] == 'u' ? DUMP_TO_UART : DUMP_TO_SD;
+        if (!trace_dump(dest)) {
+            out_str("can't dump now");
+            return;
+        }
+    } else if (argc != 1) {
+        out_str("usage: trace [on|off|clear|uart|sd]");
+        return;
+    }
+    out_str(trace_is_running() ? "trace on " : "trace off ");
+    out_field("events ", trace_get_count());
+    out_field("lost ", trace_get_lost());
+}
+
+static const char* const boot_mark_names[BOOT_NUM_MARKS] = {
+    "loop", "lcd", "hy", "reading", "background"
+};
+
+static void cmd_boot(int argc, char** argv) {
+    out_str("boot ms");
+    for (int mi=0; mi<BOOT_NUM_MARKS; mi++) {
+        uint32_t ms;
+        if (boot_get_mark_ms((boot_mark_t)mi, &ms)) {
+            out_str(" ");
+            out_str(boot_mark_names[mi]);
+            out_str(" ");
+            out_uint(ms);
+        }
+    }
+}
+
+static void cmd_mem(int argc, char** argv) {
+    stack_usage_t su;
+    stack_get_usage(&su);
+    out_field("ram data ", su.data);
+    out_field("bss ", su.bss);
+    out_field("heap ", su.heap);
+    out_end();
+    out_field("stack size ", su.stack_size);
+    out_field("peak ", su.stack_peak);
+    out_field("now ", su.stack_now);
+    out_field("free ", su.stack_size - su.stack_peak);
+}
+
+static void cmd_health(int argc, char** argv) {
+    health_status_t hs;
+    health_get_status(&hs);
+    out_field("batt mv ", hs.batt_mv);
+    out_str(hs.batt_low ? "low " : "ok ");
+    out_field("vdda mv ", hs.vdda_mv);
+    out_end();
+    out_str("die mc ");
+    out_int(hs.die_temp_mc);
+    out_str(" ");
+    out_field("therm ", hs.thermistor);
+    out_field("scans ", hs.scans);
+    out_field("fails ", hs.power_fails);
+}
+
+static void cmd_minmax(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        minmax_session_reset();
+    }
+    minmax_session_t s;
+    if (!minmax_session_get(&s)) {
+        out_str("no readings");
+        return;
+    }
+    out_field("n ", s.mm.count);
+    out_field("unit ", s.unit);
+    out_field("exp ", s.exponent);
+    out_field("dp ", s.decimal);
+    out_end();
+    out_str("min ");
+    out_int(s.mm.min);
+    out_field(" @ms ", s.mm.min_ms);
+    out_str("max ");
+    out_int(s.mm.max);
+    out_field(" @ms ", s.mm.max_ms);
+    out_end();
+    out_str("mean ");
+    out_int(minmax_get_mean(&s.mm));
+    out_str(" ");
+    out_field("sd ", (uint32_t)minmax_get_stddev(&s.mm));
+}
+
+static void cmd_autohold(int argc, char** argv) {
+    uint32_t window, band;
+    if (argc == 2 && !strcmp(argv[1], "on")) {
+        autohold_enable(true);
+    } else if (argc == 2 && !strcmp(argv[1], "off")) {
+        autohold_enable(false);
+    } else if (argc == 3 && parse_uint(argv[1], &window) &&
+            parse_uint(argv[2], &band) && window <= 255) {
+        autohold_configure((uint8_t)window, (int32_t)band);
+    } else if (argc != 1) {
+        out_str("usage: autohold [on|off|WINDOW BAND]");
+        return;
+    }
+    uint8_t w;
+    int32_t b;
+    autohold_get_config(&w, &b);
+    out_str(autohold_is_enabled() ? "autohold on " : "autohold off ");
+    out_field("window ", w);
+    out_field("band ", (uint32_t)b);
+    reading_t held;
+    uint32_t locks;
+    if (autohold_get_held(&held, &locks)) {
+        out_field("locks ", locks);
+        out_str("held ");
+        out_int(held.millicounts);
+    }
+}
+
+static void cmd_rel(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "on")) {
+        rel_start();
+    } else if (argc == 2 && !strcmp(argv[1], "off")) {
+        rel_stop();
+    } else if (argc != 1) {
+        out_str("usage: rel [on|off]");
+        return;
+    }
+    reading_t ref;
+    if (!rel_is_on()) {
+        out_str("rel off");
+    } else if (!rel_get_reference(&ref)) {
+        out_str("rel waiting");
+    } else {
+        out_str("rel ");
+        out_int(ref.millicounts);
+    }
+}
+
+static const char* const db_mode_names[DB_NUM_MODES] = {
+    "off",
+    "dbm",
+    "dbv"
+};
+
+static void cmd_db(int argc, char** argv) {
+    uint32_t ohms;
+    if (argc >= 2 && argc <= 3) {
+        int mi;
+        for (mi=0; mi<DB_NUM_MODES; mi++) {
+            if (!strcmp(argv[1], db_mode_names[mi])) {
+                break;
+            }
+        }
+        if (mi == DB_NUM_MODES ||
+                (argc == 3 && (!parse_uint(argv[2], &ohms) || ohms == 0))) {
+            out_str("usage: db [off|dbm|dbv [OHMS]]");
+            return;
+        }
+        db_set_mode((db_mode_t)mi);
+        if (argc == 3) {
+            db_set_ref_ohms(ohms);
+        }
+    } else if (argc != 1) {
+        out_str("usage: db [off|dbm|dbv [OHMS]]");
+        return;
+    }
+    out_str("db ");
+    out_str(db_mode_names[db_get_mode()]);
+    out_str(" ");
+    out_field("ohms ", db_get_ref_ohms());
+}
+
+static void cmd_beep(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        acq_cont_reset_latency();
+    }
+    cont_latency_t l;
+    acq_cont_get_latency(&l);
+    out_field("beeps ", l.beeps);
+    out_field("us last ", l.last_us);
+    out_field("max ", l.max_us);
+    out_field("sample ", l.sample_us);
+}
+
+static void cmd_log(int argc, char** argv) {
+    uint32_t interval;
+    if (argc == 2 && !strcmp(argv[1], "stop")) {
+        logger_stop();
+    } else if ((argc == 2 || (argc == 3 && !strcmp(argv[2], "quiet"))) &&
+            parse_uint(argv[1], &interval)) {
+        if (!logger_start(interval, argc == 3)) {
+            out_str("can't log now");
+            return;
+        }
+    } else if (argc != 1) {
+        out_str("usage: log [SECONDS [quiet]|stop]");
+        return;
+    }
+    logger_status_t s;
+    logger_get_status(&s);
+    out_str(s.running ? "log on " : "log off ");
+    out_field("interval ", s.interval);
+    out_field("entries ", s.entries);
+    out_field("misses ", s.misses);
+    if (s.card_failed) {
+        out_str("card failed");
+    }
+    for (int mi=1; mi<MEAS_NUM_MODES; mi++) {
+        uint32_t settle_ms;
+        if (mode_names[mi] &&
+                logger_get_settle_ms((meas_mode_t)mi, &settle_ms)) {
+            out_end();
+            out_str(mode_names[mi]);
+            out_field(" settle ms ", settle_ms);
+        }
+    }
+}
+
+typedef struct {
+    const char* name;
+    void (*func)(int argc, char** argv);
+    const char* help;
+} console_cmd_t;
+
+static const console_cmd_t commands[] = {
+    {"help", cmd_help, "list commands"},
+    {"mode", cmd_mode, "[NAME] set measurement mode"},
+    {"range", cmd_range, "[N] set range of current mode"},
+    {"filter", cmd_filter, "[N] average N acquisitions"},
+    {"rate", cmd_rate, "N stream every 2^N readings at most"},
+    {"stream", cmd_stream, "on|off turn reading stream on/off"},
+    {"baud", cmd_baud, "[N] set UART baud rate"},
+    {"stats", cmd_stats, "show queue and stream statistics"},
+    {"prof", cmd_prof, "[reset] show job timing in us"},
+    {"bench", cmd_bench, "[reset] show hot path timing in cycles"},
+    {"power", cmd_power, "[reset] show time spent in each power state"},
+    {"clock", cmd_clock, "show clock speed and who wants it"},
+    {"boot", cmd_boot, "show how long each part of boot took"},
+    {"mem", cmd_mem, "show RAM use and deepest the stack has been"},
+    {"health", cmd_health, "show battery and temperature"},
+    {"deadline", cmd_deadline, "[reset|icon on|off] show missed deadlines"},
+    {"capture", cmd_capture, "[PRE POST [TRIG LEVEL]|abort] raw capture"},
+    {"dump", cmd_dump, "[uart|sd|abort] send out the capture"},
+    {"trace", cmd_trace, "[on|off|clear|uart|sd] record a timeline"},
+    {"minmax", cmd_minmax, "[reset] show min, max, mean and sd of readings"},
+    {"autohold", cmd_autohold, "[on|off|WINDOW BAND] hold settled readings"},
+    {"rel", cmd_rel, "[on|off] show readings relative to the next one"},
+    {"db", cmd_db, "[off|dbm|dbv [OHMS]] show volts in dB"},
+    {"beep", cmd_beep, "[reset] show continuity beeper latency in us"},
+    {"log", cmd_log, "[SECONDS [quiet]|stop] log to SD card"},
+};
+
+#define NUM_COMMANDS (sizeof(commands)/sizeof(commands[0]))
+
+// send as much of the help as fits. returns true once it's all gone
+static bool help_continue(void) {
+    while (help_next < NUM_COMMANDS) {
+        out_str(commands[help_next].name);
+        out_str(" ");
+        out_str(commands[help_next].help);
+        if (!out_end()) {
+            // come back when some of the buffer has gone out
+            uart_request_tx_wakeup();
+            return false;
+        }
+        help_next++;
+    }
+    return true;
+}
+
+static void cmd_help(int argc, char** argv) {
+    help_next = 0;
+    help_running = !help_continue();
+}
+
+// split the line into words and run the command
+static void execute_line(void) {
+    char* argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+
+    char* p = line;
+    while (*p && argc < CONSOLE_MAX_ARGS) {
+        while (*p == ' ') p++;
+        if (!*p) break;
+        argv[argc++] = p;
+        while (*p && *p != ' ') p++;
+        if (*p) *p++ = '\0';
+    }
+    // blank lines are fine, just ignore them
+    if (argc == 0) return;
+
+    for (int ci=0; ci<NUM_COMMANDS; ci++) {
+        if (!strcmp(argv[0], commands[ci].name)) {
+            commands[ci].func(argc, argv);
+            out_end();
+            return;
+        }
+    }
+    out_str("unknown command ");
+    out_str(argv[0]);
+    out_end();
+}
+
+// called by the system job to look at any received data
+// this handles at most one command per call. if there's more to do, it
+// schedules the system job again so the UI gets a turn in between.
+void console_process(void) {
+    if (help_running) {
+        // finish the help before looking at the next command
+        help_running = !help_continue();
+        if (help_running) {
+            return;
+        }
+    }
+    for (int bi=0; bi<CONSOLE_MAX_BYTES; bi++) {
+        uint8_t c;
+        if (!uart_read(&c, 1)) {
+            return;
+        }
+
+        if (c == '\r' || c == '\n') {
+            bool overflowed = line_overflowed;
+            line[line_len] = '\0';
+            line_len = 0;
+            line_overflowed = false;
+            if (overflowed) {
+                out_str("line too long");
+                out_end();
+            } else {
+                execute_line();
+            }
+            // that's enough for one turn
+            break;
+        } else if (line_len < CONSOLE_LINE_SIZE-1) {
+            line[line_len++] = (char)c;
+        } else {
+            line_overflowed = true;
+        }
+    }
+
+    // come back later for the rest
+    if (uart_rx_available()) {
+        job_schedule(JOB_SYSTEM);
+    }
+}
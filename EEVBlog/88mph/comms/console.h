@@ -0,0 +1,37 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef COMMS_CONSOLE_H
+#define COMMS_CONSOLE_H
+
+// this file is the command console that runs over the UART
+// commands are lines of text, and replies come back as STREAM_FRAME_CONSOLE
+// frames so they can share the link with the reading stream.
+// tools/console.py is the other end.
+
+// the console runs in the system job, which is the least important one,
+// so it can't hold up acquisition or measurement
+
+void console_init(void);
+
+// called by the system job to look at any received data
+// this handles at most one command per call. if there's more to do, it
+// schedules the system job again so the UI gets a turn in between.
+void console_process(void);
+
+#endif
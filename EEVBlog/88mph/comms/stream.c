@@ -0,0 +1,203 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "comms/stream.h"
+
+#include "comms/uart.h"
+#include "acquisition/reading.h"
+#include "measurement/bus.h"
+#include "system/job.h"
+
+static volatile bool stream_enabled = true;
+static uint8_t seq = 0;
+
+// readings are only sent once every 2^decimation times
+static uint8_t decimation = 0;
+static uint8_t min_decimation = 0;
+static uint8_t decim_count = 0;
+// how many frames have been sent in a row with plenty of room to spare
+static uint8_t relaxed_frames = 0;
+
+static stream_stats_t stats;
+
+// once this many frames go out with the buffer less than half full,
+// try sending readings twice as often
+#define RELAX_FRAMES (64)
+
+void stream_init(void) {
+    __disable_irq();
+    seq = 0;
+    decimation = min_decimation;
+    decim_count = 0;
+    relaxed_frames = 0;
+    stats = (stream_stats_t){0};
+    __enable_irq();
+    // keep a few readings around in case the system job is slow to get them
+    bus_subscribe(BUS_SUB_STREAM, 1, STREAM_QUEUE_DEPTH, JOB_SYSTEM);
+}
+
+// called by the system job to send the readings that have come in
+void stream_process(void) {
+    reading_t reading;
+    while (bus_get(BUS_SUB_STREAM, &reading)) {
+        stream_put_reading(&reading);
+    }
+}
+
+void stream_set_enabled(bool enabled) {
+    stream_enabled = enabled;
+}
+
+// never send more often than every 2^min_decimation readings
+// the stream can still decimate more than this if the UART can't keep up
+void stream_set_rate(uint8_t new_min_decimation) {
+    if (new_min_decimation > STREAM_MAX_DECIMATION) {
+        new_min_decimation = STREAM_MAX_DECIMATION;
+    }
+    // readings are put in by the system job, which might interrupt whoever
+    // is calling us
+    __disable_irq();
+    min_decimation = new_min_decimation;
+    decimation = new_min_decimation;
+    decim_count = 0;
+    relaxed_frames = 0;
+    __enable_irq();
+}
+
+// CRC-16/CCITT-FALSE, a nibble at a time so the table stays small
+static const uint16_t crc_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint16_t crc_update(uint16_t crc, const uint8_t* data, uint8_t len) {
+    for (int i=0; i<len; i++) {
+        crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (data[i] & 0xF)];
+    }
+    return crc;
+}
+
+// send an arbitrary frame. returns false if there wasn't room for it
+bool stream_send_frame(stream_frame_t type,
+        const uint8_t* payload, uint8_t len) {
+    uint8_t frame[4+STREAM_MAX_PAYLOAD+2];
+
+    if (len > STREAM_MAX_PAYLOAD) {
+        return false;
+    }
+
+    // sequence number and stats are shared by everyone sending frames
+    __disable_irq();
+    if (uart_tx_free() < len+6) {
+        stats.frames_dropped++;
+        __enable_irq();
+        return false;
+    }
+    // only sent frames get a number, so a gap on the PC means lost data
+    uint8_t this_seq = seq++;
+    __enable_irq();
+
+    frame[0] = STREAM_SYNC;
+    frame[1] = (uint8_t)type;
+    frame[2] = this_seq;
+    frame[3] = len;
+    for (int i=0; i<len; i++) {
+        frame[4+i] = payload[i];
+    }
+    uint16_t crc = crc_update(0xFFFF, &frame[1], len+3);
+    frame[4+len] = crc & 0xFF;
+    frame[5+len] = crc >> 8;
+
+    // someone could have written in between checking and here, but if so
+    // there's nothing to do but lose the frame
+    bool sent = uart_write(frame, len+6);
+    __disable_irq();
+    if (sent) {
+        stats.frames_sent++;
+    } else {
+        stats.frames_dropped++;
+        // the PC never saw this number, so give it back. if somebody else
+        // already took the next one, the gap is real, since this frame
+        // really was lost
+        if (seq == (uint8_t)(this_seq+1)) {
+            seq = this_seq;
+        }
+    }
+    __enable_irq();
+    return sent;
+}
+
+static void put_le32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+// offer a reading to the stream. it's sent, or skipped if the link is
+// too slow for every reading. never waits for the UART.
+void stream_put_reading(const reading_t* reading) {
+    if (!stream_enabled) return;
+
+    // skip readings evenly so the PC still sees a regular sample rate
+    decim_count++;
+    if (decim_count < (1U << decimation)) {
+        stats.readings_skipped++;
+        return;
+    }
+    decim_count = 0;
+
+    uint8_t payload[13];
+    put_le32(&payload[0], (uint32_t)reading->millicounts);
+    put_le32(&payload[4], reading->time_us);
+    payload[8] = (uint8_t)reading->unit;
+    payload[9] = (uint8_t)reading->exponent;
+    payload[10] = (uint8_t)reading->decimal;
+    payload[11] = (uint8_t)reading->kind;
+    payload[12] = decimation;
+
+    if (!stream_send_frame(STREAM_FRAME_READING, payload, sizeof(payload))) {
+        // the link can't keep up, so send half as many
+        if (decimation < STREAM_MAX_DECIMATION) {
+            decimation++;
+        }
+        relaxed_frames = 0;
+    } else if (uart_tx_free() > UART_TX_BUF_SIZE/2) {
+        // we've got lots of room, so maybe we can send more often
+        if (++relaxed_frames == RELAX_FRAMES) {
+            relaxed_frames = 0;
+            if (decimation > min_decimation) {
+                decimation--;
+            }
+        }
+    } else {
+        relaxed_frames = 0;
+    }
+    stats.decimation = decimation;
+}
+
+void stream_get_stats(stream_stats_t* out) {
+    __disable_irq();
+    *out = stats;
+    __enable_irq();
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef COMMS_STREAM_H
+#define COMMS_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/reading.h"
+
+// this file streams readings out of the UART in a compact binary format
+// so a PC can capture them live. tools/stream_decode.py is the other end.
+
+// every frame looks like this (multibyte values are little endian):
+//   byte 0: STREAM_SYNC
+//   byte 1: frame type (stream_frame_t)
+//   byte 2: sequence number, goes up by one for every frame sent
+//   byte 3: payload length
+//   then the payload
+//   then a CRC-16/CCITT-FALSE of everything from byte 1 to the payload's end
+#define STREAM_SYNC (0x88)
+#define STREAM_MAX_PAYLOAD (64)
+
+// do not change the values!! the host tool knows them
+typedef enum {
+    // payload is:
+    //   int32 millicounts, uint32 time_us,
+    //   uint8 unit, uint8 exponent, uint8 decimal, uint8 kind,
+    //   uint8 decimation (log2 of how many readings this one stands for)
+    STREAM_FRAME_READING = 1,
+    // payload is one line of text from the console, without a newline
+    STREAM_FRAME_CONSOLE = 2,
+    // payload is a piece of a dump, see storage/dump.h
+    STREAM_FRAME_DUMP = 3
+} stream_frame_t;
+
+// if the UART can't keep up, we only send every 2^decimation readings
+// this is the largest decimation we'll go to
+#define STREAM_MAX_DECIMATION (7)
+
+// how many readings can wait for the system job to send them
+#define STREAM_QUEUE_DEPTH (8)
+
+// this subscribes to the reading bus, so the bus must be inited first
+void stream_init(void);
+
+// called by the system job to send the readings that have come in
+void stream_process(void);
+
+// turn streaming of readings on or off. it starts out on
+void stream_set_enabled(bool enabled);
+
+// never send more often than every 2^min_decimation readings
+// the stream can still decimate more than this if the UART can't keep up
+void stream_set_rate(uint8_t min_decimation);
+
+// offer a reading to the stream. it's sent, or skipped if the link is
+// too slow for every reading. never waits for the UART.
+void stream_put_reading(const reading_t* reading);
+
+// send an arbitrary frame. returns false if there wasn't room for it
+bool stream_send_frame(stream_frame_t type,
+    const uint8_t* payload, uint8_t len);
+
+typedef struct {
+    uint32_t frames_sent;
+    // frames we tried to send but had no room for
+    uint32_t frames_dropped;
+    // readings skipped on purpose because of decimation
+    uint32_t readings_skipped;
+    uint8_t decimation;
+} stream_stats_t;
+
+void stream_get_stats(stream_stats_t* stats);
+
+#endif
@@ -0,0 +1,407 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "comms/uart.h"
+
+#include "system/job.h"
+#include "system/idle.h"
+#include "system/clock.h"
+
+#define TX_MASK (UART_TX_BUF_SIZE-1)
+
+static uint8_t tx_buf[UART_TX_BUF_SIZE];
+// data between tail and head is waiting to be sent (or is being sent)
+static volatile uint16_t tx_head = 0;
+static volatile uint16_t tx_tail = 0;
+// writers reserve space up to here before they copy their data in.
+// head catches up once nobody is in the middle of copying.
+static volatile uint16_t tx_reserve = 0;
+static volatile uint8_t tx_writers = 0;
+// how many bytes the DMA is currently sending. 0 if it's idle
+static volatile uint16_t tx_dma_len = 0;
+// set if the system job wants to know when the current chunk is done
+static volatile bool tx_wakeup = false;
+
+static uint8_t rx_buf[UART_RX_BUF_SIZE];
+// the DMA is the head, and it tells us where it is by counting down CNDTR
+static uint16_t rx_tail = 0;
+
+static uint32_t curr_baud = 0;
+// uart_set_baud doesn't wait around for the old data to go out. the DMA
+// stops at baud_at, where the buffer ended when it was asked, and the
+// TX complete interrupt switches to pending_baud once the last byte is out
+static volatile bool baud_pending = false;
+static volatile uint32_t pending_baud = 0;
+static volatile uint16_t baud_at = 0;
+
+// false until uart_init and after uart_deinit. nothing is sent then, since
+// the DMA would never finish and anybody flushing would wait forever
+static volatile bool uart_on = false;
+
+// main doesn't set up the USART any more, so it's done the first time
+// we're turned on. it's in main.c
+void MX_USART2_UART_Init(void);
+static bool cube_is_inited = false;
+
+// start the DMA on the next contiguous chunk of the buffer, if it's idle
+// must be called with interrupts disabled
+static void start_dma(void) {
+    if (tx_dma_len) return;
+    uint16_t h = tx_head;
+    uint16_t t = tx_tail;
+    if (h == t) return;
+    if (baud_pending) {
+        // the rest goes out at the new rate
+        if (t == baud_at) return;
+        if (((baud_at - t) & TX_MASK) < ((h - t) & TX_MASK)) {
+            h = baud_at;
+        }
+    }
+    // the DMA can't wrap around the end of the buffer,
+    // so send up to the end and get the rest next time
+    uint16_t len = (h > t) ? (h - t) : (UART_TX_BUF_SIZE - t);
+    DMA1_Channel7->CCR &= ~DMA_CCR_EN;
+    DMA1_Channel7->CMAR = (uint32_t)&tx_buf[t];
+    DMA1_Channel7->CNDTR = len;
+    tx_dma_len = len;
+    // so TC means this chunk is out, not some earlier one
+    USART2->SR = ~USART_SR_TC;
+    DMA1_Channel7->CCR |= DMA_CCR_EN;
+}
+
+// APB1 isn't divided, so the USART runs from HCLK. 8x oversampling can go
+// up to a clock's pclk/8, and BRR's 16 bits go down to pclk/0xFFFF
+// rates the low level can't make keep the clock at the normal level
+static bool needs_clock(uint32_t baud) {
+    return baud > clock_get_level_hclk(CLOCK_LEVEL_LOW)/8;
+}
+
+// set BRR for curr_baud from the current clock
+static void apply_baud(void) {
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    // BRR is the clock divider, in 16ths with 16x oversampling. with 8x
+    // it's the same number, only in 8ths
+    uint32_t div = (pclk + curr_baud/2)/curr_baud;
+    USART2->CR1 &= ~USART_CR1_UE;
+    if (div >= 16) {
+        USART2->CR1 &= ~USART_CR1_OVER8;
+        USART2->BRR = div;
+    } else {
+        // too fast for 16x oversampling, so drop to 8x
+        // the whole part still starts at bit 4, but the fraction is only
+        // 3 bits and bit 3 has to stay clear
+        USART2->CR1 |= USART_CR1_OVER8;
+        USART2->BRR = ((div & ~0x7U) << 1) | (div & 0x7U);
+    }
+    USART2->CR1 |= USART_CR1_UE;
+}
+
+// turn on the UART and its DMA
+void uart_init(void) {
+    // cube sets up the pins and the USART itself
+    if (!cube_is_inited) {
+        MX_USART2_UART_Init();
+        cube_is_inited = true;
+    }
+    // but we need the DMA too
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    __disable_irq();
+    tx_head = 0;
+    tx_tail = 0;
+    tx_reserve = 0;
+    tx_writers = 0;
+    tx_dma_len = 0;
+    baud_pending = false;
+    __enable_irq();
+
+    // channel 7 moves bytes from memory into the USART data register
+    DMA1_Channel7->CCR = 0;
+    DMA1_Channel7->CPAR = (uint32_t)&USART2->DR;
+    DMA1_Channel7->CCR = DMA_CCR_MINC | // step through the buffer
+                         DMA_CCR_DIR | // memory -> peripheral
+                         DMA_CCR_TCIE; // tell us when the chunk is done
+    DMA1->IFCR = DMA_IFCR_CGIF7;
+
+    // channel 6 moves bytes from the USART data register into rx_buf
+    // forever, going around in a circle
+    rx_tail = 0;
+    DMA1_Channel6->CCR = 0;
+    DMA1_Channel6->CPAR = (uint32_t)&USART2->DR;
+    DMA1_Channel6->CMAR = (uint32_t)rx_buf;
+    DMA1_Channel6->CNDTR = UART_RX_BUF_SIZE;
+    DMA1->IFCR = DMA_IFCR_CGIF6;
+    DMA1_Channel6->CCR = DMA_CCR_MINC | // step through the buffer
+                         DMA_CCR_CIRC | // and go around when it ends
+                         DMA_CCR_HTIE | // tell us when it's half full
+                         DMA_CCR_TCIE | // and completely full
+                         DMA_CCR_EN;
+
+    // let the USART ask the DMA for more bytes, or take the ones it has
+    USART2->CR3 |= USART_CR3_DMAT | USART_CR3_DMAR;
+    // and tell us when the receive line goes quiet
+    USART2->CR1 |= USART_CR1_IDLEIE;
+
+    uart_on = true;
+    // nothing has been sent yet, so there's nothing to wait for
+    curr_baud = UART_DEFAULT_BAUD;
+    apply_baud();
+
+    // the DMA can't run in STOP
+    idle_hold(IDLE_HOLD_UART);
+
+    NVIC_ClearPendingIRQ(DMA1_Channel7_IRQn);
+    NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+    NVIC_ClearPendingIRQ(DMA1_Channel6_IRQn);
+    NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+    NVIC_ClearPendingIRQ(USART2_IRQn);
+    NVIC_EnableIRQ(USART2_IRQn);
+}
+
+// turn it off again
+void uart_deinit(void) {
+    uart_on = false;
+    NVIC_DisableIRQ(USART2_IRQn);
+    NVIC_DisableIRQ(DMA1_Channel6_IRQn);
+    NVIC_DisableIRQ(DMA1_Channel7_IRQn);
+    // a baud change that didn't happen yet never will
+    USART2->CR1 &= ~(USART_CR1_IDLEIE | USART_CR1_TCIE);
+    baud_pending = false;
+    clock_release(CLOCK_REQ_UART);
+    USART2->CR3 &= ~(USART_CR3_DMAT | USART_CR3_DMAR);
+    DMA1_Channel6->CCR = 0;
+    DMA1_Channel7->CCR = 0;
+    tx_dma_len = 0;
+    idle_release(IDLE_HOLD_UART);
+}
+
+// wait for everything in the buffer to go out
+void uart_flush(void) {
+    if (!uart_on) return;
+    while (tx_dma_len || (tx_head != tx_tail));
+    while (!(USART2->SR & USART_SR_TC));
+}
+
+// the slowest and fastest rates uart_set_baud takes. they have to work at
+// every clock level the UART might end up running at
+void uart_get_baud_range(uint32_t* min, uint32_t* max) {
+    uint32_t fastest = clock_get_level_hclk(CLOCK_LEVEL_HIGH);
+    *min = (fastest + 0xFFFE)/0xFFFF;
+    *max = clock_get_level_hclk(CLOCK_LEVEL_NORMAL)/8;
+}
+
+// change the baud rate. data already written still goes out at the old
+// rate, and the change happens once it has, so this doesn't wait.
+// returns false if the rate is out of range.
+bool uart_set_baud(uint32_t baud) {
+    uint32_t min, max;
+    uart_get_baud_range(&min, &max);
+    if (baud < min || baud > max) {
+        return false;
+    }
+    if (!uart_on) {
+        curr_baud = baud;
+        return true;
+    }
+    // the old rate is fine at the faster clock too, so get it right away.
+    // it's let go once the switch happens
+    if (needs_clock(baud)) {
+        clock_request(CLOCK_REQ_UART);
+    }
+    __disable_irq();
+    pending_baud = baud;
+    baud_pending = true;
+    // anything reserved so far is old data, even if it's not all copied in
+    baud_at = tx_reserve;
+    if (tx_tail == baud_at) {
+        // it's all been handed to the USART, so the DMA won't interrupt
+        // again. wait for the last byte right away
+        USART2->CR1 |= USART_CR1_TCIE;
+    }
+    __enable_irq();
+    return true;
+}
+
+// the clock is about to change. stops feeding the USART and waits for the
+// byte or two it already has to go out. called with interrupts disabled.
+void uart_clock_changing(void) {
+    if (!uart_on) return;
+    // the DMA keeps its place, it just doesn't get asked for more bytes
+    USART2->CR3 &= ~USART_CR3_DMAT;
+    // a transfer the DMA already started lands in DR first
+    while (!(USART2->SR & USART_SR_TXE));
+    while (!(USART2->SR & USART_SR_TC));
+}
+
+// the clock changed, so work out the divider again for the same baud rate
+// and carry on sending where uart_clock_changing stopped
+void uart_clock_changed(void) {
+    if (curr_baud) {
+        apply_baud();
+    }
+    if (uart_on) {
+        USART2->CR3 |= USART_CR3_DMAT;
+    }
+}
+
+uint32_t uart_get_baud(void) {
+    return baud_pending ? pending_baud : curr_baud;
+}
+
+// how many bytes can be written right now
+uint16_t uart_tx_free(void) {
+    return (tx_tail - tx_reserve - 1) & TX_MASK;
+}
+
+// put some data into the transmit buffer and start sending it
+// the data is either written completely or not at all, so packets don't
+// get chopped in half. returns false if there wasn't enough space.
+bool uart_write(const uint8_t* data, uint16_t len) {
+    // can be called from any job, so protect ourselves!
+    // but only while reserving space, so we don't hold interrupts off
+    // while copying
+    __disable_irq();
+    uint16_t r = tx_reserve;
+    if (!uart_on || len > ((tx_tail - r - 1) & TX_MASK)) {
+        __enable_irq();
+        return false;
+    }
+    tx_reserve = (r + len) & TX_MASK;
+    tx_writers++;
+    __enable_irq();
+
+    for (uint16_t i=0; i<len; i++) {
+        tx_buf[r] = data[i];
+        r = (r+1) & TX_MASK;
+    }
+
+    __disable_irq();
+    // if we interrupted another writer, it's still copying into the space
+    // before ours, so the last writer out gets to publish everything
+    if (--tx_writers == 0) {
+        tx_head = tx_reserve;
+        start_dma();
+    }
+    __enable_irq();
+    return true;
+}
+
+// DMA1 channel 7 is USART2's TX channel. it interrupts when the
+// current chunk of the buffer has been sent
+void DMA1_Channel7_IRQHandler(void) {
+    __disable_irq();
+    DMA1->IFCR = DMA_IFCR_CGIF7;
+    // that chunk is gone now
+    tx_tail = (tx_tail + tx_dma_len) & TX_MASK;
+    tx_dma_len = 0;
+    if (baud_pending && tx_tail == baud_at) {
+        // the old data is all in the USART. once it's out, switch
+        USART2->CR1 |= USART_CR1_TCIE;
+    }
+    // and the next one might be waiting
+    start_dma();
+    if (tx_wakeup) {
+        tx_wakeup = false;
+        job_schedule(JOB_SYSTEM);
+    }
+    __enable_irq();
+}
+
+// schedule the system job once the chunk being sent now is done
+// for sending more than fits in the buffer without waiting around
+void uart_request_tx_wakeup(void) {
+    __disable_irq();
+    if (tx_dma_len) {
+        tx_wakeup = true;
+    } else {
+        // nothing is being sent, so there's no reason to wait
+        job_schedule(JOB_SYSTEM);
+    }
+    __enable_irq();
+}
+
+// how many received bytes are waiting to be read
+uint16_t uart_rx_available(void) {
+    // the DMA isn't set up, so CNDTR means nothing
+    if (!uart_on) return 0;
+    uint16_t head = UART_RX_BUF_SIZE - DMA1_Channel6->CNDTR;
+    if (head == UART_RX_BUF_SIZE) {
+        // CNDTR can read 0 for a moment right before it reloads
+        head = 0;
+    }
+    return (head >= rx_tail) ?
+        (head - rx_tail) : (UART_RX_BUF_SIZE - rx_tail + head);
+}
+
+// read up to max bytes that have been received. returns how many were read
+// only one job may read at a time!
+uint16_t uart_read(uint8_t* data, uint16_t max) {
+    uint16_t avail = uart_rx_available();
+    if (max > avail) {
+        max = avail;
+    }
+    uint16_t t = rx_tail;
+    for (uint16_t i=0; i<max; i++) {
+        data[i] = rx_buf[t++];
+        if (t == UART_RX_BUF_SIZE) {
+            t = 0;
+        }
+    }
+    rx_tail = t;
+    return max;
+}
+
+// DMA1 channel 6 is USART2's RX channel. it interrupts when the buffer
+// is half or completely full, in case the sender never stops to let us see
+// an idle line
+void DMA1_Channel6_IRQHandler(void) {
+    DMA1->IFCR = DMA_IFCR_CGIF6;
+    // the console lives in the system job
+    job_schedule(JOB_SYSTEM);
+}
+
+// the USART interrupts when the RX line goes idle, and when the last byte
+// before a baud change has gone out
+void USART2_IRQHandler(void) {
+    if ((USART2->CR1 & USART_CR1_TCIE) && (USART2->SR & USART_SR_TC)) {
+        __disable_irq();
+        USART2->CR1 &= ~USART_CR1_TCIE;
+        curr_baud = pending_baud;
+        baud_pending = false;
+        apply_baud();
+        // and send whatever was written after the change
+        start_dma();
+        bool slow = !needs_clock(curr_baud);
+        __enable_irq();
+        // the low level can do this rate, so stop holding the clock up
+        if (slow) {
+            clock_release(CLOCK_REQ_UART);
+        }
+    }
+    if (USART2->SR & USART_SR_IDLE) {
+        // reading SR then DR clears the idle flag
+        // the DMA has already taken the data, so DR has nothing we want
+        (void)USART2->DR;
+        // the console lives in the system job
+        job_schedule(JOB_SYSTEM);
+    }
+}
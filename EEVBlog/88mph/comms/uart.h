@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef COMMS_UART_H
+#define COMMS_UART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file manages USART2, which is connected to the Bluetooth module
+// cube sets up the pins and the peripheral, then we take it over
+
+// transmitting is done by DMA out of a ring buffer, so writing costs
+// a copy and nothing else
+
+// must be power of 2!!
+#define UART_TX_BUF_SIZE (512)
+
+// receiving is also done by DMA, into a circular buffer. the USART tells us
+// when the line goes idle, i.e. when a burst of data is finished, and the
+// system job is scheduled to look at it. this doesn't need to be a power of 2.
+#define UART_RX_BUF_SIZE (128)
+
+// the baud rate we switch to after init
+// the Bluetooth module can go a lot faster than cube's 19200
+#define UART_DEFAULT_BAUD (115200)
+
+// turn on the UART and its DMA
+void uart_init(void);
+// turn it off again
+void uart_deinit(void);
+
+// change the baud rate. data already written still goes out at the old
+// rate, and the change happens once it has, so this doesn't wait.
+// returns false if the rate is out of range. rates above what the low clock
+// level can make hold the clock at the normal level.
+bool uart_set_baud(uint32_t baud);
+// the slowest and fastest rates uart_set_baud takes. they have to work at
+// every clock level the UART might end up running at
+void uart_get_baud_range(uint32_t* min, uint32_t* max);
+uint32_t uart_get_baud(void);
+
+// wait for everything in the buffer to go out
+void uart_flush(void);
+// the clock is about to change. stops feeding the USART and waits for the
+// byte or two it already has to go out, which is at most a couple hundred us
+// at the default baud. called with interrupts disabled.
+void uart_clock_changing(void);
+// the clock changed, so work out the divider again for the same baud rate
+// and carry on sending where uart_clock_changing stopped
+void uart_clock_changed(void);
+
+// put some data into the transmit buffer and start sending it
+// the data is either written completely or not at all, so packets don't
+// get chopped in half. returns false if there wasn't enough space, or the
+// UART is turned off.
+bool uart_write(const uint8_t* data, uint16_t len);
+// how many bytes can be written right now
+uint16_t uart_tx_free(void);
+// schedule the system job once the chunk being sent now is done
+// for sending more than fits in the buffer without waiting around
+void uart_request_tx_wakeup(void);
+
+// read up to max bytes that have been received. returns how many were read
+// only one job may read at a time!
+uint16_t uart_read(uint8_t* data, uint16_t max);
+// how many received bytes are waiting to be read
+uint16_t uart_rx_available(void);
+
+// DMA1 channel 7 is USART2's TX channel. it interrupts when the
+// current chunk of the buffer has been sent
+void DMA1_Channel7_IRQHandler(void);
+
+// DMA1 channel 6 is USART2's RX channel. it interrupts when the buffer
+// is half or completely full, in case the sender never stops to let us see
+// an idle line
+void DMA1_Channel6_IRQHandler(void);
+
+// the USART interrupts when the RX line goes idle, and when the last byte
+// before a baud change has gone out
+void USART2_IRQHandler(void);
+
+#endif
@@ -151,6 +151,22 @@ void btn_process(void) {
     }
 }
 
+// returns true if nothing is being debounced or timed for holding
+// while that's true, btn_process has nothing to do until a pin changes
+bool btn_is_settled(void) {
+    for (int bi=0; bi<18; bi++) {
+        const button_mem_t* this_mem = &button_mem[bi];
+        if (this_mem->debounce_timer) {
+            return false;
+        }
+        if (button_data[bi].can_be_held &&
+                this_mem->state == BTN_PRESSED && this_mem->held_timer) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // looks at the non-range-switch buttons and returns the first one whose state
 // is new. it then clears the new flag and stores the state in new_state
 // if there is no such button, returns BTN_NONE and does not change new_state
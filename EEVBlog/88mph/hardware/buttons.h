@@ -19,6 +19,8 @@
 #ifndef HARDWARE_BUTTONS_H
 #define HARDWARE_BUTTONS_H
 
+#include <stdbool.h>
+
 // this file handles reading the buttons, debouncing them, and
 // determining held-ness
 
@@ -73,6 +75,10 @@ typedef enum {
 // called every 10ms to do all the magic
 void btn_process(void);
 
+// returns true if nothing is being debounced or timed for holding
+// while that's true, btn_process has nothing to do until a pin changes
+bool btn_is_settled(void);
+
 // looks at the non-range-switch buttons and returns the first one whose state
 // is new. it then clears the new flag and stores the state in new_state
 // if there is no such button, returns BTN_NONE and does not change new_state
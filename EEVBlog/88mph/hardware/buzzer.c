@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "hardware/buzzer.h"
+
+#include "hardware/gpio.h"
+
+// 10ms ticks left in the current beep
+static volatile uint8_t beep_left = 0;
+
+// beep for len_10ms 10ms ticks. a beep that's already going is restarted
+void buzzer_beep(uint8_t len_10ms) {
+    if (len_10ms == 0) {
+        return;
+    }
+    beep_left = len_10ms;
+    GPIO_PINSET(SYS_BUZZER);
+}
+
+// stop the current beep right now
+void buzzer_stop(void) {
+    beep_left = 0;
+    GPIO_PINRST(SYS_BUZZER);
+}
+
+// called every 10ms to turn the buzzer off when it's done
+void buzzer_10ms(void) {
+    // the 10ms job is higher priority than anybody who beeps, so this
+    // can't get interrupted by a new beep
+    if (beep_left && --beep_left == 0) {
+        GPIO_PINRST(SYS_BUZZER);
+    }
+}
+
+// returns true if the buzzer is on, so the 10ms timer needs to keep going
+bool buzzer_is_on(void) {
+    return beep_left != 0;
+}
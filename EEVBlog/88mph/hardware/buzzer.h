@@ -0,0 +1,44 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef HARDWARE_BUZZER_H
+#define HARDWARE_BUZZER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file makes the buzzer beep
+// the buzzer makes its own tone, so all we do is turn it on, and the 10ms
+// timer turns it off again
+
+// how long a normal beep is, in 10ms units
+#define BUZZER_BEEP_10MS (8)
+
+// beep for len_10ms 10ms ticks. a beep that's already going is restarted
+void buzzer_beep(uint8_t len_10ms);
+
+// stop the current beep right now
+void buzzer_stop(void);
+
+// called every 10ms to turn the buzzer off when it's done
+void buzzer_10ms(void);
+
+// returns true if the buzzer is on, so the 10ms timer needs to keep going
+bool buzzer_is_on(void);
+
+#endif
@@ -24,9 +24,15 @@
 
 #include "hardware/gpio.h"
 #include "system/job.h"
+#include "system/timer.h"
+#include "system/profile.h"
+#include "system/deadline.h"
+#include "system/trace.h"
+#include "system/clock.h"
+#include "system/bench.h"
 #include "acquisition/acquisition.h"
 
-static void check_irq_line(void) {
+static HOT_FUNC void check_irq_line(void) {
     // the EXTI interrupt line is edge-sensitive
     // so if we turn on interrupts while the HY has already asserted
     // the interrupt line, we will never catch it
@@ -71,34 +77,81 @@ void hy_init(void) {
     hy_write_regs(HY_REG_INTE, 1, &mask);
 }
 
+// once the chip's supplies are turned on, wait until it talks to us
+// returns false if it still hasn't after timeout_ms milliseconds
+bool hy_wait_ready(uint32_t timeout_ms) {
+    // write something to INTE and see if it comes back. a chip that's not
+    // awake yet reads as all zeros or all ones, so those won't do.
+    // hy_init clears it again afterwards.
+    const uint8_t pattern = HY_REG_INT_RMS | HY_REG_INT_AD1 | HY_REG_INT_CT;
+    uint32_t start = HAL_GetTick();
+    do {
+        uint8_t readback;
+        hy_write_regs(HY_REG_INTE, 1, &pattern);
+        hy_read_regs(HY_REG_INTE, 1, &readback);
+        if (readback == pattern) {
+            return true;
+        }
+    } while (HAL_GetTick() - start < timeout_ms);
+    return false;
+}
+
 void hy_deinit(void) {
     job_disable(JOB_ACQUISITION);
 }
 
-
 // chip interrupt is connected to EXTI3
-void EXTI3_IRQHandler(void) {
+HOT_FUNC void EXTI3_IRQHandler(void) {
+    // timestamp the interrupt before anything else so the sample timing
+    // doesn't depend on how long we took to get here
+    uint32_t irq_time_us = TIMER_US_NOW();
+    uint32_t start_cycles = BENCH_NOW();
+
     // acknowledge this interrupt in EXTI
     EXTI->PR = EXTI_PR_PR3;
 
+    trace_event(TRACE_JOB_BEGIN, JOB_ACQUISITION);
+    // see if we missed any since last time
+    deadline_acq_irq(irq_time_us);
+
     // it's time to do the job, probably because the HY bothered us
-    acq_handle_job_acquisition();
+    acq_handle_job_acquisition(irq_time_us);
+
+    // if the HY already wants us again, we're not keeping up
+    if (GPIO_PINGET(HY_DO)) {
+        deadline_record(DEADLINE_ACQ_LATE, TIMER_US_NOW() - irq_time_us);
+    }
+    trace_event(TRACE_JOB_END, JOB_ACQUISITION);
+
+    prof_record(PROF_JOB_ACQUISITION, irq_time_us);
+    bench_record(BENCH_ACQ_JOB, start_cycles);
+}
+
+// how many times around the spinloop makes one delay
+// the delays were tuned at 12MHz, so faster clocks need more spins
+// with CLOCK_HOT_IN_RAM, a spin takes the same number of cycles at every
+// level, so this is all it takes to keep the timing the same
+static uint32_t spin_scale = 1;
+
+// the system clock changed speed, so fix up the bit-banging delays
+void hy_clock_changed(void) {
+    spin_scale = (SystemCoreClock + 12000000-1)/12000000;
 }
 
 // just wait some time to let setup and hold delays happen
-static void spinloop(uint32_t times) {
-    volatile uint32_t detimes = times;
+static HOT_FUNC void spinloop(uint32_t times) {
+    volatile uint32_t detimes = times*spin_scale;
     while (detimes--);
 }
 
-static void toggle_clock(void) {
+static HOT_FUNC void toggle_clock(void) {
     spinloop(1);
     GPIO_PINSET(HY_CK);
     spinloop(1);
     GPIO_PINRST(HY_CK);
 }
 
-static void send_byte(uint8_t byte) {
+static HOT_FUNC void send_byte(uint8_t byte) {
     for (int bit=0; bit<8; bit++) {
         GPIO_PINCHG(HY_DI, byte & 0x80);
         byte <<= 1;
@@ -106,7 +159,7 @@ static void send_byte(uint8_t byte) {
     }
 }
 
-static uint8_t recv_byte(void) {
+static HOT_FUNC uint8_t recv_byte(void) {
     uint8_t byte = 0;
     for (int bit=0; bit<8; bit++) {
         // toggle clock before reading bit because there is a 1 bit
@@ -119,11 +172,13 @@ static uint8_t recv_byte(void) {
 }
 
 // read a series of registers from the chip
-void hy_read_regs(uint8_t start, uint8_t count, uint8_t* data) {
+HOT_FUNC void hy_read_regs(uint8_t start, uint8_t count, uint8_t* data) {
     // we have to turn off interrupts while doing this
     // because the chip will be wiggling DO and making spurious interrupts
     // all over the place
+    uint32_t start_cycles = BENCH_NOW();
     bool acq_enabled = job_disable(JOB_ACQUISITION);
+    trace_event(TRACE_HY_BEGIN, start << 8 | count);
 
     // assert chip select
     GPIO_PINRST(HY_CS);
@@ -146,16 +201,19 @@ void hy_read_regs(uint8_t start, uint8_t count, uint8_t* data) {
 
     // clear spurious interrupts, but listen to the HY if it wants us
     check_irq_line();
+    trace_event(TRACE_HY_END, 0);
     // configure the job how it was
     job_resume(JOB_ACQUISITION, acq_enabled);
+    bench_record(BENCH_HY_READ, start_cycles);
 }
 
 // write a series of registers to the chip
-void hy_write_regs(uint8_t start, uint8_t count, const uint8_t* data) {
+HOT_FUNC void hy_write_regs(uint8_t start, uint8_t count, const uint8_t* data) {
     // we have to turn off interrupts while doing this
     // because the chip will be wiggling DO and making spurious interrupts
     // all over the place
     bool acq_enabled = job_disable(JOB_ACQUISITION);
+    trace_event(TRACE_HY_BEGIN, 0x8000 | start << 8 | count);
 
     // assert chip select
     GPIO_PINRST(HY_CS);
@@ -176,6 +234,7 @@ void hy_write_regs(uint8_t start, uint8_t count, const uint8_t* data) {
 
     // clear spurious interrupts, but listen to the HY if it wants us
     check_irq_line();
+    trace_event(TRACE_HY_END, 0);
     // configure the job how it was
     job_resume(JOB_ACQUISITION, acq_enabled);
 }
@@ -60,6 +60,11 @@
 #define HY_REG_INT_AD2 (0x02)
 #define HY_REG_INT_CT (0x01)
 
+// once the chip's supplies are turned on, wait until it talks to us
+// returns false if it still hasn't after timeout_ms milliseconds
+#define HY_READY_TIMEOUT_MS (20)
+bool hy_wait_ready(uint32_t timeout_ms);
+
 void hy_init(void);
 void hy_deinit(void);
 
@@ -71,4 +76,7 @@ void hy_read_regs(uint8_t start, uint8_t count, uint8_t* data);
 // write a series of registers to the chip
 void hy_write_regs(uint8_t start, uint8_t count, const uint8_t* data);
 
+// the system clock changed speed, so fix up the bit-banging delays
+void hy_clock_changed(void);
+
 #endif
\ No newline at end of file
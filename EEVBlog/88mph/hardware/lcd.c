@@ -35,6 +35,11 @@ void lcd_queue_update(void) {
     lcd_needs_updating = true;
 }
 
+// returns true if an update has been asked for but hasn't happened yet
+bool lcd_update_is_pending(void) {
+    return lcd_needs_updating;
+}
+
 // try and update the display every 10ms
 // called by the 10ms timer routine
 void lcd_10ms_update_if_necessary(void) {
@@ -161,4 +166,17 @@ void lcd_put_reading(lcd_screen_t which, reading_t reading) {
     if (seg != SEG_NONE) {
         LCD_SEGON(seg);
     }
+}
+
+// show the size of a reading on the bargraph
+// a full graph is 50000 counts, whatever the decimal point says
+void lcd_put_bargraph(reading_t reading) {
+    int val = reading.millicounts/1000;
+    val = (val < 0) ? -val : val;
+    // each bar is 2000 counts
+    int bars = val/2000;
+    LCD_SEGON(SEG_BG_SCALE);
+    for (int bi=0; bi<25; bi++) {
+        LCD_SEGSET(lcd_bargraph_bars[bi], bi < bars);
+    }
 }
\ No newline at end of file
@@ -24,6 +24,7 @@
 */
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "acquisition/reading.h"
 
@@ -53,6 +54,8 @@ typedef enum {
 
 // ask for an update from the segment buffer to be done
 void lcd_queue_update(void);
+// returns true if an update has been asked for but hasn't happened yet
+bool lcd_update_is_pending(void);
 
 // try and update the display every 10ms
 // called by the 10ms timer routine
@@ -80,5 +83,8 @@ void lcd_put_str(lcd_screen_t which, char* s);
 // put a reading on a screen
 // automatically sets the units and powers accordingly
 void lcd_put_reading(lcd_screen_t which, reading_t reading);
+// show the size of a reading on the bargraph
+// a full graph is 50000 counts, whatever the decimal point says
+void lcd_put_bargraph(reading_t reading);
 
 #endif
@@ -100,4 +100,13 @@ const uint8_t lcd_decimal_points[2][5] = {
     // and main screen
     {SEG_MS_POINT_d0000, SEG_MS_POINT_d000,
         SEG_MS_POINT_d00, SEG_MS_POINT_d0, SEG_NONE}
+};
+
+// table of the bargraph's bars, left to right
+const uint8_t lcd_bargraph_bars[25] = {
+    SEG_BG_B1, SEG_BG_B2, SEG_BG_B3, SEG_BG_B4, SEG_BG_B5,
+    SEG_BG_B6, SEG_BG_B7, SEG_BG_B8, SEG_BG_B9, SEG_BG_B10,
+    SEG_BG_B11, SEG_BG_B12, SEG_BG_B13, SEG_BG_B14, SEG_BG_B15,
+    SEG_BG_B16, SEG_BG_B17, SEG_BG_B18, SEG_BG_B19, SEG_BG_B20,
+    SEG_BG_B21, SEG_BG_B22, SEG_BG_B23, SEG_BG_B24, SEG_BG_B25
 };
\ No newline at end of file
@@ -26,5 +26,6 @@ extern const uint8_t lcd_7seg_segments[10][7];
 extern const uint8_t lcd_unit_icons[2][11];
 extern const uint8_t lcd_exponent_icons[2][6];
 extern const uint8_t lcd_decimal_points[2][5];
+extern const uint8_t lcd_bargraph_bars[25];
 
 #endif
\ No newline at end of file
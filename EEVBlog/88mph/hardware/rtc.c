@@ -0,0 +1,198 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "hardware/rtc.h"
+
+#include "system/job.h"
+
+static volatile bool alarm_fired = false;
+// what the LSI was last measured at, in Hz
+static uint32_t lsi_hz = LSI_VALUE;
+
+static void rtc_unlock(void) {
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+}
+
+static void rtc_lock(void) {
+    RTC->WPR = 0xFF;
+}
+
+// set the finer prescalers and set up the alarm's interrupt
+void rtc_init(void) {
+    uint32_t prer = (RTC_PREDIV_A << RTC_PRER_PREDIV_A_Pos) | RTC_PREDIV_S;
+    if (RTC->PRER != prer) {
+        // the prescalers can only be changed in init mode, which stops the
+        // calendar for a moment. it keeps the time though
+        rtc_unlock();
+        RTC->ISR |= RTC_ISR_INIT;
+        while (!(RTC->ISR & RTC_ISR_INITF));
+        // the manual says to write them one at a time, synchronous first
+        RTC->PRER = (RTC->PRER & RTC_PRER_PREDIV_A) | RTC_PREDIV_S;
+        RTC->PRER = prer;
+        RTC->ISR &= ~RTC_ISR_INIT;
+        rtc_lock();
+    }
+    rtc_cancel_alarm();
+    SET_BIT(EXTI->RTSR, EXTI_IMR_MR17);
+    SET_BIT(EXTI->IMR, EXTI_IMR_MR17);
+    NVIC_ClearPendingIRQ(RTC_Alarm_IRQn);
+    NVIC_EnableIRQ(RTC_Alarm_IRQn);
+}
+
+static uint32_t bcd_to_bin(uint32_t tens, uint32_t units) {
+    return tens*10 + units;
+}
+
+// read the RTC as a count of its subsecond ticks since midnight
+// waits for the shadow registers to catch up first, so it's safe after STOP
+uint32_t rtc_read_ticks(void) {
+    rtc_unlock();
+    RTC->ISR &= ~(RTC_ISR_RSF | RTC_ISR_INIT);
+    rtc_lock();
+    while (!(RTC->ISR & RTC_ISR_RSF));
+
+    // reading SSR locks TR and DR until DR is read
+    uint32_t ssr = RTC->SSR;
+    uint32_t tr = RTC->TR;
+    (void)RTC->DR;
+    uint32_t prediv_s = RTC->PRER & RTC_PRER_PREDIV_S;
+
+    uint32_t seconds =
+        bcd_to_bin((tr & RTC_TR_HT) >> RTC_TR_HT_Pos,
+            (tr & RTC_TR_HU) >> RTC_TR_HU_Pos)*3600 +
+        bcd_to_bin((tr & RTC_TR_MNT) >> RTC_TR_MNT_Pos,
+            (tr & RTC_TR_MNU) >> RTC_TR_MNU_Pos)*60 +
+        bcd_to_bin((tr & RTC_TR_ST) >> RTC_TR_ST_Pos,
+            (tr & RTC_TR_SU) >> RTC_TR_SU_Pos);
+    // the subseconds count down
+    return seconds*(prediv_s+1) + (prediv_s - ssr);
+}
+
+// how many ticks from start to end. it might have gone past midnight
+static uint32_t ticks_between(uint32_t start, uint32_t end) {
+    uint32_t prediv_s = RTC->PRER & RTC_PRER_PREDIV_S;
+    uint32_t ticks_per_day = 86400*(prediv_s+1);
+    return (end + ticks_per_day - start) % ticks_per_day;
+}
+
+// convert a difference in RTC ticks to microseconds
+uint32_t rtc_ticks_to_us(uint32_t start, uint32_t end) {
+    uint32_t prediv_a = (RTC->PRER & RTC_PRER_PREDIV_A) >>
+        RTC_PRER_PREDIV_A_Pos;
+    // each tick is (PREDIV_A+1) cycles of the RTC's clock, which is the LSI
+    return (uint32_t)(((uint64_t)ticks_between(start, end)*(prediv_a+1)*
+        1000000)/lsi_hz);
+}
+
+// tell the RTC that us microseconds of the crystal went by between two
+// readings of rtc_read_ticks()
+void rtc_calibrate(uint32_t start, uint32_t end, uint32_t us) {
+    if (us < RTC_CAL_MIN_US) {
+        return;
+    }
+    uint32_t prediv_a = (RTC->PRER & RTC_PRER_PREDIV_A) >>
+        RTC_PRER_PREDIV_A_Pos;
+    uint32_t hz = (uint32_t)(((uint64_t)ticks_between(start, end)*
+        (prediv_a+1)*1000000)/us);
+    // the datasheet says it's somewhere in 26 to 56kHz, so anything else
+    // means one of the readings was bad
+    if (hz >= 26000 && hz <= 56000) {
+        lsi_hz = hz;
+    }
+}
+
+// set the RTC wakeup timer to go off in ms milliseconds
+// it's only 16 bits, so it might go off sooner if ms is more than about 28s
+void rtc_start_wakeup(uint32_t ms) {
+    // the timer counts RTCCLK/16
+    uint32_t ticks = (uint32_t)(((uint64_t)ms*(lsi_hz/16))/1000);
+    if (ticks > 0x10000) {
+        ticks = 0x10000;
+    } else if (ticks < 1) {
+        ticks = 1;
+    }
+    rtc_unlock();
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    while (!(RTC->ISR & RTC_ISR_WUTWF));
+    RTC->WUTR = ticks-1;
+    RTC->CR = (RTC->CR & ~RTC_CR_WUCKSEL) | RTC_CR_WUTIE | RTC_CR_WUTE;
+    RTC->ISR &= ~(RTC_ISR_WUTF | RTC_ISR_INIT);
+    rtc_lock();
+}
+
+void rtc_stop_wakeup(void) {
+    rtc_unlock();
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    RTC->ISR &= ~(RTC_ISR_WUTF | RTC_ISR_INIT);
+    rtc_lock();
+}
+
+// set alarm A to go off in seconds seconds, which must be less than a day
+// when it does, the system job is scheduled
+void rtc_set_alarm(uint32_t seconds) {
+    uint32_t prediv_s = RTC->PRER & RTC_PRER_PREDIV_S;
+    uint32_t now = rtc_read_ticks()/(prediv_s+1);
+    uint32_t at = (now + seconds) % 86400;
+    uint32_t h = at/3600, m = (at/60)%60, s = at%60;
+
+    rtc_unlock();
+    RTC->CR &= ~(RTC_CR_ALRAE | RTC_CR_ALRAIE);
+    while (!(RTC->ISR & RTC_ISR_ALRAWF));
+    // match the time of day, whatever the date
+    RTC->ALRMAR = RTC_ALRMAR_MSK4 |
+        ((h/10) << RTC_ALRMAR_HT_Pos) | ((h%10) << RTC_ALRMAR_HU_Pos) |
+        ((m/10) << RTC_ALRMAR_MNT_Pos) | ((m%10) << RTC_ALRMAR_MNU_Pos) |
+        ((s/10) << RTC_ALRMAR_ST_Pos) | ((s%10) << RTC_ALRMAR_SU_Pos);
+    // and ignore the subseconds
+    RTC->ALRMASSR = 0;
+    RTC->ISR &= ~(RTC_ISR_ALRAF | RTC_ISR_INIT);
+    RTC->CR |= RTC_CR_ALRAE | RTC_CR_ALRAIE;
+    rtc_lock();
+    alarm_fired = false;
+}
+
+void rtc_cancel_alarm(void) {
+    rtc_unlock();
+    RTC->CR &= ~(RTC_CR_ALRAE | RTC_CR_ALRAIE);
+    RTC->ISR &= ~(RTC_ISR_ALRAF | RTC_ISR_INIT);
+    rtc_lock();
+    alarm_fired = false;
+}
+
+// returns true and clears the flag if the alarm went off since last time
+bool rtc_alarm_fired(void) {
+    __disable_irq();
+    bool fired = alarm_fired;
+    alarm_fired = false;
+    __enable_irq();
+    return fired;
+}
+
+// alarm A comes through EXTI line 17
+void RTC_Alarm_IRQHandler(void) {
+    // ALRAF isn't write protected, so it can be cleared directly
+    RTC->ISR &= ~(RTC_ISR_ALRAF | RTC_ISR_INIT);
+    EXTI->PR = EXTI_PR_PR17;
+    alarm_fired = true;
+    job_schedule(JOB_SYSTEM);
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef HARDWARE_RTC_H
+#define HARDWARE_RTC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file does the low level RTC things cube doesn't
+// cube sets the RTC up running from the LSI, which is only accurate to
+// a few percent, but it keeps going in STOP. the LSI gets measured against
+// the crystal while we're awake, so the time spent in STOP comes out right.
+
+// cube's prescalers make a subsecond tick 128 LSI cycles, or about 3.5ms.
+// that's how far off the microsecond timer could be after each STOP, so
+// rtc_init() switches to ticks of 4 cycles, about 108us. the prescalers
+// still make 1Hz for the calendar at the LSI's nominal 37kHz
+#define RTC_PREDIV_A (3)
+#define RTC_PREDIV_S (9249)
+// the LSI is only measured over at least this long, so one tick either way
+// is at most 0.01%
+#define RTC_CAL_MIN_US (1000000)
+
+// set the finer prescalers and set up the alarm's interrupt
+void rtc_init(void);
+
+// read the RTC as a count of its subsecond ticks since midnight
+// waits for the shadow registers to catch up first, so it's safe after STOP
+uint32_t rtc_read_ticks(void);
+// convert a difference in RTC ticks to microseconds
+uint32_t rtc_ticks_to_us(uint32_t start, uint32_t end);
+// tell the RTC that us microseconds of the crystal went by between two
+// readings of rtc_read_ticks(). it's ignored if that's under RTC_CAL_MIN_US
+void rtc_calibrate(uint32_t start, uint32_t end, uint32_t us);
+
+// set the RTC wakeup timer to go off in ms milliseconds
+// it's only 16 bits, so it might go off sooner if ms is more than about 28s
+void rtc_start_wakeup(uint32_t ms);
+void rtc_stop_wakeup(void);
+
+// set alarm A to go off in seconds seconds, which must be less than a day
+// when it does, the system job is scheduled
+void rtc_set_alarm(uint32_t seconds);
+void rtc_cancel_alarm(void);
+// returns true and clears the flag if the alarm went off since last time
+bool rtc_alarm_fired(void);
+
+// alarm A comes through EXTI line 17
+void RTC_Alarm_IRQHandler(void);
+
+#endif
@@ -0,0 +1,191 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "measurement/autohold.h"
+
+#include "acquisition/reading.h"
+#include "system/clock.h"
+#include "system/job.h"
+
+static volatile bool enabled = false;
+static uint8_t window = AUTOHOLD_DEFAULT_WINDOW;
+static int32_t band = AUTOHOLD_DEFAULT_BAND;
+
+// the last AUTOHOLD_MAX_WINDOW readings, indexed by sequence number
+static int32_t values[AUTOHOLD_MAX_WINDOW];
+static uint32_t seq;
+static int64_t sum;
+
+// the monotonic queues hold sequence numbers of readings which could still
+// be the window's max or min. the max queue's values only go down from
+// front to back, and the min queue's only go up, so the front is always
+// the answer. every reading goes in and out of each queue once.
+typedef struct {
+    uint32_t seqs[AUTOHOLD_MAX_WINDOW];
+    uint8_t front;
+    uint8_t len;
+} mono_queue_t;
+
+static mono_queue_t maxq, minq;
+
+// the format of the readings in the window
+static rdg_unit_t unit;
+static rdg_exponent_t exponent;
+static rdg_decimal_t decimal;
+
+static bool settled;
+static bool have_held;
+static reading_t held;
+static uint32_t locks;
+
+#define Q_AT(q, i) ((q)->seqs[((q)->front + (i)) % AUTOHOLD_MAX_WINDOW])
+
+// forget the window, but not what's held
+static void clear_window(void) {
+    seq = 0;
+    sum = 0;
+    maxq.len = 0;
+    minq.len = 0;
+    settled = false;
+}
+
+// put seq into the queue, first throwing out the ones it beats
+// is_max picks which way the queue is sorted
+static HOT_FUNC void mono_push(mono_queue_t* q, int32_t v, bool is_max) {
+    // throw out the front if it's slid out of the window. this has to
+    // happen first: with the biggest window the queue can be full, and
+    // the new one would go right on top of it
+    if (q->len && seq - q->seqs[q->front] >= window) {
+        q->front = (q->front+1) % AUTOHOLD_MAX_WINDOW;
+        q->len--;
+    }
+    while (q->len) {
+        int32_t back = values[Q_AT(q, q->len-1) % AUTOHOLD_MAX_WINDOW];
+        if (is_max ? (back > v) : (back < v)) {
+            break;
+        }
+        q->len--;
+    }
+    Q_AT(q, q->len) = seq;
+    q->len++;
+}
+
+// turn the detector on or off. turning it on forgets the held reading
+void autohold_enable(bool on) {
+    __disable_irq();
+    if (on && !enabled) {
+        clear_window();
+        have_held = false;
+    }
+    enabled = on;
+    __enable_irq();
+}
+
+bool autohold_is_enabled(void) {
+    return enabled;
+}
+
+// set how many readings must be within how many millicounts to settle
+// window is clamped to 2..AUTOHOLD_MAX_WINDOW
+void autohold_configure(uint8_t w, int32_t b) {
+    if (w < 2) {
+        w = 2;
+    } else if (w > AUTOHOLD_MAX_WINDOW) {
+        w = AUTOHOLD_MAX_WINDOW;
+    }
+    if (b < 0) {
+        b = 0;
+    }
+    __disable_irq();
+    window = w;
+    band = b;
+    clear_window();
+    __enable_irq();
+}
+
+void autohold_get_config(uint8_t* w, int32_t* b) {
+    *w = window;
+    *b = band;
+}
+
+// called by the measurement job with each acquired reading
+HOT_FUNC void autohold_put(const reading_t* reading) {
+    if (!enabled || reading->kind != RDG_KIND_MAIN) {
+        return;
+    }
+    // everybody else is in a lower priority job and disables interrupts
+    // to look at us, so we don't have to
+    if (reading->unit != unit || reading->exponent != exponent ||
+            reading->decimal != decimal) {
+        clear_window();
+        unit = reading->unit;
+        exponent = reading->exponent;
+        decimal = reading->decimal;
+    }
+
+    int32_t v = reading->millicounts;
+    // keep the sum of the window for the average
+    if (seq >= window) {
+        sum -= values[(seq-window) % AUTOHOLD_MAX_WINDOW];
+    }
+    sum += v;
+    values[seq % AUTOHOLD_MAX_WINDOW] = v;
+    mono_push(&maxq, v, true);
+    mono_push(&minq, v, false);
+    seq++;
+    if (seq < window) {
+        return;
+    }
+
+    int32_t spread = values[maxq.seqs[maxq.front] % AUTOHOLD_MAX_WINDOW] -
+        values[minq.seqs[minq.front] % AUTOHOLD_MAX_WINDOW];
+    if (!settled && spread <= band) {
+        int32_t avg = (int32_t)(sum/window);
+        if (avg >= AUTOHOLD_MIN_MILLICOUNTS ||
+                avg <= -AUTOHOLD_MIN_MILLICOUNTS) {
+            settled = true;
+            held = *reading;
+            held.millicounts = avg;
+            have_held = true;
+            locks++;
+            // the display would otherwise wait for the filtered reading
+            job_schedule(JOB_SYSTEM);
+        }
+    } else if (settled && spread > 2*band) {
+        // it has to move a good bit more than the band to count as
+        // unsettled, so noise right at the edge doesn't hold it over and
+        // over again
+        settled = false;
+    }
+}
+
+// get the most recently held reading, which is the average of the window
+// that settled. returns false if nothing has been held yet. locks counts
+// how many times a reading has been held, so the caller can beep at new ones
+bool autohold_get_held(reading_t* r, uint32_t* l) {
+    __disable_irq();
+    bool have = have_held;
+    *r = held;
+    *l = locks;
+    __enable_irq();
+    return have;
+}
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef MEASUREMENT_AUTOHOLD_H
+#define MEASUREMENT_AUTOHOLD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/reading.h"
+
+// this file watches the full rate readings for the value to settle, so the
+// display can hold it while the probes are somewhere awkward
+
+// the readings are settled once the last window of them are all within band
+// millicounts of each other. the spread of the window is kept with a pair
+// of monotonic queues, so each reading costs the same no matter how big
+// the window is
+#define AUTOHOLD_MAX_WINDOW (32)
+#define AUTOHOLD_DEFAULT_WINDOW (5)
+#define AUTOHOLD_DEFAULT_BAND (10000)
+// readings closer to 0 than this are the probes in the air, and never held
+#define AUTOHOLD_MIN_MILLICOUNTS (100000)
+
+// turn the detector on or off. turning it on forgets the held reading
+void autohold_enable(bool on);
+bool autohold_is_enabled(void);
+
+// set how many readings must be within how many millicounts to settle
+// window is clamped to 2..AUTOHOLD_MAX_WINDOW
+void autohold_configure(uint8_t window, int32_t band);
+void autohold_get_config(uint8_t* window, int32_t* band);
+
+// called by the measurement job with each acquired reading
+void autohold_put(const reading_t* reading);
+
+// get the most recently held reading, which is the average of the window
+// that settled. returns false if nothing has been held yet. locks counts
+// how many times a reading has been held, so the caller can beep at new ones
+bool autohold_get_held(reading_t* held, uint32_t* locks);
+
+#endif
@@ -0,0 +1,177 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "measurement/bus.h"
+
+#include "system/job.h"
+#include "system/trace.h"
+
+#define POOL_MASK (BUS_POOL_SIZE-1)
+#define DEPTH_MASK (BUS_MAX_DEPTH-1)
+
+// readings go in the pool in order, and each one is tagged with its
+// sequence number so a subscriber can tell if it's been overwritten
+static reading_t pool[BUS_POOL_SIZE];
+static uint32_t pool_seq[BUS_POOL_SIZE];
+static uint32_t next_seq = 0;
+
+typedef struct {
+    bool subscribed;
+    uint8_t decimation;
+    // readings of each kind left to skip before the next one is taken
+    // each kind counts on its own, so a main reading and the sub reading
+    // that goes with it are taken or skipped together
+    uint8_t skip[RDG_NUM_KINDS];
+    uint8_t depth;
+    job_t job;
+    // head and tail just count up. the queue is from tail to head
+    uint8_t head;
+    uint8_t tail;
+    // sequence numbers of the readings in the pool
+    uint32_t seqs[BUS_MAX_DEPTH];
+    rdg_queue_stats_t stats;
+} bus_sub_state_t;
+
+static bus_sub_state_t subs[BUS_NUM_SUBS];
+
+void bus_init(void) {
+    __disable_irq();
+    for (int si=0; si<BUS_NUM_SUBS; si++) {
+        subs[si].subscribed = false;
+    }
+    // make sure nothing in the pool looks like a real reading
+    next_seq = 0;
+    for (int pi=0; pi<BUS_POOL_SIZE; pi++) {
+        pool_seq[pi] = ~0U;
+    }
+    __enable_irq();
+}
+
+// start getting readings. only every decimation'th reading of each kind is
+// given to the subscriber, and only the newest depth of them are kept. job
+// is scheduled whenever one arrives.
+void bus_subscribe(bus_sub_t sub, uint8_t decimation, uint8_t depth,
+        job_t job) {
+    if (decimation < 1) {
+        decimation = 1;
+    }
+    if (depth < 1) {
+        depth = 1;
+    } else if (depth > BUS_MAX_DEPTH) {
+        depth = BUS_MAX_DEPTH;
+    }
+    bus_sub_state_t* s = &subs[sub];
+    // can be called from any job, so protect ourselves!
+    __disable_irq();
+    s->decimation = decimation;
+    for (int ki=0; ki<RDG_NUM_KINDS; ki++) {
+        s->skip[ki] = 0;
+    }
+    s->depth = depth;
+    s->job = job;
+    s->head = 0;
+    s->tail = 0;
+    s->stats.puts = 0;
+    s->stats.drops = 0;
+    s->stats.max_depth = 0;
+    s->subscribed = true;
+    __enable_irq();
+}
+
+// stop getting readings, and throw away any that are waiting
+void bus_unsubscribe(bus_sub_t sub) {
+    __disable_irq();
+    subs[sub].subscribed = false;
+    subs[sub].tail = subs[sub].head;
+    __enable_irq();
+}
+
+// give a reading to everybody who's subscribed
+void bus_publish(const reading_t* reading) {
+    // can be called from any job, so protect ourselves!
+    __disable_irq();
+    uint32_t seq = next_seq++;
+    pool[seq & POOL_MASK] = *reading;
+    pool_seq[seq & POOL_MASK] = seq;
+
+    for (int si=0; si<BUS_NUM_SUBS; si++) {
+        bus_sub_state_t* s = &subs[si];
+        if (!s->subscribed) {
+            continue;
+        }
+        uint8_t* skip = &s->skip[reading->kind];
+        if (*skip) {
+            (*skip)--;
+            continue;
+        }
+        *skip = s->decimation-1;
+
+        s->stats.puts++;
+        if ((uint8_t)(s->head - s->tail) == s->depth) {
+            // full, so the oldest one has to go
+            s->tail++;
+            s->stats.drops++;
+        }
+        s->seqs[s->head++ & DEPTH_MASK] = seq;
+        uint8_t depth = s->head - s->tail;
+        if (depth > s->stats.max_depth) {
+            s->stats.max_depth = depth;
+        }
+        // it's certainly interested in this new reading
+        job_schedule(s->job);
+    }
+    trace_event(TRACE_BUS_PUBLISH, seq);
+    __enable_irq();
+}
+
+// get the oldest reading a subscriber hasn't seen yet. returns false if
+// there isn't one, else puts it into reading and returns true
+bool bus_get(bus_sub_t sub, reading_t* reading) {
+    bus_sub_state_t* s = &subs[sub];
+    bool there_is_a_reading = false;
+    // can be called from any job, so protect ourselves!
+    __disable_irq();
+    while (s->head != s->tail) {
+        uint32_t seq = s->seqs[s->tail++ & DEPTH_MASK];
+        if (pool_seq[seq & POOL_MASK] == seq) {
+            *reading = pool[seq & POOL_MASK];
+            there_is_a_reading = true;
+            break;
+        }
+        // the pool went all the way around and replaced it
+        s->stats.drops++;
+    }
+    if (there_is_a_reading) {
+        trace_event(TRACE_BUS_GET, sub);
+    }
+    __enable_irq();
+    return there_is_a_reading;
+}
+
+// get a copy of a subscriber's queue statistics
+// puts counts readings given to it after decimation, and drops counts ones
+// it lost because it didn't keep up
+void bus_get_stats(bus_sub_t sub, rdg_queue_stats_t* stats) {
+    __disable_irq();
+    *stats = subs[sub].stats;
+    __enable_irq();
+}
@@ -0,0 +1,74 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef MEASUREMENT_BUS_H
+#define MEASUREMENT_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/reading.h"
+#include "system/job.h"
+
+// this file hands out measured readings to everybody who wants them
+// the measurement modes publish each reading once, into a pool. every
+// subscriber has its own little queue of which pool readings it hasn't
+// looked at yet, so a slow subscriber only ever loses its own readings and
+// never holds up the measurement engine or anybody else.
+
+// the subscribers. each one must only be read from one job!
+typedef enum {
+    BUS_SUB_DISPLAY=0,
+    BUS_SUB_BARGRAPH,
+    BUS_SUB_STREAM,
+    BUS_SUB_LOGGER,
+    BUS_NUM_SUBS
+} bus_sub_t;
+
+// how many readings are kept around in the pool
+// a subscriber which falls this far behind loses the old ones
+// must be power of 2!!
+#define BUS_POOL_SIZE (16)
+
+// the deepest a subscriber's queue can be
+// must be power of 2!! and no bigger than BUS_POOL_SIZE
+#define BUS_MAX_DEPTH (16)
+
+void bus_init(void);
+
+// start getting readings. only every decimation'th reading of each kind is
+// given to the subscriber, and only the newest depth of them are kept. job
+// is scheduled whenever one arrives.
+void bus_subscribe(bus_sub_t sub, uint8_t decimation, uint8_t depth,
+    job_t job);
+// stop getting readings, and throw away any that are waiting
+void bus_unsubscribe(bus_sub_t sub);
+
+// give a reading to everybody who's subscribed
+void bus_publish(const reading_t* reading);
+
+// get the oldest reading a subscriber hasn't seen yet. returns false if
+// there isn't one, else puts it into reading and returns true
+bool bus_get(bus_sub_t sub, reading_t* reading);
+
+// get a copy of a subscriber's queue statistics
+// puts counts readings given to it after decimation, and drops counts ones
+// it lost because it didn't keep up
+void bus_get_stats(bus_sub_t sub, rdg_queue_stats_t* stats);
+
+#endif
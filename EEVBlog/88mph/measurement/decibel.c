@@ -0,0 +1,100 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "measurement/decibel.h"
+
+#include "acquisition/reading.h"
+#include "system/fixmath.h"
+
+// 20*log10(2), with FIX_LOG_FRAC bits of fraction. it turns a base 2 log
+// of volts into dB. tools/gen_log2.py checks it along with the dB error
+#define DB_PER_LOG2 (394566)
+
+static db_mode_t db_mode = DB_MODE_OFF;
+static uint32_t ref_ohms = DB_DEFAULT_REF_OHMS;
+// 10*log10(ref_ohms), with FIX_LOG_FRAC bits of fraction
+// it's worked out the first time it's needed
+static int64_t ref_db = 0;
+static bool ref_db_valid = false;
+
+// 20*log10(v), with FIX_LOG_FRAC bits of fraction
+static int64_t log_db(uint64_t v) {
+    return ((int64_t)fix_log2(v)*DB_PER_LOG2) >> FIX_LOG_FRAC;
+}
+
+void db_set_mode(db_mode_t mode) {
+    if (mode < DB_NUM_MODES) {
+        db_mode = mode;
+    }
+}
+
+db_mode_t db_get_mode(void) {
+    return db_mode;
+}
+
+// set the impedance dBm is worked out into
+void db_set_ref_ohms(uint32_t ohms) {
+    if (ohms == 0) {
+        return;
+    }
+    ref_ohms = ohms;
+    ref_db_valid = false;
+}
+
+uint32_t db_get_ref_ohms(void) {
+    return ref_ohms;
+}
+
+// turn a volts reading into a dB reading in the current mode
+bool db_from_reading(const reading_t* volts, reading_t* db) {
+    if (db_mode == DB_MODE_OFF || volts->unit != RDG_UNIT_VOLTS ||
+            volts->millicounts == 0) {
+        return false;
+    }
+    // a millicount is 10^p volts. 1d0000 makes it 10^-7, each decimal point
+    // step after that is another 10, and each exponent step is 1000
+    int32_t p = (int32_t)volts->decimal - 7 +
+        3*((int32_t)volts->exponent - RDG_EXPONENT_NONE);
+    int64_t mc = volts->millicounts;
+    if (mc < 0) {
+        mc = -mc;
+    }
+    // dBV is 20*log10(volts)
+    int64_t level = log_db((uint64_t)mc) + ((int64_t)(20*p) << FIX_LOG_FRAC);
+    if (db_mode == DB_MODE_DBM) {
+        // power is V^2/R, and there's 30dB between a W and a mW
+        if (!ref_db_valid) {
+            ref_db = log_db(ref_ohms)/2;
+            ref_db_valid = true;
+        }
+        level += ((int64_t)30 << FIX_LOG_FRAC) - ref_db;
+    }
+    // a millicount is a hundred thousandth of a dB at 100.00
+    db->millicounts = (int32_t)((level*100000 +
+        (1 << (FIX_LOG_FRAC-1))) >> FIX_LOG_FRAC);
+    db->time_ms = volts->time_ms;
+    db->time_us = volts->time_us;
+    db->unit = RDG_UNIT_dB;
+    db->exponent = RDG_EXPONENT_NONE;
+    db->decimal = RDG_DECIMAL_100d00;
+    db->kind = RDG_KIND_SUB;
+    return true;
+}
\ No newline at end of file
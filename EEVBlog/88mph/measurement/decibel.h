@@ -0,0 +1,54 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef MEASUREMENT_DECIBEL_H
+#define MEASUREMENT_DECIBEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/reading.h"
+
+// this file works out the level of volts readings in decibels, either
+// against 1V (dBV) or against 1mW into a reference impedance (dBm). the logs
+// come from fix_log2(), so it's all integers and good to about 0.001dB.
+// everything here is called from the system job.
+
+typedef enum {
+    DB_MODE_OFF=0,
+    DB_MODE_DBM,
+    DB_MODE_DBV,
+    DB_NUM_MODES
+} db_mode_t;
+
+// 600 ohms is the usual audio reference
+#define DB_DEFAULT_REF_OHMS (600)
+
+void db_set_mode(db_mode_t mode);
+db_mode_t db_get_mode(void);
+
+// set the impedance dBm is worked out into. 0 is ignored
+void db_set_ref_ohms(uint32_t ohms);
+uint32_t db_get_ref_ohms(void);
+
+// turn a volts reading into a dB reading in the current mode, in hundredths
+// of a dB. returns false if the mode is off, the reading isn't volts, or
+// it's 0 and so has no level
+bool db_from_reading(const reading_t* volts, reading_t* db);
+
+#endif
\ No newline at end of file
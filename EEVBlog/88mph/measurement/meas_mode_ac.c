@@ -0,0 +1,141 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+
+#include "measurement/meas_mode_ac.h"
+
+#include "measurement/measurement.h"
+#include "measurement/meas_modes.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "system/clock.h"
+#include "system/fixmath.h"
+
+// averaging RMS values straight up isn't true RMS, so the acquisition hands
+// over mean squares. they're summed here and rooted once when the reading is
+// passed on
+typedef struct {
+    uint64_t sum_sq;
+    int acqs;
+} ac_avg_t;
+
+static HOT_FUNC void ac_handle_event(meas_event_t event, reading_t* reading,
+        ac_avg_t* avg, acq_mode_t acq_mode, acq_submode_t last_submode) {
+    switch (event) {
+        case MEAS_EVENT_START: {
+            // clear the average buffer
+            avg->sum_sq = 0;
+            avg->acqs = 0;
+            // switch the acquisition engine to the correct mode
+            // every mode's lowest range is submode 0
+            acq_set_mode(acq_mode, 0);
+            break;
+        }
+
+        case MEAS_EVENT_NEW_ACQ: {
+            // accumulate it in the average
+            // the mean squares are at most 52 bits, so even the longest
+            // filter can't overflow the sum
+            avg->sum_sq += reading->mean_square;
+            avg->acqs += 1;
+            // every so often, pass it on to the system
+            // the filter might have just gotten shorter, so don't check ==
+            if (avg->acqs >= meas_get_filter()) {
+                // reuse the reading since all the other parameters are the same
+                reading->millicounts =
+                    (int32_t)fix_isqrt64(avg->sum_sq/avg->acqs);
+                reading->mean_square = 0;
+                avg->sum_sq = 0;
+                avg->acqs = 0;
+                meas_put_reading(reading);
+            }
+            break;
+        }
+
+        case MEAS_EVENT_SET_RANGE: {
+            uint8_t range = meas_get_range();
+            // conveniently, the ranges are the acquisition submodes
+            if (range > last_submode) {
+                break;
+            }
+            // throw out the old range's average
+            avg->sum_sq = 0;
+            avg->acqs = 0;
+            acq_set_submode((acq_submode_t)range);
+            break;
+        }
+
+        default: {
+            // if we get stopped, we can rely on the next guy to
+            // switch acquisition mode and stuff correctly
+            break;
+        }
+    }
+}
+
+HOT_FUNC void meas_mode_func_volts_ac(meas_event_t event, reading_t* reading) {
+    static ac_avg_t avg;
+    ac_handle_event(event, reading, &avg,
+        ACQ_MODE_VOLTS_AC, ACQ_MODE_VOLTS_AC_SUBMODE_1000d0);
+}
+
+HOT_FUNC void meas_mode_func_amps_ac(meas_event_t event, reading_t* reading) {
+    static ac_avg_t avg;
+    ac_handle_event(event, reading, &avg,
+        ACQ_MODE_AMPS_AC, ACQ_MODE_AMPS_AC_SUBMODE_10d000);
+}
+
+HOT_FUNC void meas_mode_func_volts_dual(meas_event_t event, reading_t* reading) {
+    // each channel is averaged on its own: the dc one as usual, and the ac
+    // one as a sum of squares
+    static int64_t dc_sum = 0;
+    static int dc_acqs = 0;
+    static ac_avg_t ac;
+
+    switch (event) {
+        case MEAS_EVENT_NEW_ACQ: {
+            uint8_t filter = meas_get_filter();
+            if (reading->kind == RDG_KIND_MAIN) {
+                dc_sum += reading->millicounts;
+                if (++dc_acqs >= filter) {
+                    reading->millicounts = (int32_t)(dc_sum/dc_acqs);
+                    dc_sum = 0;
+                    dc_acqs = 0;
+                    meas_put_reading(reading);
+                }
+            } else {
+                // the sub readings are the ac ones
+                ac_handle_event(event, reading, &ac,
+                    ACQ_MODE_VOLTS_DUAL, ACQ_MODE_VOLTS_DUAL_SUBMODE_1000d0);
+            }
+            break;
+        }
+
+        default: {
+            // starting and changing range throw everything out
+            if (event == MEAS_EVENT_START || event == MEAS_EVENT_SET_RANGE) {
+                dc_sum = 0;
+                dc_acqs = 0;
+            }
+            ac_handle_event(event, reading, &ac,
+                ACQ_MODE_VOLTS_DUAL, ACQ_MODE_VOLTS_DUAL_SUBMODE_1000d0);
+            break;
+        }
+    }
+}
\ No newline at end of file
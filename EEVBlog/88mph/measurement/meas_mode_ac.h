@@ -0,0 +1,32 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef MEASUREMENT_MEAS_MODE_AC_H
+#define MEASUREMENT_MEAS_MODE_AC_H
+
+#include "measurement/meas_modes.h"
+#include "acquisition/reading.h"
+
+// this file defines the measurement mode funcs for the true RMS AC modes
+
+void meas_mode_func_volts_ac(meas_event_t event, reading_t* reading);
+void meas_mode_func_amps_ac(meas_event_t event, reading_t* reading);
+// dc volts on the main screen and ac volts on the sub screen
+void meas_mode_func_volts_dual(meas_event_t event, reading_t* reading);
+
+#endif
@@ -24,41 +24,139 @@
 #include "measurement/meas_modes.h"
 #include "acquisition/acquisition.h"
 #include "acquisition/reading.h"
+#include "system/clock.h"
 
-void meas_mode_func_volts_dc(meas_event_t event, reading_t* reading) {
-    // average over 8 acquisitions
-    static int avg_buf = 0;
-    static int acqs = 0;
+// most modes just average meas_get_filter() acquisitions, and their ranges
+// are the acquisition submodes, so they share this
+typedef struct {
+    int64_t sum;
+    int acqs;
+} avg_t;
 
+static HOT_FUNC void avg_handle_event(meas_event_t event, reading_t* reading,
+        avg_t* avg, acq_mode_t acq_mode, acq_submode_t last_submode) {
     switch (event) {
         case MEAS_EVENT_START: {
             // clear the average buffer
-            avg_buf = 0;
-            acqs = 0;
+            avg->sum = 0;
+            avg->acqs = 0;
             // switch the acquisition engine to the correct mode
-            acq_set_mode(ACQ_MODE_VOLTS_DC, ACQ_MODE_VOLTS_DC_SUBMODE_5d0000);
+            // every mode's lowest range is submode 0
+            acq_set_mode(acq_mode, 0);
             break;
         }
 
         case MEAS_EVENT_NEW_ACQ: {
             // accumulate it in the average
-            avg_buf += reading->millicounts;
-            acqs += 1;
-            // every 8, pass it on to the system
-            if (acqs == 8) {
-                acqs = 0;
+            avg->sum += reading->millicounts;
+            avg->acqs += 1;
+            // every so often, pass it on to the system
+            // the filter might have just gotten shorter, so don't check ==
+            if (avg->acqs >= meas_get_filter()) {
                 // reuse the reading since all the other parameters are the same
-                reading->millicounts = avg_buf/8;
-                avg_buf = 0;
+                reading->millicounts = (int32_t)(avg->sum/avg->acqs);
+                avg->acqs = 0;
+                avg->sum = 0;
                 meas_put_reading(reading);
             }
             break;
         }
 
+        case MEAS_EVENT_SET_RANGE: {
+            uint8_t range = meas_get_range();
+            // conveniently, the ranges are the acquisition submodes
+            if (range > last_submode) {
+                break;
+            }
+            // throw out the old range's average
+            avg->sum = 0;
+            avg->acqs = 0;
+            acq_set_submode((acq_submode_t)range);
+            break;
+        }
+
         default: {
             // if we get stopped, we can rely on the next guy to 
             // switch acquisition mode and stuff correctly
             break;
         }
     }
+}
+
+HOT_FUNC void meas_mode_func_volts_dc(meas_event_t event, reading_t* reading) {
+    static avg_t avg;
+    avg_handle_event(event, reading, &avg,
+        ACQ_MODE_VOLTS_DC, ACQ_MODE_VOLTS_DC_SUBMODE_1000d0);
+}
+
+void meas_mode_func_freq(meas_event_t event, reading_t* reading) {
+    switch (event) {
+        case MEAS_EVENT_START: {
+            // switch the acquisition engine to the correct mode
+            acq_set_mode(ACQ_MODE_FREQ, ACQ_MODE_FREQ_SUBMODE_HZ);
+            break;
+        }
+
+        case MEAS_EVENT_NEW_ACQ: {
+            // the counter's gate already does the averaging, and averaging
+            // the results again would mean dividing again. so just pass
+            // them on
+            meas_put_reading(reading);
+            break;
+        }
+
+        case MEAS_EVENT_SET_RANGE: {
+            uint8_t range = meas_get_range();
+            // the ranges are the acquisition submodes, which pick between
+            // frequency, period and duty cycle
+            if (range > ACQ_MODE_FREQ_SUBMODE_DUTY) {
+                break;
+            }
+            acq_set_submode((acq_submode_t)range);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
+
+void meas_mode_func_continuity(meas_event_t event, reading_t* reading) {
+    // the beeper is taken care of by the acquisition, so this is just the
+    // normal average for the display. the ranges pick continuity or diode
+    static avg_t avg;
+    avg_handle_event(event, reading, &avg,
+        ACQ_MODE_CONTINUITY, ACQ_MODE_CONTINUITY_SUBMODE_DIODE);
+}
+
+void meas_mode_func_temp(meas_event_t event, reading_t* reading) {
+    // the acquisition already turned the samples into temperatures, which
+    // are close enough to linear over a filter's worth that they can just
+    // be averaged. the ranges pick degrees C or F
+    static avg_t avg;
+    avg_handle_event(event, reading, &avg,
+        ACQ_MODE_TEMP, ACQ_MODE_TEMP_SUBMODE_DEG_F);
+}
+
+void meas_mode_func_cap(meas_event_t event, reading_t* reading) {
+    switch (event) {
+        case MEAS_EVENT_START: {
+            acq_set_mode(ACQ_MODE_CAP, ACQ_MODE_CAP_SUBMODE_AUTO);
+            break;
+        }
+
+        case MEAS_EVENT_NEW_ACQ: {
+            // the acquisition already averages small capacitors over its
+            // gate, and a big one's cycle can take seconds. averaging those
+            // again would only keep the screen waiting, so pass them on
+            meas_put_reading(reading);
+            break;
+        }
+
+        default: {
+            // there's only the one range, and it picks the current itself
+            break;
+        }
+    }
 }
\ No newline at end of file
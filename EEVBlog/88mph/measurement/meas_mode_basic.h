@@ -26,5 +26,9 @@
 // volts, etc
 
 void meas_mode_func_volts_dc(meas_event_t event, reading_t* reading);
+void meas_mode_func_freq(meas_event_t event, reading_t* reading);
+void meas_mode_func_continuity(meas_event_t event, reading_t* reading);
+void meas_mode_func_temp(meas_event_t event, reading_t* reading);
+void meas_mode_func_cap(meas_event_t event, reading_t* reading);
 
 #endif
\ No newline at end of file
@@ -22,10 +22,49 @@
 
 #include "measurement/measurement.h"
 #include "measurement/meas_mode_basic.h"
+#include "measurement/meas_mode_ac.h"
+#include "acquisition/acq_modes.h"
 
-const meas_mode_func meas_mode_funcs[2] = {
+const meas_mode_func meas_mode_funcs[MEAS_NUM_MODES] = {
     // MEAS_MODE_OFF
     meas_mode_func_off,
     // MEAS_MODE_VOLTS_DC
-    meas_mode_func_volts_dc
+    meas_mode_func_volts_dc,
+    // MEAS_MODE_VOLTS_AC
+    meas_mode_func_volts_ac,
+    // MEAS_MODE_AMPS_AC
+    meas_mode_func_amps_ac,
+    // MEAS_MODE_FREQ
+    meas_mode_func_freq,
+    // MEAS_MODE_VOLTS_DUAL
+    meas_mode_func_volts_dual,
+    // MEAS_MODE_CONTINUITY
+    meas_mode_func_continuity,
+    // MEAS_MODE_TEMP
+    meas_mode_func_temp,
+    // MEAS_MODE_CAP
+    meas_mode_func_cap
+};
+
+// most modes' ranges are their acquisition submodes
+const uint8_t meas_mode_ranges[MEAS_NUM_MODES] = {
+    // MEAS_MODE_OFF
+    1,
+    // MEAS_MODE_VOLTS_DC
+    ACQ_MODE_VOLTS_DC_SUBMODE_1000d0+1,
+    // MEAS_MODE_VOLTS_AC
+    ACQ_MODE_VOLTS_AC_SUBMODE_1000d0+1,
+    // MEAS_MODE_AMPS_AC
+    ACQ_MODE_AMPS_AC_SUBMODE_10d000+1,
+    // MEAS_MODE_FREQ
+    ACQ_MODE_FREQ_SUBMODE_DUTY+1,
+    // MEAS_MODE_VOLTS_DUAL
+    ACQ_MODE_VOLTS_DUAL_SUBMODE_1000d0+1,
+    // MEAS_MODE_CONTINUITY
+    ACQ_MODE_CONTINUITY_SUBMODE_DIODE+1,
+    // MEAS_MODE_TEMP
+    ACQ_MODE_TEMP_SUBMODE_DEG_F+1,
+    // MEAS_MODE_CAP
+    // it picks the current itself
+    1
 };
\ No newline at end of file
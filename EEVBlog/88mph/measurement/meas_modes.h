@@ -29,7 +29,15 @@
 
 typedef enum {
     MEAS_MODE_OFF=0,
-    MEAS_MODE_VOLTS_DC
+    MEAS_MODE_VOLTS_DC,
+    MEAS_MODE_VOLTS_AC,
+    MEAS_MODE_AMPS_AC,
+    MEAS_MODE_FREQ,
+    MEAS_MODE_VOLTS_DUAL,
+    MEAS_MODE_CONTINUITY,
+    MEAS_MODE_TEMP,
+    MEAS_MODE_CAP,
+    MEAS_NUM_MODES
 } meas_mode_t;
 
 // we also need to define the mode function
@@ -40,12 +48,18 @@ typedef enum {
     // end measuring, reading is null
     MEAS_EVENT_STOP,
     // the acquisition engine has a new reading
-    MEAS_EVENT_NEW_ACQ
+    MEAS_EVENT_NEW_ACQ,
+    // change range, reading is null
+    // the new range is from meas_get_range()
+    MEAS_EVENT_SET_RANGE
 } meas_event_t;
 
 typedef void (*meas_mode_func)(meas_event_t event, reading_t* reading);
 
-extern const meas_mode_func meas_mode_funcs[2];
+extern const meas_mode_func meas_mode_funcs[MEAS_NUM_MODES];
 
+// how many ranges each mode has. meas_set_range checks against this, so a
+// mode only ever sees ranges it can take
+extern const uint8_t meas_mode_ranges[MEAS_NUM_MODES];
 
 #endif
\ No newline at end of file
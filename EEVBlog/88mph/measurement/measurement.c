@@ -23,15 +23,23 @@
 
 #include "acquisition/acquisition.h"
 #include "measurement/meas_modes.h"
+#include "measurement/bus.h"
+#include "measurement/minmax.h"
+#include "measurement/autohold.h"
 #include "system/job.h"
+#include "system/trace.h"
 
 static meas_mode_func curr_meas_mode_func = 0;
+static volatile meas_mode_t curr_mode = MEAS_MODE_OFF;
+static volatile uint8_t curr_range = 0;
+static volatile uint8_t curr_filter = 8;
 
 // turn on the measurement engine
 void meas_init(void) {
     // switch to the 'off' mode manually
     // cause there should be no previous mode func to call
     curr_meas_mode_func = meas_mode_funcs[MEAS_MODE_OFF];
+    curr_mode = MEAS_MODE_OFF;
     curr_meas_mode_func(MEAS_EVENT_START, NULL);
 }
 
@@ -50,6 +58,10 @@ void meas_handle_job_measurement(void) {
     reading_t reading;
     
     while (acq_get_reading(&reading)) {
+        // the statistics and auto hold want every reading, before the mode
+        // averages it
+        minmax_session_put(&reading);
+        autohold_put(&reading);
         // tell the new reading to the mode function
         curr_meas_mode_func(MEAS_EVENT_NEW_ACQ, &reading);
     }
@@ -57,69 +69,61 @@ void meas_handle_job_measurement(void) {
 
 // set the measurement mode
 void meas_set_mode(meas_mode_t mode) {
+    trace_event(TRACE_MEAS_MODE, mode);
     // stop measurement job from catching us in a weird spot
     bool meas_enabled = job_disable(JOB_MEASUREMENT);
     // turn off the current mode
     curr_meas_mode_func(MEAS_EVENT_STOP, NULL);
     // figure out which mode func goes with this mode
     curr_meas_mode_func = meas_mode_funcs[mode];
+    curr_mode = mode;
     // and start it up
+    curr_range = 0;
     curr_meas_mode_func(MEAS_EVENT_START, NULL);
     // let the measurement job do its thing
     job_resume(JOB_MEASUREMENT, meas_enabled);
 }
 
-// must be power of 2!!
-#define MEAS_READING_QUEUE_SIZE (32)
-
-#define Q_MASK (MEAS_READING_QUEUE_SIZE-1)
-
-static volatile reading_t queue[MEAS_READING_QUEUE_SIZE];
-static volatile int q_head = 0;
-static volatile int q_tail = 0;
+meas_mode_t meas_get_mode(void) {
+    return curr_mode;
+}
 
-// put a reading into the queue. if there is no space it's just dropped
-void meas_put_reading(reading_t* reading) {
-    // can be called from any job, so protect ourselves!
-    __disable_irq();
-    // buffer head cause it's volatile
-    // but we know we can't get interrupted
-    int q_h = q_head;
-    if (((q_h+1)&Q_MASK) != q_tail) {
-        // we have space
-        queue[q_h] = *reading;
-        q_head = (q_h+1) & Q_MASK;
+// set the range of the current mode
+// what the number means is up to the mode. ones it doesn't have are ignored,
+// and the range stays what it was
+void meas_set_range(uint8_t range) {
+    if (range >= meas_mode_ranges[curr_mode]) {
+        return;
     }
-    __enable_irq();
+    // stop measurement job from catching us in a weird spot
+    bool meas_enabled = job_disable(JOB_MEASUREMENT);
+    curr_range = range;
+    curr_meas_mode_func(MEAS_EVENT_SET_RANGE, NULL);
+    job_resume(JOB_MEASUREMENT, meas_enabled);
+}
 
-    // the system job is certainly interested in this new measurement
-    job_schedule(JOB_SYSTEM);
+uint8_t meas_get_range(void) {
+    return curr_range;
 }
 
-// get a reading from the queue. returns false if there is no reading to get.
-// else puts the reading into reading and returns true
-bool meas_get_reading(reading_t* reading) {
-    // can be called from any job, so protect ourselves!
-    __disable_irq();
-    // buffer tail cause it's volatile
-    // but we know we can't get interrupted
-    int q_t = q_tail;
-    bool there_is_a_reading = (q_head != q_t);
-    if (there_is_a_reading) {
-        *reading = queue[q_t];
-        q_tail = (q_t+1) & Q_MASK;
+// set how many acquisitions get averaged into one measurement
+// this applies to every mode, so it's kept through mode changes
+void meas_set_filter(uint8_t filter) {
+    if (filter < 1) {
+        filter = 1;
+    } else if (filter > MEAS_MAX_FILTER) {
+        filter = MEAS_MAX_FILTER;
     }
-    __enable_irq();
-    return there_is_a_reading;
+    curr_filter = filter;
 }
 
-// empty the queue of all readings
-void meas_clear_readings(void) {
-    // can be called from any job, so protect ourselves!
-    __disable_irq();
-    q_head = 0;
-    q_tail = 0;
-    __enable_irq();
+uint8_t meas_get_filter(void) {
+    return curr_filter;
+}
+
+// hand a finished reading to everybody who wants it
+void meas_put_reading(reading_t* reading) {
+    bus_publish(reading);
 }
 
 void meas_mode_func_off(meas_event_t event, reading_t* reading) {
@@ -34,17 +34,25 @@ void meas_deinit(void);
 void meas_handle_job_measurement(void);
 
 // set the measurement mode
+// this goes back to range 0
 void meas_set_mode(meas_mode_t mode);
-
-// there is a queue of measured values, effectively between the measurement
-// job and the system job
-// put a reading into the queue. if there is no space it's just dropped
+meas_mode_t meas_get_mode(void);
+
+// set the range of the current mode
+// what the number means is up to the mode. ones it doesn't have are ignored,
+// and the range stays what it was
+void meas_set_range(uint8_t range);
+uint8_t meas_get_range(void);
+
+// set how many acquisitions get averaged into one measurement
+// this applies to every mode, so it's kept through mode changes
+#define MEAS_MAX_FILTER (64)
+void meas_set_filter(uint8_t filter);
+uint8_t meas_get_filter(void);
+
+// hand a finished reading to everybody who wants it
+// readings are given out through the bus, see measurement/bus.h
 void meas_put_reading(reading_t* reading);
-// get a reading from the queue. returns false if there is no reading to get.
-// else puts the reading into reading and returns true
-bool meas_get_reading(reading_t* reading);
-// empty the queue of all readings
-void meas_clear_readings(void);
 
 void meas_mode_func_off(meas_event_t event, reading_t* reading);
 
@@ -0,0 +1,115 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "measurement/minmax.h"
+
+#include "acquisition/reading.h"
+#include "system/clock.h"
+#include "system/fixmath.h"
+
+// forget everything
+void minmax_clear(minmax_t* mm) {
+    mm->count = 0;
+    mm->min = 0;
+    mm->max = 0;
+    mm->min_ms = 0;
+    mm->max_ms = 0;
+    mm->mean = 0;
+    mm->var = 0;
+}
+
+// add a value to the statistics
+HOT_FUNC void minmax_add(minmax_t* mm, int32_t millicounts, uint32_t time_ms) {
+    if (mm->count == 0 || millicounts < mm->min) {
+        mm->min = millicounts;
+        mm->min_ms = time_ms;
+    }
+    if (mm->count == 0 || millicounts > mm->max) {
+        mm->max = millicounts;
+        mm->max_ms = time_ms;
+    }
+    mm->count++;
+
+    // Welford, but keeping the variance instead of the sum of squares.
+    // the sum would overflow after a few thousand full scale readings,
+    // but the variance can't be bigger than the range squared
+    int64_t x = (int64_t)millicounts << MINMAX_MEAN_FRAC;
+    int64_t delta = x - mm->mean;
+    mm->mean += delta / (int64_t)mm->count;
+    int64_t delta2 = x - mm->mean;
+    // drop the fraction before multiplying so the product can't overflow
+    int64_t sq = (delta >> MINMAX_MEAN_FRAC) * (delta2 >> MINMAX_MEAN_FRAC);
+    mm->var += (sq - mm->var) / (int64_t)mm->count;
+}
+
+// the mean and standard deviation, in millicounts
+int32_t minmax_get_mean(const minmax_t* mm) {
+    // round it
+    return (int32_t)((mm->mean + (1 << (MINMAX_MEAN_FRAC-1)))
+        >> MINMAX_MEAN_FRAC);
+}
+
+int32_t minmax_get_stddev(const minmax_t* mm) {
+    // rounding can make a constant input's variance a hair negative
+    if (mm->var <= 0) {
+        return 0;
+    }
+    return (int32_t)fix_isqrt64((uint64_t)mm->var);
+}
+
+// only the measurement job adds to this
+static minmax_session_t session;
+
+// start the session over
+void minmax_session_reset(void) {
+    __disable_irq();
+    minmax_clear(&session.mm);
+    __enable_irq();
+}
+
+// called by the measurement job with each acquired reading
+HOT_FUNC void minmax_session_put(const reading_t* reading) {
+    // the sub readings are the other half of a pair and would just
+    // mix two different things together
+    if (reading->kind != RDG_KIND_MAIN) {
+        return;
+    }
+    // everybody else is in a lower priority job and disables interrupts
+    // to look at the session, so we don't have to
+    if (reading->unit != session.unit ||
+            reading->exponent != session.exponent ||
+            reading->decimal != session.decimal) {
+        minmax_clear(&session.mm);
+        session.unit = reading->unit;
+        session.exponent = reading->exponent;
+        session.decimal = reading->decimal;
+    }
+    minmax_add(&session.mm, reading->millicounts, reading->time_ms);
+}
+
+// get a copy of the session. returns false if it has no readings yet
+bool minmax_session_get(minmax_session_t* s) {
+    __disable_irq();
+    *s = session;
+    __enable_irq();
+    return s->mm.count != 0;
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef MEASUREMENT_MINMAX_H
+#define MEASUREMENT_MINMAX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acquisition/reading.h"
+
+// this file keeps running statistics of a stream of readings: min, max,
+// mean and standard deviation. it's constant time and memory per reading,
+// so a session can go on for as long as anybody wants.
+
+// the mean and variance are done with Welford's method, so nothing grows
+// with the number of readings. the mean has this many bits of fraction so
+// it doesn't stop moving when the count gets big
+#define MINMAX_MEAN_FRAC (16)
+
+typedef struct {
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    // time_ms of the readings the extremes came from
+    uint32_t min_ms;
+    uint32_t max_ms;
+    // in millicounts, with MINMAX_MEAN_FRAC bits of fraction
+    int64_t mean;
+    // the population variance, in millicounts squared
+    int64_t var;
+} minmax_t;
+
+// forget everything
+void minmax_clear(minmax_t* mm);
+// add a value to the statistics
+void minmax_add(minmax_t* mm, int32_t millicounts, uint32_t time_ms);
+// the mean and standard deviation, in millicounts
+int32_t minmax_get_mean(const minmax_t* mm);
+int32_t minmax_get_stddev(const minmax_t* mm);
+
+// the measurement engine keeps a session going over every main reading,
+// before the measurement modes average them, so short extremes get caught
+typedef struct {
+    minmax_t mm;
+    // the format of the readings. if it changes, the session starts over,
+    // since the old numbers don't mean the same thing anymore
+    rdg_unit_t unit;
+    rdg_exponent_t exponent;
+    rdg_decimal_t decimal;
+} minmax_session_t;
+
+// start the session over
+void minmax_session_reset(void);
+// called by the measurement job with each acquired reading
+void minmax_session_put(const reading_t* reading);
+// get a copy of the session. returns false if it has no readings yet
+bool minmax_session_get(minmax_session_t* session);
+
+#endif
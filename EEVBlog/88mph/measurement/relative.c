@@ -0,0 +1,78 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "measurement/relative.h"
+
+#include "acquisition/reading.h"
+
+static bool rel_on = false;
+static bool have_reference = false;
+static reading_t reference;
+
+// make the next reading through rel_apply() the reference
+void rel_start(void) {
+    rel_on = true;
+    have_reference = false;
+}
+
+// go back to showing the real readings
+void rel_stop(void) {
+    rel_on = false;
+    have_reference = false;
+}
+
+bool rel_is_on(void) {
+    return rel_on;
+}
+
+// get the reference. returns false if there isn't one yet
+bool rel_get_reference(reading_t* r) {
+    if (!have_reference) {
+        return false;
+    }
+    *r = reference;
+    return true;
+}
+
+// subtract the reference from a reading
+void rel_apply(reading_t* reading) {
+    if (!rel_on) {
+        return;
+    }
+    if (!have_reference) {
+        reference = *reading;
+        have_reference = true;
+    } else if (reading->unit != reference.unit ||
+            reading->exponent != reference.exponent ||
+            reading->decimal != reference.decimal) {
+        rel_stop();
+        return;
+    }
+    // the difference can be bigger than either of them, so don't let it
+    // wrap around
+    int64_t diff = (int64_t)reading->millicounts - reference.millicounts;
+    if (diff > INT32_MAX) {
+        diff = INT32_MAX;
+    } else if (diff < INT32_MIN) {
+        diff = INT32_MIN;
+    }
+    reading->millicounts = (int32_t)diff;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef MEASUREMENT_RELATIVE_H
+#define MEASUREMENT_RELATIVE_H
+
+#include <stdbool.h>
+
+#include "acquisition/reading.h"
+
+// this file does REL: showing readings as the difference from a reference
+// reading. it's only for the screen, so the PC and the logger still get the
+// real readings. everything here is called from the system job.
+
+// make the next reading through rel_apply() the reference
+void rel_start(void);
+// go back to showing the real readings
+void rel_stop(void);
+// if REL is on, even if it's still waiting for its reference
+bool rel_is_on(void);
+// get the reference. returns false if there isn't one yet
+bool rel_get_reference(reading_t* reference);
+
+// subtract the reference from a reading, in millicounts so it happens
+// before the screen rounds anything. if the reading's unit, exponent or
+// decimal point changed, the reference doesn't mean anything anymore, so
+// REL turns off and the reading is left alone
+void rel_apply(reading_t* reading);
+
+#endif
\ No newline at end of file
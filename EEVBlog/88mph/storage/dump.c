@@ -0,0 +1,246 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "storage/dump.h"
+
+#include "storage/sd.h"
+#include "comms/stream.h"
+#include "comms/uart.h"
+#include "system/job.h"
+#include "system/clock.h"
+#include "fatfs.h"
+
+// how much CSV we build up before writing it to the card
+// one sector at a time keeps FatFs happy
+#define DUMP_SD_CHUNK (512)
+
+// the SD card work clears this when it's done, so it's volatile
+static const dump_source_t* volatile curr_source = 0;
+static dump_dest_t curr_dest;
+// the next record to dump
+static volatile uint32_t curr_index = 0;
+static volatile bool last_failed = false;
+// set by dump_abort for the SD card work to see between chunks
+static volatile bool abort_requested = false;
+
+static char sd_chunk[DUMP_SD_CHUNK];
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void sd_open_work(uint32_t arg);
+
+// start dumping source to dest. the source must stay around until it's done.
+// returns false if a dump is already going. if the SD card isn't usable,
+// that shows up as DUMP_FAILED once the dump has had a look at it.
+// only the system job may start or abort dumps.
+bool dump_start(const dump_source_t* source, dump_dest_t dest) {
+    if (curr_source) {
+        return false;
+    }
+    curr_dest = dest;
+    curr_index = 0;
+    last_failed = false;
+    abort_requested = false;
+    curr_source = source;
+    if (dest == DUMP_TO_SD) {
+        // the card is slow, so it's done as low priority work
+        if (!job_post(JOB_LEVEL_LOW, sd_open_work, 0)) {
+            curr_source = 0;
+            return false;
+        }
+    } else {
+        // get going
+        job_schedule(JOB_SYSTEM);
+    }
+    return true;
+}
+
+// stop the dump that's going, if any
+void dump_abort(void) {
+    if (!curr_source) {
+        return;
+    }
+    if (curr_dest == DUMP_TO_SD) {
+        // the card work might be in the middle of a write, so it closes the
+        // file itself once it sees this
+        abort_requested = true;
+    } else {
+        curr_source = 0;
+    }
+}
+
+// send as many frames as fit in the UART buffer
+static void process_uart(void) {
+    const dump_source_t* src = curr_source;
+    uint8_t payload[STREAM_MAX_PAYLOAD];
+    uint32_t per_frame =
+        (STREAM_MAX_PAYLOAD - DUMP_FRAME_HEADER_SIZE) / src->record_size;
+
+    while (curr_index < src->count) {
+        uint32_t num = src->count - curr_index;
+        if (num > per_frame) {
+            num = per_frame;
+        }
+        payload[0] = (uint8_t)src->id;
+        payload[1] = src->record_size;
+        put_u32(&payload[2], curr_index);
+        put_u32(&payload[6], src->count);
+        put_u32(&payload[10], src->marker);
+        uint8_t len = DUMP_FRAME_HEADER_SIZE;
+        for (uint32_t ri=0; ri<num; ri++) {
+            if (!src->get_record(curr_index+ri, &payload[len])) {
+                // the source lost it, so there's no point going on
+                last_failed = true;
+                curr_source = 0;
+                return;
+            }
+            len += src->record_size;
+        }
+        if (!stream_send_frame(STREAM_FRAME_DUMP, payload, len)) {
+            // the buffer is full. come back when some of it has gone out
+            uart_request_tx_wakeup();
+            return;
+        }
+        curr_index += num;
+    }
+    curr_source = 0;
+}
+
+// the SD card is only touched from JOB_LEVEL_LOW work. that keeps FatFs
+// from being reentered by the logger, and keeps the system job from
+// waiting on the card.
+
+static void sd_chunk_work(uint32_t arg);
+
+// close the file and let go of everything
+static void sd_finish(bool failed) {
+    if (f_close(&SDFile) != FR_OK) {
+        failed = true;
+    }
+    clock_release(CLOCK_REQ_SD);
+    last_failed = failed;
+    curr_source = 0;
+    // so the console can see how it went
+    job_schedule(JOB_SYSTEM);
+}
+
+// mount the card, create the file and write the header
+static void sd_open_work(uint32_t arg) {
+    const dump_source_t* src = curr_source;
+    // the card can't run without the PLL
+    clock_request(CLOCK_REQ_SD);
+    if (abort_requested || !sd_mount() || f_open(&SDFile, src->filename,
+            FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        bool failed = !abort_requested;
+        last_failed = failed;
+        curr_source = 0;
+        if (failed) {
+            // maybe the card was swapped, so try again from scratch next
+            // time. that has to wait until we aren't busy any more
+            sd_unmount();
+        }
+        clock_release(CLOCK_REQ_SD);
+        job_schedule(JOB_SYSTEM);
+        return;
+    }
+    UINT len = strlen(src->csv_header);
+    UINT written;
+    if (f_write(&SDFile, src->csv_header, len, &written) != FR_OK ||
+            written != len) {
+        sd_finish(true);
+        return;
+    }
+    if (!job_post(JOB_LEVEL_LOW, sd_chunk_work, 0)) {
+        sd_finish(true);
+    }
+}
+
+// write one chunk of lines to the card
+static void sd_chunk_work(uint32_t arg) {
+    const dump_source_t* src = curr_source;
+    if (abort_requested) {
+        // close it so what was written so far is at least readable
+        sd_finish(false);
+        return;
+    }
+    UINT len = 0;
+    uint32_t index = curr_index;
+    bool lost = false;
+    while (index < src->count && len <= DUMP_SD_CHUNK-DUMP_MAX_LINE) {
+        uint8_t n = src->format_record(index, &sd_chunk[len]);
+        if (!n) {
+            lost = true;
+            break;
+        }
+        len += n;
+        index++;
+    }
+    curr_index = index;
+
+    // the lines before a lost record are still good, so write them anyway
+    UINT written;
+    if (f_write(&SDFile, sd_chunk, len, &written) != FR_OK ||
+            written != len || lost) {
+        sd_finish(true);
+        return;
+    }
+
+    if (index == src->count) {
+        sd_finish(false);
+    } else if (!job_post(JOB_LEVEL_LOW, sd_chunk_work, 0)) {
+        // do the rest as separate work so anything else waiting gets a turn
+        sd_finish(true);
+    }
+}
+
+// called by the system job to do the next bit of dumping over the UART
+// the SD card does its own
+void dump_process(void) {
+    if (!curr_source || curr_dest != DUMP_TO_UART) {
+        return;
+    }
+    process_uart();
+}
+
+// get how it's going. done and total are in records
+dump_status_t dump_get_status(uint32_t* done, uint32_t* total) {
+    if (!curr_source) {
+        *done = 0;
+        *total = 0;
+        return last_failed ? DUMP_FAILED : DUMP_IDLE;
+    }
+    *done = curr_index;
+    *total = curr_source->count;
+    return DUMP_BUSY;
+}
+
+// true if a dump of the source with this id is going. a source mustn't
+// change its records until it's done
+bool dump_is_busy_with(dump_id_t id) {
+    const dump_source_t* src = curr_source;
+    return src && src->id == id;
+}
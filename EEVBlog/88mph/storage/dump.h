@@ -0,0 +1,104 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef STORAGE_DUMP_H
+#define STORAGE_DUMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file sends big buffers of records somewhere, a little at a time, so
+// the UI keeps running while it's happening. the UART is fed from the system
+// job, and the SD card from JOB_LEVEL_LOW work.
+
+// over the UART, records go out in STREAM_FRAME_DUMP frames, as many as fit
+// in each. the payload is (multibyte values are little endian):
+//   uint8 source id (dump_id_t), uint8 record size,
+//   uint32 index of the first record in this frame, uint32 total records,
+//   uint32 marker (what it means depends on the source),
+//   then the records
+#define DUMP_FRAME_HEADER_SIZE (14)
+
+// to the SD card, records are written as lines of CSV into a file
+
+// the longest line format_record may produce, including the newline
+#define DUMP_MAX_LINE (48)
+
+// do not change the values!! the host tool knows them
+typedef enum {
+    // records are capture_sample_t, marker is the trigger's index
+    DUMP_ID_CAPTURE = 1,
+    // records are trace_entry_t, marker is how many events were lost
+    DUMP_ID_TRACE = 2
+} dump_id_t;
+
+typedef enum {
+    DUMP_TO_UART = 0,
+    DUMP_TO_SD
+} dump_dest_t;
+
+typedef struct {
+    dump_id_t id;
+    // file to write on the SD card. 8.3 names only!
+    const char* filename;
+    // first line of the file
+    const char* csv_header;
+    // how many records there are
+    uint32_t count;
+    // sent along with the records for the PC
+    uint32_t marker;
+    // how big one binary record is
+    uint8_t record_size;
+    // put record number index into record as bytes, for the UART
+    // returns false if the record is gone, which stops the dump as failed
+    bool (*get_record)(uint32_t index, uint8_t* record);
+    // write record number index into text as a line of CSV, for the SD card
+    // returns the length, which must be at most DUMP_MAX_LINE. 0 means the
+    // record is gone, which stops the dump as failed
+    uint8_t (*format_record)(uint32_t index, char* text);
+} dump_source_t;
+
+typedef enum {
+    // not dumping anything
+    DUMP_IDLE = 0,
+    // still going
+    DUMP_BUSY,
+    // the last dump didn't finish because the SD card had a problem, or
+    // wasn't usable at all, or the source lost its records
+    DUMP_FAILED
+} dump_status_t;
+
+// start dumping source to dest. the source must stay around until it's done.
+// returns false if a dump is already going. if the SD card isn't usable,
+// that shows up as DUMP_FAILED once the dump has had a look at it.
+// only the system job may start or abort dumps.
+bool dump_start(const dump_source_t* source, dump_dest_t dest);
+// stop the dump that's going, if any
+void dump_abort(void);
+
+// called by the system job to do the next bit of dumping over the UART
+// the SD card does its own
+void dump_process(void);
+
+// get how it's going. done and total are in records
+dump_status_t dump_get_status(uint32_t* done, uint32_t* total);
+// true if a dump of the source with this id is going. a source mustn't
+// change its records until it's done
+bool dump_is_busy_with(dump_id_t id);
+
+#endif
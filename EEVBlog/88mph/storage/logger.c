@@ -0,0 +1,436 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "storage/logger.h"
+
+#include "storage/sd.h"
+#include "measurement/measurement.h"
+#include "measurement/meas_modes.h"
+#include "measurement/bus.h"
+#include "measurement/minmax.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "hardware/rtc.h"
+#include "comms/uart.h"
+#include "system/job.h"
+#include "system/timer.h"
+#include "system/idle.h"
+#include "system/clock.h"
+#include "system/text.h"
+#include "fatfs.h"
+
+typedef enum {
+    // not logging
+    LOGGER_STATE_IDLE=0,
+    // waiting for the card work to say whether the card is usable
+    LOGGER_STATE_CHECKING,
+    // front end off, waiting for the alarm
+    LOGGER_STATE_ASLEEP,
+    // front end on, waiting for the readings to settle
+    LOGGER_STATE_SETTLING,
+    // taking the burst of readings to log
+    LOGGER_STATE_BURST
+} logger_state_t;
+
+static logger_state_t state = LOGGER_STATE_IDLE;
+static logger_status_t status;
+
+// what we're logging, and what to put back when we stop
+static meas_mode_t log_mode;
+static uint8_t log_range;
+static uint8_t saved_filter;
+static bool quiet;
+static bool uart_is_off = false;
+
+// how long each mode takes to settle after the front end turns on
+static bool settle_known[MEAS_NUM_MODES];
+static uint32_t settle_us[MEAS_NUM_MODES];
+
+// when the front end was turned on this time
+static uint32_t on_us;
+static uint32_t on_ms;
+// when logging started, so entries can be timestamped relative to it
+static uint32_t start_ms;
+
+// for finding when the readings stop moving
+static bool have_last;
+static int32_t last_millicounts;
+static uint8_t matches;
+// when the run of matching readings started, relative to on_us
+static uint32_t run_start_us;
+
+static int64_t burst_sum;
+static uint8_t burst_count;
+// statistics of every settled reading since logging started
+// the measurement engine's session would also see the unsettled ones
+static minmax_t log_mm;
+
+// the dumper has SDFile, so we have our own
+static FIL log_file;
+
+// the card is only touched from JOB_LEVEL_LOW work, so the system job never
+// waits on it. the work says how it went here, and the system job picks it
+// up in logger_process.
+typedef enum {
+    CARD_IDLE=0,
+    // work has been posted and hasn't finished
+    CARD_BUSY,
+    CARD_OK,
+    CARD_FAILED
+} card_result_t;
+static volatile card_result_t card_result = CARD_IDLE;
+
+// the entry being written, formatted by the system job
+static char entry_line[112];
+static uint8_t entry_len;
+
+static const char csv_header[] =
+    "time_ms,mode,range,millicounts,settle_ms,min,max,mean,sd\n";
+
+// open the log for appending, writing the header if it's new. the card
+// must be mounted and CLOCK_REQ_SD held.
+static bool open_log(void) {
+    if (f_open(&log_file, LOGGER_FILENAME,
+            FA_OPEN_ALWAYS | FA_WRITE) != FR_OK) {
+        return false;
+    }
+    if (f_lseek(&log_file, f_size(&log_file)) != FR_OK) {
+        f_close(&log_file);
+        return false;
+    }
+    if (f_size(&log_file) == 0) {
+        UINT len = sizeof(csv_header)-1;
+        UINT written;
+        if (f_write(&log_file, csv_header, len, &written) != FR_OK ||
+                written != len) {
+            f_close(&log_file);
+            return false;
+        }
+    }
+    return true;
+}
+
+// the card work is done, so tell the system job
+static void card_done(bool ok) {
+    card_result = ok ? CARD_OK : CARD_FAILED;
+    job_schedule(JOB_SYSTEM);
+}
+
+// append entry_line to the log. the file is closed again afterwards, so
+// the log is intact if the card is pulled or the battery dies
+static void write_entry_work(uint32_t arg) {
+    // the card can't run without the PLL
+    clock_request(CLOCK_REQ_SD);
+    bool ok = sd_mount() && open_log();
+    if (ok) {
+        UINT written;
+        ok = f_write(&log_file, entry_line, entry_len, &written) == FR_OK &&
+            written == entry_len;
+        ok = (f_close(&log_file) == FR_OK) && ok;
+    }
+    if (!ok) {
+        // maybe the card was swapped, so try again from scratch next time
+        sd_unmount();
+    }
+    clock_release(CLOCK_REQ_SD);
+    card_done(ok);
+}
+
+// make sure the card is there now, instead of finding out tomorrow
+static void check_card_work(uint32_t arg) {
+    clock_request(CLOCK_REQ_SD);
+    bool ok = sd_mount() && open_log();
+    if (ok) {
+        ok = f_close(&log_file) == FR_OK;
+    }
+    if (!ok) {
+        sd_unmount();
+    }
+    clock_release(CLOCK_REQ_SD);
+    card_done(ok);
+}
+
+// format one entry and get the card work to append it. returns false if
+// the last one is somehow still being written
+static bool write_entry(int32_t millicounts) {
+    if (card_result == CARD_BUSY) {
+        return false;
+    }
+    char* line = entry_line;
+    uint8_t len = 0;
+    len += text_put_uint(&line[len], on_ms - start_ms);
+    line[len++] = ',';
+    len += text_put_uint(&line[len], log_mode);
+    line[len++] = ',';
+    len += text_put_uint(&line[len], log_range);
+    line[len++] = ',';
+    len += text_put_int(&line[len], millicounts);
+    line[len++] = ',';
+    len += text_put_uint(&line[len], settle_us[log_mode]/1000);
+    line[len++] = ',';
+    len += text_put_int(&line[len], log_mm.min);
+    line[len++] = ',';
+    len += text_put_int(&line[len], log_mm.max);
+    line[len++] = ',';
+    len += text_put_int(&line[len], minmax_get_mean(&log_mm));
+    line[len++] = ',';
+    len += text_put_int(&line[len], minmax_get_stddev(&log_mm));
+    line[len++] = '\n';
+    entry_len = len;
+
+    card_result = CARD_BUSY;
+    if (!job_post(JOB_LEVEL_LOW, write_entry_work, 0)) {
+        card_result = CARD_IDLE;
+        return false;
+    }
+    return true;
+}
+
+// turn the front end on and start measuring
+static void power_up(void) {
+    on_us = TIMER_US_NOW();
+    on_ms = timer_1ms_ticks;
+    acq_init();
+    __disable_irq();
+    job_enable(JOB_ACQUISITION);
+    __enable_irq();
+    meas_set_mode(log_mode);
+    meas_set_range(log_range);
+    bus_subscribe(BUS_SUB_LOGGER, 1, BUS_MAX_DEPTH, JOB_SYSTEM);
+    // in case the readings never come
+    idle_request_wakeup(LOGGER_AWAKE_MAX_MS);
+
+    have_last = false;
+    matches = 0;
+    burst_sum = 0;
+    burst_count = 0;
+    state = LOGGER_STATE_SETTLING;
+}
+
+// turn the front end off and wait for the next alarm
+static void power_down(void) {
+    bus_unsubscribe(BUS_SUB_LOGGER);
+    // this lets go of the clocks too
+    meas_set_mode(MEAS_MODE_OFF);
+    acq_deinit();
+    state = LOGGER_STATE_ASLEEP;
+}
+
+// log whatever we got this time and go back to sleep
+// entries are counted once the card work says they made it
+static void finish_burst(void) {
+    if (!burst_count || !write_entry((int32_t)(burst_sum/burst_count))) {
+        status.misses++;
+    }
+    power_down();
+}
+
+static void handle_reading(const reading_t* reading) {
+    uint32_t since_us = reading->time_us - on_us;
+
+    // only the main quantity gets logged
+    if (reading->kind != RDG_KIND_MAIN) {
+        return;
+    }
+
+    if (state == LOGGER_STATE_SETTLING) {
+        if (settle_known[log_mode]) {
+            if (since_us < settle_us[log_mode]) {
+                return;
+            }
+        } else {
+            int32_t diff = reading->millicounts - last_millicounts;
+            if (have_last && diff <= LOGGER_SETTLE_TOLERANCE &&
+                    diff >= -LOGGER_SETTLE_TOLERANCE) {
+                matches++;
+            } else {
+                matches = 0;
+                run_start_us = since_us;
+            }
+            have_last = true;
+            last_millicounts = reading->millicounts;
+            if (matches >= LOGGER_SETTLE_MATCHES) {
+                // it was settled from the start of the run
+                settle_us[log_mode] = run_start_us;
+            } else if (since_us >= LOGGER_SETTLE_MAX_MS*1000) {
+                // give up and wait this long every time
+                settle_us[log_mode] = since_us;
+            } else {
+                return;
+            }
+            settle_known[log_mode] = true;
+        }
+        state = LOGGER_STATE_BURST;
+    }
+
+    burst_sum += reading->millicounts;
+    minmax_add(&log_mm, reading->millicounts, reading->time_ms);
+    if (++burst_count >= LOGGER_BURST) {
+        finish_burst();
+    }
+}
+
+// start logging the current measurement mode and range every interval
+// seconds. if quiet is true, the UART is turned off while logging so we
+// can go into STOP between entries. returns false if the interval is out of
+// range, the mode is off, or the last entry is still being written. the
+// card gets checked afterwards, and logging stops with card_failed set if
+// it isn't usable.
+bool logger_start(uint32_t interval, bool be_quiet) {
+    if (state != LOGGER_STATE_IDLE || interval < LOGGER_MIN_INTERVAL ||
+            interval > LOGGER_MAX_INTERVAL || card_result == CARD_BUSY) {
+        return false;
+    }
+    log_mode = meas_get_mode();
+    if (log_mode == MEAS_MODE_OFF) {
+        return false;
+    }
+    card_result = CARD_BUSY;
+    if (!job_post(JOB_LEVEL_LOW, check_card_work, 0)) {
+        card_result = CARD_IDLE;
+        return false;
+    }
+    log_range = meas_get_range();
+    quiet = be_quiet;
+    status.running = true;
+    status.card_failed = false;
+    status.interval = interval;
+    status.entries = 0;
+    status.misses = 0;
+    state = LOGGER_STATE_CHECKING;
+    return true;
+}
+
+// the card is fine, so get going for real
+static void finish_start(void) {
+    // we do our own averaging, and want to see the readings settle as
+    // soon as they do
+    saved_filter = meas_get_filter();
+    meas_set_filter(1);
+
+    start_ms = timer_1ms_ticks;
+    minmax_clear(&log_mm);
+
+    // the first entry comes one interval from now, so it starts cold
+    // like all the others
+    rtc_set_alarm(status.interval);
+    power_down();
+}
+
+// stop logging and turn everything back on like it was before
+void logger_stop(void) {
+    if (state == LOGGER_STATE_IDLE) {
+        return;
+    }
+    if (state == LOGGER_STATE_CHECKING) {
+        // nothing was changed yet. the card work's answer just gets ignored
+        status.running = false;
+        state = LOGGER_STATE_IDLE;
+        return;
+    }
+    rtc_cancel_alarm();
+    if (state == LOGGER_STATE_ASLEEP) {
+        acq_init();
+        __disable_irq();
+        job_enable(JOB_ACQUISITION);
+        __enable_irq();
+        meas_set_mode(log_mode);
+        meas_set_range(log_range);
+    } else {
+        bus_unsubscribe(BUS_SUB_LOGGER);
+    }
+    meas_set_filter(saved_filter);
+    if (uart_is_off) {
+        uart_init();
+        uart_is_off = false;
+    }
+    status.running = false;
+    state = LOGGER_STATE_IDLE;
+}
+
+// called by the system job to keep the logger going
+void logger_process(void) {
+    // see how the card work did
+    card_result_t result = card_result;
+    if (result == CARD_OK || result == CARD_FAILED) {
+        card_result = CARD_IDLE;
+        if (state == LOGGER_STATE_CHECKING) {
+            if (result == CARD_OK) {
+                finish_start();
+            } else {
+                status.running = false;
+                status.card_failed = true;
+                state = LOGGER_STATE_IDLE;
+            }
+        } else if (state != LOGGER_STATE_IDLE) {
+            if (result == CARD_OK) {
+                status.entries++;
+            } else {
+                status.misses++;
+            }
+        }
+    }
+    if (state == LOGGER_STATE_IDLE || state == LOGGER_STATE_CHECKING) {
+        return;
+    }
+    if (state != LOGGER_STATE_ASLEEP) {
+        reading_t reading;
+        while (state != LOGGER_STATE_ASLEEP &&
+                bus_get(BUS_SUB_LOGGER, &reading)) {
+            handle_reading(&reading);
+        }
+        if (state != LOGGER_STATE_ASLEEP &&
+                timer_1ms_ticks - on_ms >= LOGGER_AWAKE_MAX_MS) {
+            // the HY isn't answering, so log what we have, if anything
+            finish_burst();
+        }
+    }
+    // the alarm might have gone off while we were awake, if the interval
+    // is shorter than it takes to settle
+    if (state == LOGGER_STATE_ASLEEP && rtc_alarm_fired()) {
+        // set the next alarm now so the entries don't drift by however
+        // long we're awake
+        rtc_set_alarm(status.interval);
+        power_up();
+    }
+    if (quiet && !uart_is_off) {
+        // the UART is what keeps us out of STOP. this is done here instead
+        // of when starting so the console's reply gets out first
+        uart_flush();
+        uart_deinit();
+        uart_is_off = true;
+    }
+}
+
+void logger_get_status(logger_status_t* s) {
+    *s = status;
+}
+
+// how long a mode was found to take to settle, in ms
+// returns false if it hasn't been found yet
+bool logger_get_settle_ms(meas_mode_t mode, uint32_t* settle_ms) {
+    if (!settle_known[mode]) {
+        return false;
+    }
+    *settle_ms = settle_us[mode]/1000;
+    return true;
+}
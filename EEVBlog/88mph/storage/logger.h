@@ -0,0 +1,88 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef STORAGE_LOGGER_H
+#define STORAGE_LOGGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "measurement/meas_modes.h"
+
+// this file logs a reading to the SD card every so often for a long time
+// between readings, the HY3131 and the analog supplies are turned off and
+// the RTC alarm wakes us up out of STOP to take the next one. once the
+// front end is back on, we wait for it to settle, average a short burst of
+// readings, write them to the card and turn everything off again.
+
+// how long it takes to settle is different for each mode, so the first
+// time a mode is logged we watch the readings until they stop moving and
+// remember how long that took. later wakeups just throw away readings from
+// before then, so the front end is on for as short a time as possible.
+
+// the file the log is appended to
+#define LOGGER_FILENAME "LOG.CSV"
+
+// the readings are settled once this many in a row are each within
+// LOGGER_SETTLE_TOLERANCE millicounts of the one before
+#define LOGGER_SETTLE_MATCHES (3)
+#define LOGGER_SETTLE_TOLERANCE (5000)
+// if it still hasn't settled after this long, take the readings anyway
+#define LOGGER_SETTLE_MAX_MS (2000)
+// how many settled readings are averaged into one logged value
+#define LOGGER_BURST (4)
+// give up on a wakeup if it's taken this long, e.g. the HY isn't answering
+#define LOGGER_AWAKE_MAX_MS (LOGGER_SETTLE_MAX_MS+2000)
+
+// the shortest and longest time between log entries
+// the alarm can't be set more than a day ahead
+#define LOGGER_MIN_INTERVAL (2)
+#define LOGGER_MAX_INTERVAL (86399)
+
+typedef struct {
+    bool running;
+    // seconds between entries
+    uint32_t interval;
+    // entries successfully written
+    uint32_t entries;
+    // wakeups that didn't get written, because of no readings or the card
+    uint32_t misses;
+    // the card wasn't usable when logging was last started
+    bool card_failed;
+} logger_status_t;
+
+// start logging the current measurement mode and range every interval
+// seconds. if quiet is true, the UART is turned off while logging so we
+// can go into STOP between entries. returns false if the interval is out of
+// range, the mode is off, or the last entry is still being written. the
+// card gets checked afterwards by JOB_LEVEL_LOW work, and logging stops
+// with card_failed set if it isn't usable.
+// only the system job may start and stop logging.
+bool logger_start(uint32_t interval, bool quiet);
+// stop logging and turn everything back on like it was before
+void logger_stop(void);
+
+// called by the system job to keep the logger going
+void logger_process(void);
+
+void logger_get_status(logger_status_t* status);
+// how long a mode was found to take to settle, in ms
+// returns false if it hasn't been found yet
+bool logger_get_settle_ms(meas_mode_t mode, uint32_t* settle_ms);
+
+#endif
@@ -0,0 +1,91 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdbool.h>
+
+#include "storage/sd.h"
+
+#include "storage/dump.h"
+#include "stm32l1xx.h"
+#include "fatfs.h"
+
+// cube's handle for the SDIO peripheral
+extern SD_HandleTypeDef hsd;
+
+static bool sd_is_mounted = false;
+
+// main doesn't set up the SDIO or link FatFs any more, so that's done the
+// first time the card is mounted. it's in main.c
+void MX_SDIO_SD_Init(void);
+static bool sd_is_inited = false;
+
+// the SDIO gets 48MHz from the PLL, and divides it by ClockDiv+2 to make
+// the card's clock. APB2 must be at least 3/8 of the card's clock, so work
+// out the smallest divider that keeps that true at the current speed.
+static uint32_t sdio_clock_div(void) {
+    uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+    uint32_t min_total = (48000000U*3 + 8*pclk2 - 1)/(8*pclk2);
+    return min_total > 2 ? min_total-2 : 0;
+}
+
+// the system clock changed speed, so fix up the card's clock divider
+void sd_clock_changed(void) {
+    hsd.Init.ClockDiv = sdio_clock_div();
+    // if the card is being used, change the divider it's using now too
+    if (SDIO->POWER & SDIO_POWER_PWRCTRL) {
+        MODIFY_REG(SDIO->CLKCR, SDIO_CLKCR_CLKDIV, hsd.Init.ClockDiv);
+    }
+}
+
+// mount the card if it isn't already. returns false if there's no usable card
+bool sd_mount(void) {
+    if (sd_is_mounted) {
+        return true;
+    }
+    if (!sd_is_inited) {
+        MX_SDIO_SD_Init();
+        MX_FATFS_Init();
+        // cube's divider is for the wrong speed
+        sd_clock_changed();
+        sd_is_inited = true;
+    }
+    // mount immediately so we find out now if the card is bad
+    if (f_mount(&SDFatFS, SDPath, 1) != FR_OK) {
+        return false;
+    }
+    sd_is_mounted = true;
+    return true;
+}
+
+// unmount the card, e.g. if it has been removed. refuses and returns false
+// while a dump to the card is going, since its file is still open on it
+bool sd_unmount(void) {
+    if (!sd_is_mounted) {
+        return true;
+    }
+    // the logger failing between two of the dump's chunks would otherwise
+    // pull the volume out from under SDFile. if the card really is gone,
+    // the dump fails too and it can be unmounted after that.
+    uint32_t done, total;
+    if (dump_get_status(&done, &total) == DUMP_BUSY) {
+        return false;
+    }
+    f_mount(NULL, SDPath, 0);
+    sd_is_mounted = false;
+    return true;
+}
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef STORAGE_SD_H
+#define STORAGE_SD_H
+
+#include <stdbool.h>
+
+// this file looks after the SD card
+// nothing sets up the SDIO, links the FatFs driver or mounts the card until
+// someone needs it
+
+// FatFs is not reentrant, so the card is only used from JOB_LEVEL_LOW work!
+// work at one level never interrupts other work at the same level.
+
+// mount the card if it isn't already. returns false if there's no usable card
+bool sd_mount(void);
+// unmount the card, e.g. if it has been removed. refuses and returns false
+// while a dump to the card is going, since its file is still open on it
+bool sd_unmount(void);
+
+// the SDIO's clock comes from the PLL, so anybody using the card must
+// request CLOCK_REQ_SD first
+
+// the system clock changed speed, so fix up the card's clock divider
+void sd_clock_changed(void);
+
+#endif
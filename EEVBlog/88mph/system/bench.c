@@ -0,0 +1,70 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include "stm32l1xx.h"
+
+#include "system/bench.h"
+
+#include "system/clock.h"
+
+static bench_counter_t counters[BENCH_NUM_COUNTERS];
+
+// start the cycle counter
+void bench_init(void) {
+    // the DWT is part of the debug stuff, which is off unless told otherwise
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    bench_reset();
+}
+
+// record that something started at start cycles and ended now
+// safe from any job
+HOT_FUNC void bench_record(bench_counter_id_t which, uint32_t start) {
+    uint32_t elapsed = BENCH_NOW() - start;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bench_counter_t* c = &counters[which];
+    c->runs++;
+    c->total += elapsed;
+    if (elapsed < c->min) {
+        c->min = elapsed;
+    }
+    if (elapsed > c->max) {
+        c->max = elapsed;
+    }
+    __set_PRIMASK(primask);
+}
+
+// get a copy of a counter
+void bench_get(bench_counter_id_t which, bench_counter_t* counter) {
+    __disable_irq();
+    *counter = counters[which];
+    __enable_irq();
+}
+
+// zero all of them
+void bench_reset(void) {
+    __disable_irq();
+    for (int i=0; i<BENCH_NUM_COUNTERS; i++) {
+        counters[i] = (bench_counter_t){0};
+        counters[i].min = UINT32_MAX;
+    }
+    __enable_irq();
+}
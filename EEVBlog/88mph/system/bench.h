@@ -0,0 +1,64 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_BENCH_H
+#define SYSTEM_BENCH_H
+
+#include <stdint.h>
+#include "stm32l1xx.h"
+
+// this file counts CPU cycles through the hot path, so different clock,
+// flash, and RAM function setups can be compared exactly. the profile's
+// microsecond times can't see the difference a wait state makes.
+// like the profile, the counts include time spent in any higher priority
+// jobs that interrupted the one being measured.
+
+typedef enum {
+    // the whole acquisition job, from the EXTI interrupt to the end
+    BENCH_ACQ_JOB=0,
+    // one HY3131 register read, which is all bit-banging
+    BENCH_HY_READ,
+    BENCH_NUM_COUNTERS
+} bench_counter_id_t;
+
+typedef struct {
+    uint32_t runs;
+    // fewest, most, and total cycles. if min and max are far apart, the
+    // timing isn't very predictable
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} bench_counter_t;
+
+// the cycle counter. it stops while the CPU sleeps, so it's only good for
+// timing things that don't
+#define BENCH_NOW() (DWT->CYCCNT)
+
+// start the cycle counter
+void bench_init(void);
+
+// record that something started at start cycles and ended now
+// safe from any job
+void bench_record(bench_counter_id_t which, uint32_t start);
+
+// get a copy of a counter
+void bench_get(bench_counter_id_t which, bench_counter_t* counter);
+// zero all of them
+void bench_reset(void);
+
+#endif
@@ -0,0 +1,69 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "system/boot.h"
+
+#include "comms/uart.h"
+#include "comms/stream.h"
+#include "comms/console.h"
+#include "system/health.h"
+
+static bool mark_done[BOOT_NUM_MARKS];
+static uint32_t mark_ms[BOOT_NUM_MARKS];
+
+// note that a mark has happened. only the first time counts
+void boot_mark(boot_mark_t mark) {
+    __disable_irq();
+    if (!mark_done[mark]) {
+        mark_ms[mark] = HAL_GetTick();
+        mark_done[mark] = true;
+    }
+    __enable_irq();
+}
+
+// get when a mark happened, in milliseconds since HAL was inited
+// returns false if it hasn't happened yet
+bool boot_get_mark_ms(boot_mark_t mark, uint32_t* ms) {
+    if (!mark_done[mark]) {
+        return false;
+    }
+    *ms = mark_ms[mark];
+    return true;
+}
+
+// called by the system job to do the rest of the boot when it's time
+void boot_process(void) {
+    if (mark_done[BOOT_MARK_BACKGROUND]) {
+        return;
+    }
+    if (!mark_done[BOOT_MARK_FIRST_READING] &&
+            HAL_GetTick() < BOOT_BACKGROUND_MAX_WAIT_MS) {
+        return;
+    }
+    // the acquisition and measurement jobs can interrupt us, so readings
+    // keep coming while this happens
+    uart_init();
+    stream_init();
+    console_init();
+    health_init();
+    boot_mark(BOOT_MARK_BACKGROUND);
+}
@@ -0,0 +1,58 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_BOOT_H
+#define SYSTEM_BOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file keeps track of how the boot is going
+// main only sets up what's needed to show a reading. the UART and ADC are
+// turned on by the system job once the first reading is on the screen, and
+// the SD card isn't touched until somebody mounts it.
+
+// things that happen during boot, in the order they (should) happen
+typedef enum {
+    // sys_main_loop starts
+    BOOT_MARK_MAIN_LOOP=0,
+    // something is on the screen
+    BOOT_MARK_LCD,
+    // the HY3131 is talking to us
+    BOOT_MARK_HY_READY,
+    // the first reading is on the screen
+    BOOT_MARK_FIRST_READING,
+    // the UART and ADC are on, so boot is done
+    BOOT_MARK_BACKGROUND,
+    BOOT_NUM_MARKS
+} boot_mark_t;
+
+// if there's still no reading after this long, start the UART anyway so
+// we can find out what's wrong
+#define BOOT_BACKGROUND_MAX_WAIT_MS (1000)
+
+// note that a mark has happened. only the first time counts
+void boot_mark(boot_mark_t mark);
+// get when a mark happened, in milliseconds since HAL was inited
+// returns false if it hasn't happened yet
+bool boot_get_mark_ms(boot_mark_t mark, uint32_t* ms);
+
+// called by the system job to do the rest of the boot when it's time
+void boot_process(void);
+
+#endif
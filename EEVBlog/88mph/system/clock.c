@@ -0,0 +1,270 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "system/clock.h"
+
+#include "system/timer.h"
+#include "system/trace.h"
+#include "system/health.h"
+#include "comms/uart.h"
+#include "hardware/hy3131.h"
+#include "storage/sd.h"
+
+typedef struct {
+    bool use_pll;
+    // AHB prescaler, as it goes in RCC_CFGR
+    uint32_t hpre;
+    // flash wait states. 1 turns on 64 bit access and prefetch too
+    uint8_t latency;
+    // regulator range, as it goes in PWR_CR
+    uint32_t vos;
+    uint32_t hclk;
+} clock_config_t;
+
+// the HSE is 4MHz, and the PLL makes 96MHz from it then divides it by 4
+// (or 3 with CLOCK_PLL_32MHZ)
+// the PLL has to stay at 96MHz since the SDIO gets 48MHz from it
+// range 3 can do up to 4MHz with a wait state, and range 1 up to 16MHz
+// without one or 32MHz with one
+static const clock_config_t clock_configs[CLOCK_NUM_LEVELS] = {
+    // CLOCK_LEVEL_LOW
+    {false, RCC_CFGR_HPRE_DIV1, 1, PWR_CR_VOS, 4000000},
+#if CLOCK_PLL_32MHZ
+    // CLOCK_LEVEL_NORMAL
+    {true, RCC_CFGR_HPRE_DIV2, 0, PWR_CR_VOS_0, 16000000},
+    // CLOCK_LEVEL_HIGH
+    {true, RCC_CFGR_HPRE_DIV1, 1, PWR_CR_VOS_0, 32000000}
+#else
+    // CLOCK_LEVEL_NORMAL
+    {true, RCC_CFGR_HPRE_DIV2, 0, PWR_CR_VOS_0, 12000000},
+    // CLOCK_LEVEL_HIGH
+    {true, RCC_CFGR_HPRE_DIV1, 1, PWR_CR_VOS_0, 24000000}
+#endif
+};
+
+// what level each request wants
+static const clock_level_t req_levels[CLOCK_NUM_REQS] = {
+    CLOCK_LEVEL_NORMAL, // CLOCK_REQ_ACQUISITION
+    CLOCK_LEVEL_HIGH, // CLOCK_REQ_SD
+    CLOCK_LEVEL_HIGH, // CLOCK_REQ_CAPTURE
+    CLOCK_LEVEL_NORMAL // CLOCK_REQ_UART
+};
+
+static volatile clock_level_t curr_level = CLOCK_LEVEL_NORMAL;
+static volatile uint32_t requests = 0;
+static uint32_t switches[CLOCK_NUM_LEVELS];
+
+static void set_source(bool use_pll);
+
+// start out at whatever level cube set up
+void clock_init(void) {
+    curr_level = CLOCK_LEVEL_NORMAL;
+    requests = 0;
+    for (int li=0; li<CLOCK_NUM_LEVELS; li++) {
+        switches[li] = 0;
+    }
+#if CLOCK_PLL_32MHZ
+    // cube divides the PLL by 4, and that can only be changed while it's
+    // off. run from the HSE for a moment while it relocks. the normal
+    // level doesn't need a wait state either way.
+    __disable_irq();
+    set_source(false);
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_PLLDIV, RCC_CFGR_PLLDIV3);
+    set_source(true);
+    SystemCoreClockUpdate();
+    SysTick->LOAD = clock_configs[curr_level].hclk/1000 - 1;
+    SysTick->VAL = 0;
+    // the timers and UART aren't running yet and pick up the speed when
+    // they start, but the HY3131 delays are already in use
+    hy_clock_changed();
+    __enable_irq();
+#endif
+}
+
+// smaller VOS values are higher voltages, except 0 which isn't allowed
+static void set_voltage(uint32_t vos) {
+    while (PWR->CSR & PWR_CSR_VOSF);
+    MODIFY_REG(PWR->CR, PWR_CR_VOS, vos);
+    while (PWR->CSR & PWR_CSR_VOSF);
+}
+
+static void set_latency(uint8_t latency) {
+    if (latency) {
+        // 64 bit access has to be on before the wait state is, and
+        // prefetch only works with 64 bit access. with both, a wait state
+        // costs very little in straight line code.
+        FLASH->ACR |= FLASH_ACR_ACC64;
+        while (!(FLASH->ACR & FLASH_ACR_ACC64));
+        FLASH->ACR |= FLASH_ACR_PRFTEN;
+        FLASH->ACR |= FLASH_ACR_LATENCY;
+        while (!(FLASH->ACR & FLASH_ACR_LATENCY));
+    } else {
+        FLASH->ACR &= ~FLASH_ACR_LATENCY;
+        while (FLASH->ACR & FLASH_ACR_LATENCY);
+        // and prefetch has to be off before 64 bit access is
+        FLASH->ACR &= ~FLASH_ACR_PRFTEN;
+        FLASH->ACR &= ~FLASH_ACR_ACC64;
+    }
+}
+
+// switch SYSCLK over to the PLL or HSE, starting them if necessary
+static void set_source(bool use_pll) {
+    RCC->CR |= RCC_CR_HSEON | RCC_CR_HSION;
+    while (!(RCC->CR & RCC_CR_HSERDY));
+    while (!(RCC->CR & RCC_CR_HSIRDY));
+    if (use_pll) {
+        RCC->CR |= RCC_CR_PLLON;
+        while (!(RCC->CR & RCC_CR_PLLRDY));
+        MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
+        while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+    } else {
+        MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_HSE);
+        while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSE);
+        RCC->CR &= ~RCC_CR_PLLON;
+    }
+}
+
+// the highest level anybody wants
+static clock_level_t wanted_level(void) {
+    clock_level_t level = CLOCK_LEVEL_LOW;
+    uint32_t reqs = requests;
+    for (int ri=0; ri<CLOCK_NUM_REQS; ri++) {
+        if ((reqs & (1U << ri)) && req_levels[ri] > level) {
+            level = req_levels[ri];
+        }
+    }
+    return level;
+}
+
+// go to the highest level anybody wants, if we aren't there already
+static void update_level(void) {
+    __disable_irq();
+    // a higher priority job might have switched already
+    clock_level_t level = wanted_level();
+    if (level == curr_level) {
+        __enable_irq();
+        return;
+    }
+    // a byte going out while the clock changes would be garbled, so stop
+    // the UART between bytes. the rest of its buffer waits for the new baud
+    // divider.
+    uart_clock_changing();
+    const clock_config_t* from = &clock_configs[curr_level];
+    const clock_config_t* to = &clock_configs[level];
+
+    // raise the voltage and add wait states before changing the clock,
+    // and only take them away after, so both levels are always safe
+    if (to->vos < from->vos) {
+        set_voltage(to->vos);
+    }
+    if (to->latency > from->latency) {
+        set_latency(to->latency);
+    }
+
+    if (to->use_pll != from->use_pll) {
+        // divide by 2 while switching over, so the PLL's full speed never
+        // hits the CPU undivided
+        MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE, RCC_CFGR_HPRE_DIV2);
+        set_source(to->use_pll);
+    }
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE, to->hpre);
+
+    if (to->latency < from->latency) {
+        set_latency(to->latency);
+    }
+    if (to->vos > from->vos) {
+        set_voltage(to->vos);
+    }
+
+    curr_level = level;
+    switches[level]++;
+
+    // tell everybody who cares
+    SystemCoreClockUpdate();
+    SysTick->LOAD = to->hclk/1000 - 1;
+    SysTick->VAL = 0;
+    timer_clock_changed();
+    uart_clock_changed();
+    hy_clock_changed();
+    sd_clock_changed();
+    health_clock_changed();
+    trace_event(TRACE_CLOCK, level);
+    __enable_irq();
+}
+
+// ask for the level that goes with the reason, or stop asking
+// the switch happens right away. each request is a flag, not a count.
+void clock_request(clock_req_t req) {
+    __disable_irq();
+    bool already = requests & (1U << req);
+    requests |= 1U << req;
+    __enable_irq();
+    if (!already) {
+        update_level();
+    }
+}
+
+void clock_release(clock_req_t req) {
+    __disable_irq();
+    bool was = requests & (1U << req);
+    requests &= ~(1U << req);
+    __enable_irq();
+    if (was) {
+        update_level();
+    }
+}
+
+clock_level_t clock_get_level(void) {
+    return curr_level;
+}
+
+// the current HCLK, in Hz
+uint32_t clock_get_hclk(void) {
+    return clock_configs[curr_level].hclk;
+}
+
+// the HCLK a level runs at, in Hz
+uint32_t clock_get_level_hclk(clock_level_t level) {
+    return clock_configs[level].hclk;
+}
+
+// bitmask of current requests
+uint32_t clock_get_requests(void) {
+    return requests;
+}
+
+// how many flash wait states there are right now
+uint8_t clock_get_latency(void) {
+    return clock_configs[curr_level].latency;
+}
+
+// how many times the clock has switched to each level
+uint32_t clock_get_switches(clock_level_t level) {
+    return switches[level];
+}
+
+// STOP turns off the HSE and PLL, and we wake up running from the MSI
+// this gets the current level going again. called with interrupts disabled.
+// STOP keeps the prescalers, wait states, and voltage range as they were.
+void clock_restore(void) {
+    set_source(clock_configs[curr_level].use_pll);
+}
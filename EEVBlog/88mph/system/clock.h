@@ -0,0 +1,102 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_CLOCK_H
+#define SYSTEM_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file runs the CPU only as fast as the work needs
+// things that need speed request a level, and we run at the highest level
+// anybody is requesting. with no requests, we drop to the lowest level.
+// everything which depends on the clock speed gets told on every switch.
+
+// set to 1 to run the PLL levels at 16MHz and 32MHz instead of 12MHz and
+// 24MHz. 32MHz is as fast as the part goes, and needs a flash wait state
+// just like 24MHz does, so it's a free 33% for the high level. it does draw
+// more current though.
+#define CLOCK_PLL_32MHZ (1)
+
+// set to 1 to put the functions marked HOT_FUNC in RAM
+// they're the ones the acquisition job runs for every sample. from RAM,
+// they take the same number of cycles no matter how many flash wait states
+// there are, so the bit-banged HY3131 timing doesn't change between
+// levels. it costs a bit over a kilobyte of RAM.
+#define CLOCK_HOT_IN_RAM (1)
+
+#if CLOCK_HOT_IN_RAM
+// the startup copies these in along with the initialized data
+#define HOT_FUNC __attribute__((section(".RamFunc")))
+#else
+#define HOT_FUNC
+#endif
+
+typedef enum {
+    // 4MHz straight from the HSE, PLL off, regulator in range 3
+    CLOCK_LEVEL_LOW=0,
+    // 12MHz (or 16MHz) from the PLL, what cube sets up
+    CLOCK_LEVEL_NORMAL,
+    // 24MHz (or 32MHz) from the PLL
+    CLOCK_LEVEL_HIGH,
+    CLOCK_NUM_LEVELS
+} clock_level_t;
+
+// the reasons somebody might want the clock faster
+typedef enum {
+    // the HY3131 is sending acquisitions faster than the jobs could keep up
+    // with at the low level
+    CLOCK_REQ_ACQUISITION=0,
+    // the SDIO clock comes from the PLL, and faster means shorter bursts
+    CLOCK_REQ_SD,
+    // raw capture, so the acquisition job keeps up at the HY3131's full rate
+    CLOCK_REQ_CAPTURE,
+    // the UART is set faster than the low level's clock can divide down to
+    CLOCK_REQ_UART,
+    CLOCK_NUM_REQS
+} clock_req_t;
+
+// start out at whatever level cube set up
+// if CLOCK_PLL_32MHZ is set, this switches the PLL over, so call it before
+// starting anything that cares about the clock speed
+void clock_init(void);
+
+// ask for the level that goes with the reason, or stop asking
+// the switch happens right away. each request is a flag, not a count.
+// switching waits for the byte or two the UART is in the middle of sending,
+// but not for the rest of its buffer.
+void clock_request(clock_req_t req);
+void clock_release(clock_req_t req);
+
+clock_level_t clock_get_level(void);
+// the current HCLK, in Hz
+uint32_t clock_get_hclk(void);
+// the HCLK a level runs at, in Hz
+uint32_t clock_get_level_hclk(clock_level_t level);
+// bitmask of current requests
+uint32_t clock_get_requests(void);
+// how many flash wait states there are right now
+uint8_t clock_get_latency(void);
+// how many times the clock has switched to each level
+uint32_t clock_get_switches(clock_level_t level);
+
+// STOP turns off the HSE and PLL, and we wake up running from the MSI
+// this gets the current level going again. called with interrupts disabled.
+void clock_restore(void);
+
+#endif
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "system/deadline.h"
+
+#include "system/timer.h"
+#include "system/clock.h"
+#include "hardware/lcd.h"
+#include "hardware/lcd_segments.h"
+
+#define LOG_MASK (DEADLINE_LOG_SIZE-1)
+
+static uint32_t counts[DEADLINE_NUM_EVENTS];
+static uint32_t total = 0;
+static deadline_entry_t entries[DEADLINE_LOG_SIZE];
+// just counts up. the newest entry is one before it
+static uint32_t log_head = 0;
+
+// what the acquisition interrupts have been doing
+static bool have_last_irq = false;
+static uint32_t last_irq_us;
+// average time between interrupts, 0 if we don't know yet
+static uint32_t irq_period_us = 0;
+
+static bool icon_enabled = false;
+static bool icon_shown = false;
+
+// note that an event happened. safe from any job
+void deadline_record(deadline_event_t event, uint32_t arg) {
+    uint32_t now = TIMER_US_NOW();
+    __disable_irq();
+    counts[event]++;
+    total++;
+    deadline_entry_t* e = &entries[log_head++ & LOG_MASK];
+    e->event = event;
+    e->time_us = now;
+    e->arg = arg;
+    __enable_irq();
+}
+
+// called by the acquisition job for every HY3131 interrupt, to notice ones
+// that went missing. it learns how often they come in the current mode.
+HOT_FUNC void deadline_acq_irq(uint32_t irq_time_us) {
+    // only the acquisition job calls this, so nobody else touches these
+    if (!have_last_irq) {
+        // the first one after a restart doesn't tell us anything
+        have_last_irq = true;
+        last_irq_us = irq_time_us;
+        return;
+    }
+    uint32_t gap = irq_time_us - last_irq_us;
+    last_irq_us = irq_time_us;
+    if (irq_period_us == 0) {
+        irq_period_us = gap;
+    } else if (gap > irq_period_us + irq_period_us/2) {
+        // too long for jitter, so one got lost. don't let it throw off
+        // the average
+        deadline_record(DEADLINE_ACQ_MISSED, gap);
+    } else {
+        // a slow average, so a bit of jitter doesn't matter
+        irq_period_us = (uint32_t)((int32_t)irq_period_us +
+            ((int32_t)gap - (int32_t)irq_period_us)/8);
+    }
+}
+
+// the acquisition mode changed, so the interrupts will come at a new rate
+void deadline_acq_restart(void) {
+    __disable_irq();
+    have_last_irq = false;
+    irq_period_us = 0;
+    __enable_irq();
+}
+
+// how many times an event has happened
+uint32_t deadline_get_count(deadline_event_t event) {
+    return counts[event];
+}
+
+// get one of the latest events. 0 is the newest. returns false if there
+// aren't that many
+bool deadline_get_entry(uint8_t age, deadline_entry_t* entry) {
+    bool there_is_one = false;
+    __disable_irq();
+    if (age < DEADLINE_LOG_SIZE && age < total) {
+        *entry = entries[(log_head - 1 - age) & LOG_MASK];
+        there_is_one = true;
+    }
+    __enable_irq();
+    return there_is_one;
+}
+
+void deadline_reset(void) {
+    __disable_irq();
+    for (int ei=0; ei<DEADLINE_NUM_EVENTS; ei++) {
+        counts[ei] = 0;
+    }
+    total = 0;
+    log_head = 0;
+    __enable_irq();
+}
+
+// light up the TEST icon when anything has gone wrong since the last reset
+void deadline_set_icon(bool enabled) {
+    icon_enabled = enabled;
+}
+
+bool deadline_get_icon(void) {
+    return icon_enabled;
+}
+
+// called by the system job to update the icon
+void deadline_process(void) {
+    bool show = icon_enabled && total > 0;
+    if (show != icon_shown) {
+        icon_shown = show;
+        LCD_SEGSET(SEG_ICON_TEST, show);
+        lcd_queue_update();
+    }
+}
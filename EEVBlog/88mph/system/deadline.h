@@ -0,0 +1,83 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_DEADLINE_H
+#define SYSTEM_DEADLINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file keeps track of every time a job didn't keep up
+// the jobs report their own trouble, and the last few events are kept
+// along with when they happened, so you can tell what was going on
+
+typedef enum {
+    // the HY3131 had the next sample ready before the acquisition job was
+    // done with the last one. arg is how long the job took in us
+    DEADLINE_ACQ_LATE=0,
+    // the gap between HY3131 interrupts was long enough that at least one
+    // was never serviced. arg is the gap in us
+    DEADLINE_ACQ_MISSED,
+    // the measurement job let DEADLINE_BACKLOG_DEPTH readings pile up.
+    // arg is the depth
+    DEADLINE_MEAS_BACKLOG,
+    // and then fell so far behind that a reading was thrown away
+    DEADLINE_MEAS_DROP,
+    // the 10ms timer went off again before its job was done
+    // arg is how long the job took in us
+    DEADLINE_10MS_OVERRUN,
+    DEADLINE_NUM_EVENTS
+} deadline_event_t;
+
+// how many readings waiting for the measurement job counts as a backlog
+#define DEADLINE_BACKLOG_DEPTH (4)
+
+// how many of the latest events are remembered
+// must be power of 2!!
+#define DEADLINE_LOG_SIZE (8)
+
+typedef struct {
+    deadline_event_t event;
+    // microsecond timestamp
+    uint32_t time_us;
+    uint32_t arg;
+} deadline_entry_t;
+
+// note that an event happened. safe from any job
+void deadline_record(deadline_event_t event, uint32_t arg);
+
+// called by the acquisition job for every HY3131 interrupt, to notice ones
+// that went missing. it learns how often they come in the current mode.
+void deadline_acq_irq(uint32_t irq_time_us);
+// the acquisition mode changed, so the interrupts will come at a new rate
+void deadline_acq_restart(void);
+
+// how many times an event has happened
+uint32_t deadline_get_count(deadline_event_t event);
+// get one of the latest events. 0 is the newest. returns false if there
+// aren't that many
+bool deadline_get_entry(uint8_t age, deadline_entry_t* entry);
+void deadline_reset(void);
+
+// light up the TEST icon when anything has gone wrong since the last reset
+void deadline_set_icon(bool enabled);
+bool deadline_get_icon(void);
+// called by the system job to update the icon
+void deadline_process(void);
+
+#endif
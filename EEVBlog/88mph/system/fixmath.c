@@ -0,0 +1,79 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+
+#include "system/fixmath.h"
+
+// the square root of v, rounded down
+// this works out one bit of the root per loop, from the top down. it's 32
+// loops of shifts and subtracts, which is fine once per reading.
+uint32_t fix_isqrt64(uint64_t v) {
+    uint64_t root = 0;
+    // the highest power of 4 that fits
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+// log2(1+i/64), with FIX_LOG_FRAC bits of fraction
+// interpolating between these is off by at most 3 LSBs, since log2 bends
+// so little over 1/64. tools/gen_log2.py makes this and checks the error
+static const uint32_t log2_table[65] = {
+    0, 1466, 2909, 4331, 5732, 7112, 8473, 9814,
+    11136, 12440, 13727, 14996, 16248, 17484, 18704, 19909,
+    21098, 22272, 23433, 24579, 25711, 26830, 27936, 29029,
+    30109, 31178, 32234, 33279, 34312, 35334, 36346, 37346,
+    38336, 39316, 40286, 41246, 42196, 43137, 44068, 44990,
+    45904, 46809, 47705, 48593, 49472, 50344, 51207, 52063,
+    52911, 53751, 54584, 55410, 56229, 57040, 57845, 58643,
+    59434, 60219, 60997, 61769, 62534, 63294, 64047, 64794,
+    65536
+};
+
+// the base 2 log of v, with FIX_LOG_FRAC bits of fraction
+// the top bit is the whole part, and the bits under it are looked up
+int32_t fix_log2(uint64_t v) {
+    int32_t whole = 63 - __builtin_clzll(v);
+    // line the top bit up with bit 30, so the 30 bits under it are the
+    // fraction of the mantissa
+    uint32_t m;
+    if (whole >= 30) {
+        m = (uint32_t)(v >> (whole-30));
+    } else {
+        m = (uint32_t)(v << (30-whole));
+    }
+    // the top 6 bits of the fraction pick the entry, and the next 16
+    // interpolate to the next one
+    uint32_t i = (m >> 24) & 63;
+    uint32_t frac = (m >> 8) & 0xFFFF;
+    uint32_t l0 = log2_table[i];
+    uint32_t l = l0 + (((log2_table[i+1]-l0)*frac + 0x8000) >> 16);
+    return (whole << FIX_LOG_FRAC) + (int32_t)l;
+}
\ No newline at end of file
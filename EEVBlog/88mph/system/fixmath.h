@@ -0,0 +1,38 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_FIXMATH_H
+#define SYSTEM_FIXMATH_H
+
+#include <stdint.h>
+
+// this file has integer math helpers for the modes that need more than
+// adding and dividing. there's no FPU, and the soft float library is big
+// and slow, so everything here is done in integers.
+
+// the square root of v, rounded down
+uint32_t fix_isqrt64(uint64_t v);
+
+// logs have this many bits of fraction
+#define FIX_LOG_FRAC (16)
+
+// the base 2 log of v, with FIX_LOG_FRAC bits of fraction. v can't be 0.
+// it's within 4 LSBs of the real thing everywhere
+int32_t fix_log2(uint64_t v);
+
+#endif
@@ -0,0 +1,241 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "system/health.h"
+
+#include "system/job.h"
+#include "hardware/lcd.h"
+#include "hardware/lcd_segments.h"
+#include "storage/logger.h"
+
+// main doesn't set up the ADC any more. it's in main.c
+void MX_ADC_Init(void);
+
+// the order the scan converts things in
+typedef enum {
+    SCAN_BATT=0,
+    SCAN_THERMISTOR,
+    SCAN_VREFINT,
+    SCAN_TEMP,
+    SCAN_NUM_CHANNELS
+} scan_channel_t;
+
+// and the ADC channel for each
+#define CHANNEL_BATT (5) // HW_LOW_BAT
+#define CHANNEL_THERMISTOR (4) // HW_THERMISTOR
+#define CHANNEL_TEMP (16)
+#define CHANNEL_VREFINT (17)
+
+// the factory measured VREFINT and the temperature sensor with VDDA at 3V
+#define CAL_VDDA_MV (3000)
+#define CAL_VREFINT (*(const uint16_t*)0x1FF800F8)
+#define CAL_TEMP_30 (*(const uint16_t*)0x1FF800FA)
+#define CAL_TEMP_110 (*(const uint16_t*)0x1FF800FE)
+
+// the sensor and VREFINT need at least 10us to sample, and the divider and
+// thermistor are high impedance, so everybody gets the longest time. that's
+// 384 cycles, or 24us at 16MHz.
+#define SAMPLE_TIME (7)
+
+// where the DMA puts the scan
+static volatile uint16_t scan_buf[SCAN_NUM_CHANNELS];
+// and where the interrupt copies it so the next scan can't write over it
+static volatile uint16_t scan_copy[SCAN_NUM_CHANNELS];
+static volatile bool scan_ready = false;
+
+static bool health_is_on = false;
+static health_status_t status;
+static uint8_t low_scans = 0;
+static uint8_t dead_scans = 0;
+static bool batt_dead = false;
+static bool icon_shown = false;
+
+// APB2 is never divided either, so TIM9 runs at HCLK
+// this gets the prescaler for a millisecond per count
+static uint32_t tim9_prescale(void) {
+    return HAL_RCC_GetPCLK2Freq()/1000 - 1;
+}
+
+// start the scans. the ADC runs from the HSI, so the scan doesn't care
+// what the clock governor does, but TIM9 does
+void health_init(void) {
+    // cube sets up the pins and the ADC's clock, then we redo the rest
+    MX_ADC_Init();
+
+    // the DMA goes around in a circle, one lap per scan
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    DMA1_Channel1->CCR = 0;
+    DMA1_Channel1->CPAR = (uint32_t)&ADC1->DR;
+    DMA1_Channel1->CMAR = (uint32_t)scan_buf;
+    DMA1_Channel1->CNDTR = SCAN_NUM_CHANNELS;
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+    DMA1_Channel1->CCR = DMA_CCR_MINC | // step through the buffer
+                         DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 | // 16 bits
+                         DMA_CCR_CIRC | // and start over after
+                         DMA_CCR_TCIE | // tell us when the scan is done
+                         DMA_CCR_EN;
+
+    // turn the ADC off to set it up
+    ADC1->CR2 = 0;
+    // scan through the whole sequence on every trigger, and power down
+    // between scans
+    ADC1->CR1 = ADC_CR1_SCAN | ADC_CR1_PDI;
+    ADC1->SMPR3 = SAMPLE_TIME << ADC_SMPR3_SMP4_Pos |
+                  SAMPLE_TIME << ADC_SMPR3_SMP5_Pos;
+    ADC1->SMPR2 = SAMPLE_TIME << ADC_SMPR2_SMP16_Pos |
+                  SAMPLE_TIME << ADC_SMPR2_SMP17_Pos;
+    ADC1->SQR1 = (SCAN_NUM_CHANNELS-1) << ADC_SQR1_L_Pos;
+    ADC1->SQR5 = CHANNEL_BATT << ADC_SQR5_SQ1_Pos |
+                 CHANNEL_THERMISTOR << ADC_SQR5_SQ2_Pos |
+                 CHANNEL_VREFINT << ADC_SQR5_SQ3_Pos |
+                 CHANNEL_TEMP << ADC_SQR5_SQ4_Pos;
+    // connect VREFINT and the temperature sensor
+    ADC->CCR |= ADC_CCR_TSVREFE;
+    ADC1->CR2 = ADC_CR2_EXTEN_0 | // convert on the rising edge of
+                ADC_CR2_EXTSEL_0 | // TIM9's TRGO
+                ADC_CR2_DMA | ADC_CR2_DDS; // and keep asking for DMA
+    ADC1->CR2 |= ADC_CR2_ADON;
+    while (!(ADC1->SR & ADC_SR_ADONS));
+
+    NVIC_ClearPendingIRQ(DMA1_Channel1_IRQn);
+    NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+
+    // set up TIM9 to trigger a scan every HEALTH_PERIOD_MS
+    __HAL_RCC_TIM9_FORCE_RESET();
+    __HAL_RCC_TIM9_CLK_ENABLE();
+    __HAL_RCC_TIM9_RELEASE_RESET();
+
+    TIM9->PSC = tim9_prescale();
+    TIM9->ARR = HEALTH_PERIOD_MS-1;
+    TIM9->CR2 = TIM_CR2_MMS_1; // the update event is TRGO
+    // the prescaler is only loaded on an update event, so force one now
+    // that also starts the first scan
+    TIM9->EGR = TIM_EGR_UG;
+    TIM9->CR1 = TIM_CR1_CEN;
+
+    health_is_on = true;
+}
+
+// the system clock changed speed, so keep TIM9 at the same period
+// the new prescaler is loaded at the next update, so one period is off
+void health_clock_changed(void) {
+    if (health_is_on) {
+        TIM9->PSC = tim9_prescale();
+    }
+}
+
+// the DMA interrupt at the end of each scan
+void DMA1_Channel1_IRQHandler(void) {
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+    for (int ci=0; ci<SCAN_NUM_CHANNELS; ci++) {
+        scan_copy[ci] = scan_buf[ci];
+    }
+    scan_ready = true;
+    job_schedule(JOB_SYSTEM);
+}
+
+// the battery is about to go. anything that shouldn't lose power halfway
+// through goes here
+static void power_failing(void) {
+    status.power_fails++;
+    // the log file is closed between entries, so stopping is enough
+    logger_stop();
+}
+
+// called by the system job to look at a finished scan
+void health_process(void) {
+    if (!scan_ready) {
+        return;
+    }
+    uint16_t raw[SCAN_NUM_CHANNELS];
+    __disable_irq();
+    for (int ci=0; ci<SCAN_NUM_CHANNELS; ci++) {
+        raw[ci] = scan_copy[ci];
+    }
+    scan_ready = false;
+    __enable_irq();
+    if (raw[SCAN_VREFINT] == 0) {
+        return;
+    }
+
+    // VREFINT is the same no matter what VDDA is, so it tells us VDDA
+    uint32_t vdda_mv = CAL_VDDA_MV*CAL_VREFINT/raw[SCAN_VREFINT];
+    uint32_t batt_mv = raw[SCAN_BATT]*vdda_mv/4095*HEALTH_BATT_DIVIDER;
+    // scale the sensor to what it would have read at 3V, then go along
+    // the line between the two calibration points
+    int32_t temp = (int32_t)(raw[SCAN_TEMP]*vdda_mv/CAL_VDDA_MV);
+    int32_t die_temp_mc = 30000 +
+        (temp-CAL_TEMP_30)*80000/(CAL_TEMP_110-CAL_TEMP_30);
+
+    __disable_irq();
+    status.scans++;
+    status.vdda_mv = vdda_mv;
+    status.batt_mv = batt_mv;
+    status.die_temp_mc = die_temp_mc;
+    status.thermistor = raw[SCAN_THERMISTOR];
+    __enable_irq();
+
+    if (!status.batt_low) {
+        low_scans = (batt_mv < HEALTH_LOW_BATT_MV) ? low_scans+1 : 0;
+        if (low_scans >= HEALTH_LOW_BATT_SCANS) {
+            status.batt_low = true;
+        }
+    } else if (batt_mv > HEALTH_LOW_BATT_MV+HEALTH_LOW_BATT_HYST_MV) {
+        status.batt_low = false;
+        low_scans = 0;
+    }
+
+    if (!batt_dead) {
+        dead_scans = (batt_mv < HEALTH_DEAD_BATT_MV) ? dead_scans+1 : 0;
+        if (dead_scans >= HEALTH_LOW_BATT_SCANS) {
+            batt_dead = true;
+            power_failing();
+        }
+    } else if (batt_mv > HEALTH_LOW_BATT_MV) {
+        // somebody put in new batteries
+        batt_dead = false;
+        dead_scans = 0;
+    }
+
+    if (status.batt_low != icon_shown) {
+        icon_shown = status.batt_low;
+        LCD_SEGSET(SEG_ICON_BATT, icon_shown);
+        lcd_queue_update();
+    }
+}
+
+// get the latest numbers. they're all 0 until the first scan is done
+void health_get_status(health_status_t* s) {
+    __disable_irq();
+    *s = status;
+    __enable_irq();
+}
+
+// the die temperature in thousandths of a degree C, for drift compensation
+// returns false if there hasn't been a scan yet
+bool health_get_die_temp_mc(int32_t* temp_mc) {
+    __disable_irq();
+    bool valid = status.scans > 0;
+    *temp_mc = status.die_temp_mc;
+    __enable_irq();
+    return valid;
+}
@@ -0,0 +1,83 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_HEALTH_H
+#define SYSTEM_HEALTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file keeps an eye on the battery and the temperature
+// TIM9 triggers ADC1 every HEALTH_PERIOD_MS to convert the battery
+// divider, the thermistor, VREFINT and the temperature sensor in one scan,
+// and DMA moves the results out. the CPU only gets involved once the whole
+// scan is done, when the system job turns the numbers into millivolts and
+// degrees and lights up the battery icon if it's low.
+
+#define HEALTH_PERIOD_MS (1000)
+
+// the battery goes through a divider to HW_LOW_BAT. nobody has measured
+// it yet, so this is a guess that puts 4 fresh AAs near the middle of the
+// range. fix it if the numbers look wrong!
+#define HEALTH_BATT_DIVIDER (3)
+
+// show the battery icon below this, and take it away again once the
+// battery is HEALTH_LOW_BATT_HYST_MV above it. it has to be low for
+// HEALTH_LOW_BATT_SCANS scans in a row, so a load step doesn't set it off.
+#define HEALTH_LOW_BATT_MV (4400)
+#define HEALTH_LOW_BATT_HYST_MV (200)
+#define HEALTH_LOW_BATT_SCANS (3)
+// below this, we're about to brown out. stop anything that would be hurt
+// by losing power in the middle of it
+#define HEALTH_DEAD_BATT_MV (4000)
+
+typedef struct {
+    // how many scans have finished
+    uint32_t scans;
+    // the analog supply, worked out from VREFINT
+    uint32_t vdda_mv;
+    uint32_t batt_mv;
+    // the die temperature in thousandths of a degree C
+    int32_t die_temp_mc;
+    // the thermistor's raw reading, out of 4095 of VDDA
+    uint16_t thermistor;
+    bool batt_low;
+    // times the battery has gotten below HEALTH_DEAD_BATT_MV
+    uint32_t power_fails;
+} health_status_t;
+
+// start the scans. the ADC runs from the HSI, so the scan doesn't care
+// what the clock governor does, but TIM9 does
+void health_init(void);
+
+// the system clock changed speed, so keep TIM9 at the same period
+void health_clock_changed(void);
+
+// the DMA interrupt at the end of each scan
+void DMA1_Channel1_IRQHandler(void);
+
+// called by the system job to look at a finished scan
+void health_process(void);
+
+// get the latest numbers. they're all 0 until the first scan is done
+void health_get_status(health_status_t* status);
+// the die temperature in thousandths of a degree C, for drift compensation
+// returns false if there hasn't been a scan yet
+bool health_get_die_temp_mc(int32_t* temp_mc);
+
+#endif
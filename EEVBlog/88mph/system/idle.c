@@ -0,0 +1,253 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "system/idle.h"
+
+#include "system/timer.h"
+#include "system/job.h"
+#include "system/clock.h"
+#include "system/trace.h"
+#include "hardware/buttons.h"
+#include "hardware/lcd.h"
+#include "hardware/buzzer.h"
+#include "hardware/rtc.h"
+
+// the range switch is on PG0-7 and the front buttons are on PG8-15, so
+// they can wake us through EXTI. line 3 belongs to the HY3131, but the
+// switch can't move onto or off of PG3 without one of the others changing.
+// the jack detect pins share lines with the buttons, so they can't wake us
+// and are only noticed once something else does.
+#define BTN_EXTI_LINES (0xFFFFU & ~EXTI_IMR_MR3)
+static const IRQn_Type btn_irqs[] = {
+    EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI4_IRQn,
+    EXTI9_5_IRQn, EXTI15_10_IRQn
+};
+#define NUM_BTN_IRQS (sizeof(btn_irqs)/sizeof(btn_irqs[0]))
+
+// the RTC wakeup timer comes through EXTI line 20
+#define RTC_WKUP_EXTI_LINE (EXTI_IMR_MR20)
+
+static volatile uint32_t holds = 0;
+
+static volatile bool wakeup_requested = false;
+// in timer_1ms_ticks
+static volatile uint32_t wakeup_at_ms = 0;
+
+static idle_residency_t residency;
+// when we last woke up, so we know how long we've been running
+static uint32_t last_wake_us = 0;
+// the RTC and the microsecond timer when we last came out of STOP. both
+// have been running since, so the next STOP can measure the LSI with them
+static bool cal_valid = false;
+static uint32_t cal_ticks = 0;
+static uint32_t cal_us = 0;
+
+void idle_init(void) {
+    // point the button lines at port G and trigger on both edges, but leave
+    // them masked. they're only unmasked while we're asleep without the
+    // 10ms timer to poll them.
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    for (int li=0; li<16; li++) {
+        if (!(BTN_EXTI_LINES & (1U << li))) {
+            continue;
+        }
+        MODIFY_REG(SYSCFG->EXTICR[li >> 2],
+            0xFU << (4*(li & 3)),
+            SYSCFG_EXTICR1_EXTI0_PG << (4*(li & 3)));
+    }
+    CLEAR_BIT(EXTI->IMR, BTN_EXTI_LINES);
+    SET_BIT(EXTI->RTSR, BTN_EXTI_LINES);
+    SET_BIT(EXTI->FTSR, BTN_EXTI_LINES);
+
+    // the RTC wakeup timer's line is rising edge only
+    CLEAR_BIT(EXTI->IMR, RTC_WKUP_EXTI_LINE);
+    SET_BIT(EXTI->RTSR, RTC_WKUP_EXTI_LINE);
+
+    idle_reset_residency();
+}
+
+// keep us out of STOP until the hold is released
+// each hold is a flag, not a count
+void idle_hold(idle_hold_t hold) {
+    __disable_irq();
+    holds |= 1U << hold;
+    __enable_irq();
+}
+
+void idle_release(idle_hold_t hold) {
+    __disable_irq();
+    holds &= ~(1U << hold);
+    __enable_irq();
+}
+
+// make sure we're awake again within ms milliseconds, even if no interrupt
+// comes along, and schedule the system job then. only the soonest request
+// is kept.
+void idle_request_wakeup(uint32_t ms) {
+    __disable_irq();
+    uint32_t at = timer_1ms_ticks + ms;
+    if (!wakeup_requested || (int32_t)(at - wakeup_at_ms) < 0) {
+        wakeup_at_ms = at;
+        wakeup_requested = true;
+    }
+    __enable_irq();
+}
+
+// let the buttons and whatever else wake us up
+// interrupts are disabled, so these never actually run their handlers
+static void enable_wake_irqs(bool buttons, bool rtc) {
+    if (buttons) {
+        EXTI->PR = BTN_EXTI_LINES;
+        SET_BIT(EXTI->IMR, BTN_EXTI_LINES);
+        for (int ii=0; ii<NUM_BTN_IRQS; ii++) {
+            NVIC_ClearPendingIRQ(btn_irqs[ii]);
+            NVIC_EnableIRQ(btn_irqs[ii]);
+        }
+    }
+    if (rtc) {
+        EXTI->PR = RTC_WKUP_EXTI_LINE;
+        SET_BIT(EXTI->IMR, RTC_WKUP_EXTI_LINE);
+        NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+        NVIC_EnableIRQ(RTC_WKUP_IRQn);
+    }
+}
+
+// and make sure they don't go off once interrupts are enabled again
+static void disable_wake_irqs(void) {
+    CLEAR_BIT(EXTI->IMR, BTN_EXTI_LINES | RTC_WKUP_EXTI_LINE);
+    EXTI->PR = BTN_EXTI_LINES | RTC_WKUP_EXTI_LINE;
+    for (int ii=0; ii<NUM_BTN_IRQS; ii++) {
+        NVIC_DisableIRQ(btn_irqs[ii]);
+        NVIC_ClearPendingIRQ(btn_irqs[ii]);
+    }
+    NVIC_DisableIRQ(RTC_WKUP_IRQn);
+    NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+}
+
+// called by the main loop when there's nothing to do
+// sleeps as deeply as it can, then returns after an interrupt wakes us
+void idle_sleep(void) {
+    // with interrupts disabled, an interrupt still wakes us up, but its
+    // handler doesn't run until we've fixed the timers afterwards
+    __disable_irq();
+    uint32_t now_us = TIMER_US_NOW();
+    residency.us[IDLE_STATE_RUN] += now_us - last_wake_us;
+
+    // the 10ms timer is only needed to debounce buttons, update the LCD and
+    // finish beeps
+    bool need_10ms = !btn_is_settled() || lcd_update_is_pending() ||
+        buzzer_is_on();
+
+    // figure out how long until something needs us awake
+    bool have_deadline = wakeup_requested;
+    uint32_t until_ms = 0;
+    if (have_deadline) {
+        int32_t diff = (int32_t)(wakeup_at_ms - timer_1ms_ticks);
+        until_ms = diff > 0 ? (uint32_t)diff : 0;
+    }
+
+    idle_state_t state;
+    if (need_10ms) {
+        state = IDLE_STATE_SLEEP;
+    } else if (holds || (have_deadline && until_ms < IDLE_STOP_MIN_MS)) {
+        state = IDLE_STATE_TICKLESS;
+    } else {
+        state = IDLE_STATE_STOP;
+    }
+
+    timer_suspend_ticks(!need_10ms);
+    // without the 10ms timer, nothing polls the buttons or notices the
+    // deadline, so they have to wake us up themselves
+    bool use_rtc = !need_10ms && have_deadline;
+    if (!need_10ms) {
+        enable_wake_irqs(true, use_rtc);
+    }
+    if (use_rtc) {
+        rtc_start_wakeup(until_ms);
+    }
+
+    trace_event(TRACE_SLEEP, state);
+    uint32_t elapsed_us;
+    if (state != IDLE_STATE_STOP) {
+        __WFI();
+        elapsed_us = TIMER_US_NOW() - now_us;
+    } else {
+        uint32_t start_ticks = rtc_read_ticks();
+        if (cal_valid) {
+            rtc_calibrate(cal_ticks, start_ticks, now_us - cal_us);
+        }
+
+        // STOP with the regulator in low power mode
+        CLEAR_BIT(PWR->CR, PWR_CR_PDDS);
+        SET_BIT(PWR->CR, PWR_CR_LPSDSR | PWR_CR_CWUF);
+        SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+        __WFI();
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        CLEAR_BIT(PWR->CR, PWR_CR_LPSDSR);
+
+        clock_restore();
+        uint32_t end_ticks = rtc_read_ticks();
+        elapsed_us = rtc_ticks_to_us(start_ticks, end_ticks);
+        // the microsecond timer was stopped too, so catch it up
+        TIM5->CNT += elapsed_us;
+        cal_ticks = end_ticks;
+        cal_us = TIMER_US_NOW();
+        cal_valid = true;
+    }
+    if (!need_10ms) {
+        disable_wake_irqs();
+    }
+    if (use_rtc) {
+        rtc_stop_wakeup();
+    }
+    timer_resume_ticks(elapsed_us);
+    trace_event(TRACE_WAKE, 0);
+
+    // if the deadline has passed, let the system job see to it
+    if (wakeup_requested &&
+            (int32_t)(wakeup_at_ms - timer_1ms_ticks) <= 0) {
+        wakeup_requested = false;
+        job_schedule(JOB_SYSTEM);
+    }
+
+    residency.us[state] += elapsed_us;
+    residency.entries[state]++;
+    last_wake_us = TIMER_US_NOW();
+    __enable_irq();
+}
+
+// get a copy of how much time has been spent in each state
+void idle_get_residency(idle_residency_t* r) {
+    __disable_irq();
+    *r = residency;
+    __enable_irq();
+}
+
+void idle_reset_residency(void) {
+    __disable_irq();
+    for (int si=0; si<IDLE_NUM_STATES; si++) {
+        residency.us[si] = 0;
+        residency.entries[si] = 0;
+    }
+    last_wake_us = TIMER_US_NOW();
+    __enable_irq();
+}
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_IDLE_H
+#define SYSTEM_IDLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// this file decides how deeply to sleep when there's no job to run
+// the ticks are stopped whenever we're idle, and the 10ms timer too if
+// the buttons and LCD don't need it. if nothing needs the fast clocks
+// either, the whole chip goes into STOP until the HY3131, a button, the
+// range switch or the RTC wakes it up.
+
+// in practice STOP only happens in the logger's quiet mode. the UART holds
+// it off whenever it's on, and the HY3131 whenever it's acquiring, so
+// between samples in normal use we only get as far as tickless sleep.
+
+typedef enum {
+    // running jobs
+    IDLE_STATE_RUN=0,
+    // sleeping, but the 10ms timer is still going
+    IDLE_STATE_SLEEP,
+    // sleeping with no timers going at all
+    IDLE_STATE_TICKLESS,
+    // in STOP mode, with only the RTC and LCD running
+    IDLE_STATE_STOP,
+    IDLE_NUM_STATES
+} idle_state_t;
+
+// things which need the fast clocks, and so keep us out of STOP
+typedef enum {
+    // the UART's DMA stops in STOP, so it would lose bytes. it can't let go
+    // when the line is quiet either, since nothing would wake us for the
+    // next byte: RX is on PD6, and EXTI line 6 is the range switch's PG6.
+    // so it's held from uart_init to uart_deinit
+    IDLE_HOLD_UART=0,
+    // the HY3131 is sending acquisitions. the microsecond timer stops in
+    // STOP and only gets caught up from the RTC afterwards, and the first
+    // interrupt after waking is only timestamped once the clocks are back,
+    // so the readings' time_us would be off
+    IDLE_HOLD_ACQUISITION,
+    IDLE_NUM_HOLDS
+} idle_hold_t;
+
+// STOP costs a few ms to restart the clocks, so it's not worth it unless
+// we'll be asleep for at least this long
+#define IDLE_STOP_MIN_MS (20)
+
+void idle_init(void);
+
+// keep us out of STOP until the hold is released
+// each hold is a flag, not a count
+void idle_hold(idle_hold_t hold);
+void idle_release(idle_hold_t hold);
+
+// make sure we're awake again within ms milliseconds, even if no interrupt
+// comes along, and schedule the system job then. only the soonest request
+// is kept.
+void idle_request_wakeup(uint32_t ms);
+
+// called by the main loop when there's nothing to do
+// sleeps as deeply as it can, then returns after an interrupt wakes us
+void idle_sleep(void);
+
+typedef struct {
+    // microseconds spent in each state
+    uint64_t us[IDLE_NUM_STATES];
+    // how many times each state was entered
+    uint32_t entries[IDLE_NUM_STATES];
+} idle_residency_t;
+
+// get a copy of how much time has been spent in each state
+void idle_get_residency(idle_residency_t* residency);
+void idle_reset_residency(void);
+
+#endif
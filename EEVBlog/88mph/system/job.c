@@ -22,9 +22,70 @@
 
 #include "system/job.h"
 
+#include "system/profile.h"
+#include "system/timer.h"
+#include "system/trace.h"
+#include "system/clock.h"
+#include "system/system.h"
+#include "measurement/measurement.h"
+
+static void job_handle_work_high(void);
+static void job_handle_work_normal(void);
+static void job_handle_work_low(void);
+static void init_work_queues(void);
+
+typedef struct {
+    job_t job;
+    // 0 to 15, and 0 is the most important
+    uint8_t priority;
+    // what the job does. null if its interrupt handler is somewhere else
+    void (*handler)(void);
+    // where its runs and timings go
+    prof_counter_id_t prof;
+} job_config_t;
+
+// the table index of each job, so the interrupt handlers can find theirs
+typedef enum {
+    JOB_INDEX_10MS_TIMER=0,
+    JOB_INDEX_ACQUISITION,
+    JOB_INDEX_WORK_HIGH,
+    JOB_INDEX_MEASUREMENT,
+    JOB_INDEX_WORK_NORMAL,
+    JOB_INDEX_SYSTEM,
+    JOB_INDEX_WORK_LOW,
+    JOB_NUM_JOBS
+} job_index_t;
+
+static const job_config_t job_table[JOB_NUM_JOBS] = {
+    // we want the 10ms timer to be the most important job. it's pretty
+    // fast and doesn't do much
+    [JOB_INDEX_10MS_TIMER] = {JOB_10MS_TIMER, 1,
+        timer_handle_job_10ms_timer, PROF_JOB_10MS_TIMER},
+    // after the timers, handling acquisition is the most important
+    // it needs the interrupt's timestamp, so hy3131.c handles it
+    [JOB_INDEX_ACQUISITION] = {JOB_ACQUISITION, 5,
+        0, PROF_JOB_ACQUISITION},
+    // urgent work shouldn't hold up the next sample
+    [JOB_INDEX_WORK_HIGH] = {JOB_WORK_HIGH, 6,
+        job_handle_work_high, PROF_JOB_WORK_HIGH},
+    // measurement is closely related to acquisition
+    [JOB_INDEX_MEASUREMENT] = {JOB_MEASUREMENT, 7,
+        meas_handle_job_measurement, PROF_JOB_MEASUREMENT},
+    [JOB_INDEX_WORK_NORMAL] = {JOB_WORK_NORMAL, 8,
+        job_handle_work_normal, PROF_JOB_WORK_NORMAL},
+    // then the system job
+    // it keeps the UI responsive
+    [JOB_INDEX_SYSTEM] = {JOB_SYSTEM, 10,
+        sys_handle_job_system, PROF_JOB_SYSTEM},
+    // and whatever's left can wait until there's nothing else to do
+    [JOB_INDEX_WORK_LOW] = {JOB_WORK_LOW, 14,
+        job_handle_work_low, PROF_JOB_WORK_LOW},
+};
+
 void job_init(void) {
     // first, disable all the jobs
     job_deinit();
+    init_work_queues();
 
     // now configure the job priorities
     __disable_irq();
@@ -33,18 +94,21 @@ void job_init(void) {
     // timing and it doesn't do much
     NVIC_SetPriority(SysTick_IRQn, 0);
 
-    // next we want the 10ms timer. it's pretty fast and doesn't do much
-    // it's handled by TIM6
-    NVIC_SetPriority(JOB_10MS_TIMER, 1);
-
-    // after the timers, handling acquisition is the most important
-    NVIC_SetPriority(JOB_ACQUISITION, 5);
-    // measurement is closely related to acquisition
-    NVIC_SetPriority(JOB_MEASUREMENT, 7);
+    // the UART's DMA interrupt just moves some pointers around
+    // but the UART will sit idle until it's handled
+    NVIC_SetPriority(DMA1_Channel7_IRQn, 2);
+    // receiving only schedules the system job, so it's not very important
+    NVIC_SetPriority(DMA1_Channel6_IRQn, 9);
+    NVIC_SetPriority(USART2_IRQn, 9);
+    // same for the RTC alarm and the end of a battery scan
+    NVIC_SetPriority(RTC_Alarm_IRQn, 9);
+    NVIC_SetPriority(DMA1_Channel1_IRQn, 9);
 
-    // then the system job
-    // it keeps the UI responsive
-    NVIC_SetPriority(JOB_SYSTEM, 10);
+    // and the jobs get whatever the table says
+    for (int ji=0; ji<JOB_NUM_JOBS; ji++) {
+        NVIC_SetPriority((IRQn_Type)job_table[ji].job,
+            job_table[ji].priority);
+    }
 
     __enable_irq();
 }
@@ -54,9 +118,12 @@ void job_deinit(void) {
     // disable job-specific IRQs
     // all at once, so things don't get weird
     __disable_irq();
-    job_disable(JOB_SYSTEM);
-    job_disable(JOB_10MS_TIMER);
-    job_disable(JOB_MEASUREMENT);
+    for (int ji=0; ji<JOB_NUM_JOBS; ji++) {
+        // acquisition belongs to hy3131.c
+        if (job_table[ji].job != JOB_ACQUISITION) {
+            job_disable(job_table[ji].job);
+        }
+    }
     __enable_irq();
 }
 
@@ -71,7 +138,7 @@ void job_enable(job_t job) {
 
 // resume a specific job by enabling it but not un-scheduling it
 // only resumes if resume is true. otherwise, does nothing
-void job_resume(job_t job, bool resume) {
+HOT_FUNC void job_resume(job_t job, bool resume) {
     if (resume) {
         NVIC_EnableIRQ((IRQn_Type)job);
     }
@@ -80,7 +147,7 @@ void job_resume(job_t job, bool resume) {
 // disable a specific job, so it won't run even if it is scheduled
 // returns whether or not the job was previously enabled
 // (to be used with resume)
-bool job_disable(job_t job) {
+HOT_FUNC bool job_disable(job_t job) {
     __disable_irq();
     // this horrifying expression was mostly copied and pasted from CMSIS
     bool was_enabled = 
@@ -93,26 +160,167 @@ bool job_disable(job_t job) {
 
 // schedule a specific job, so it will run if it scheduled and no
 // higher priority job is running. this will only run the job once!
-void job_schedule(job_t job) {
+HOT_FUNC void job_schedule(job_t job) {
     NVIC_SetPendingIRQ((IRQn_Type)job);
 }
 
-// catch the interrupts so we can direct them to their jobs 
+// the deferred work queues
+// every slot has a sequence number which says whose turn it is. a poster
+// claims the slot at head when its sequence number equals head, fills it
+// in, then bumps the number so the work job knows it's ready. the work job
+// takes the slot at tail when its number is tail+1, then bumps it by the
+// queue size so it's free for the next time around.
+
+#define WORK_MASK (JOB_WORK_QUEUE_SIZE-1)
+
+typedef struct {
+    volatile uint32_t seq;
+    job_work_func func;
+    uint32_t arg;
+} work_slot_t;
+
+typedef struct {
+    job_t job;
+    work_slot_t slots[JOB_WORK_QUEUE_SIZE];
+    volatile uint32_t head;
+    // only the work job touches this
+    uint32_t tail;
+    volatile uint32_t runs;
+    volatile uint32_t drops;
+} work_queue_t;
+
+static work_queue_t work_queues[JOB_NUM_LEVELS] = {
+    [JOB_LEVEL_HIGH] = {.job = JOB_WORK_HIGH},
+    [JOB_LEVEL_NORMAL] = {.job = JOB_WORK_NORMAL},
+    [JOB_LEVEL_LOW] = {.job = JOB_WORK_LOW},
+};
+
+// the slots' sequence numbers have to start out equal to their index
+static void init_work_queues(void) {
+    for (int li=0; li<JOB_NUM_LEVELS; li++) {
+        work_queue_t* q = &work_queues[li];
+        for (uint32_t si=0; si<JOB_WORK_QUEUE_SIZE; si++) {
+            q->slots[si].seq = si;
+        }
+        q->head = 0;
+        q->tail = 0;
+    }
+}
+
+// post some work. this doesn't lock anything, so it's safe from any
+// interrupt at all. returns false if that level's queue is full.
+bool job_post(job_level_t level, job_work_func func, uint32_t arg) {
+    work_queue_t* q = &work_queues[level];
+    work_slot_t* slot;
+    uint32_t pos;
+    while (1) {
+        pos = __LDREXW(&q->head);
+        slot = &q->slots[pos & WORK_MASK];
+        int32_t diff = (int32_t)(slot->seq - pos);
+        if (diff > 0) {
+            // somebody interrupted us and took this slot, so try the next
+            __CLREX();
+            continue;
+        } else if (diff < 0) {
+            // the work job hasn't gotten to this one from last time around
+            __CLREX();
+            // count the drop the same way, so we don't need a lock
+            uint32_t drops;
+            do {
+                drops = __LDREXW(&q->drops);
+            } while (__STREXW(drops+1, &q->drops));
+            return false;
+        }
+        // if anything interrupted us since the LDREX, this fails and we try
+        // again with whatever head is now
+        if (!__STREXW(pos+1, &q->head)) {
+            break;
+        }
+    }
+    slot->func = func;
+    slot->arg = arg;
+    // make sure the work job sees the work before it sees it's ready
+    __DMB();
+    slot->seq = pos+1;
+    trace_event(TRACE_WORK_POST, level);
+    job_schedule(q->job);
+    return true;
+}
+
+// run everything that's ready at one level
+static void run_work(work_queue_t* q) {
+    while (1) {
+        work_slot_t* slot = &q->slots[q->tail & WORK_MASK];
+        // if a poster was interrupted in the middle of filling this in, it
+        // will schedule us again once it's done
+        if (slot->seq != q->tail+1) {
+            return;
+        }
+        job_work_func func = slot->func;
+        uint32_t arg = slot->arg;
+        __DMB();
+        slot->seq = q->tail + JOB_WORK_QUEUE_SIZE;
+        q->tail++;
+        q->runs++;
+        func(arg);
+    }
+}
+
+static void job_handle_work_high(void) {
+    run_work(&work_queues[JOB_LEVEL_HIGH]);
+}
+
+static void job_handle_work_normal(void) {
+    run_work(&work_queues[JOB_LEVEL_NORMAL]);
+}
+
+static void job_handle_work_low(void) {
+    run_work(&work_queues[JOB_LEVEL_LOW]);
+}
+
+void job_get_work_stats(job_level_t level, job_work_stats_t* stats) {
+    stats->runs = work_queues[level].runs;
+    stats->drops = work_queues[level].drops;
+}
+
+// catch the interrupts so we can direct them to their jobs
+// to add a job, give it an interrupt we don't use in job_t, put it in the
+// table, and make its handler call run_job here
+
+static inline void run_job(job_index_t index) {
+    uint32_t start = TIMER_US_NOW();
+    trace_event(TRACE_JOB_BEGIN, job_table[index].job);
+    job_table[index].handler();
+    trace_event(TRACE_JOB_END, job_table[index].job);
+    prof_record(job_table[index].prof, start);
+}
 
 // JOB_SYSTEM
-#include "system/system.h"
 void USB_HP_IRQHandler(void) {
-    sys_handle_job_system();
+    run_job(JOB_INDEX_SYSTEM);
 }
 
 // JOB_10MS_TIMER
-#include "system/timer.h"
 void TIM6_IRQHandler(void) {
-    timer_handle_job_10ms_timer();
+    run_job(JOB_INDEX_10MS_TIMER);
 }
 
 // JOB_MEASUREMENT
-#include "measurement/measurement.h"
 void USB_LP_IRQHandler(void) {
-    meas_handle_job_measurement();
+    run_job(JOB_INDEX_MEASUREMENT);
+}
+
+// JOB_WORK_HIGH
+void UART4_IRQHandler(void) {
+    run_job(JOB_INDEX_WORK_HIGH);
+}
+
+// JOB_WORK_NORMAL
+void UART5_IRQHandler(void) {
+    run_job(JOB_INDEX_WORK_NORMAL);
+}
+
+// JOB_WORK_LOW
+void SPI3_IRQHandler(void) {
+    run_job(JOB_INDEX_WORK_LOW);
 }
\ No newline at end of file
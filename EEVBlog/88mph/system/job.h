@@ -25,7 +25,8 @@
 
 // this module deals with Jobs
 // we attach specific jobs to interrupts we won't use, then use the NVIC
-// to automatically prioritize them
+// to automatically prioritize them. the table in job.c says which jobs
+// there are, what priority each one gets, and what it runs.
 
 // this module also sets priorities for all the interrupts we do use
 
@@ -35,7 +36,11 @@ typedef enum {
     JOB_ACQUISITION = EXTI3_IRQn,
     JOB_10MS_TIMER = TIM6_IRQn,
     JOB_SYSTEM = USB_HP_IRQn,
-    JOB_MEASUREMENT = USB_LP_IRQn
+    JOB_MEASUREMENT = USB_LP_IRQn,
+    // these just run whatever work has been posted to them
+    JOB_WORK_HIGH = UART4_IRQn,
+    JOB_WORK_NORMAL = UART5_IRQn,
+    JOB_WORK_LOW = SPI3_IRQn
 } job_t;
 
 // configure the NVIC for everything, but don't enable any of the jobs
@@ -61,6 +66,36 @@ bool job_disable(job_t job);
 // higher priority job is running. this will only run the job once!
 void job_schedule(job_t job);
 
+// anything can post a function to one of the work jobs, which will call it
+// with arg once no higher priority job is running. each level's work is run
+// in the order it was posted.
+// HIGH runs between acquisition and measurement, NORMAL between measurement
+// and the system job, and LOW only when everything else is done.
+typedef enum {
+    JOB_LEVEL_HIGH=0,
+    JOB_LEVEL_NORMAL,
+    JOB_LEVEL_LOW,
+    JOB_NUM_LEVELS
+} job_level_t;
+
+typedef void (*job_work_func)(uint32_t arg);
+
+// how much work can be waiting at each level
+// must be power of 2!!
+#define JOB_WORK_QUEUE_SIZE (16)
+
+// post some work. this doesn't lock anything, so it's safe from any
+// interrupt at all. returns false if that level's queue is full.
+bool job_post(job_level_t level, job_work_func func, uint32_t arg);
+
+typedef struct {
+    // how much work was run
+    uint32_t runs;
+    // how much couldn't be posted because the queue was full
+    uint32_t drops;
+} job_work_stats_t;
+
+void job_get_work_stats(job_level_t level, job_work_stats_t* stats);
 
 // catch the interrupts so we can direct them to their jobs
 // JOB_SYSTEM
@@ -72,4 +107,9 @@ void TIM6_IRQHandler(void);
 // JOB_MEASUREMENT
 void USB_LP_IRQHandler(void);
 
+// JOB_WORK_HIGH, JOB_WORK_NORMAL and JOB_WORK_LOW
+void UART4_IRQHandler(void);
+void UART5_IRQHandler(void);
+void SPI3_IRQHandler(void);
+
 #endif
\ No newline at end of file
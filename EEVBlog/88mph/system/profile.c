@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include "stm32l1xx.h"
+
+#include "system/profile.h"
+
+#include "system/timer.h"
+#include "system/clock.h"
+
+static prof_counter_t counters[PROF_NUM_COUNTERS];
+
+// record that something started at start_us and ended now
+// each counter must only be updated from one job!
+HOT_FUNC void prof_record(prof_counter_id_t which, uint32_t start_us) {
+    uint32_t elapsed = TIMER_US_NOW() - start_us;
+    prof_counter_t* c = &counters[which];
+    c->runs++;
+    c->last_us = elapsed;
+    c->total_us += elapsed;
+    if (elapsed > c->max_us) {
+        c->max_us = elapsed;
+    }
+}
+
+// get a copy of a counter
+void prof_get(prof_counter_id_t which, prof_counter_t* counter) {
+    // the job could interrupt us in the middle of copying
+    __disable_irq();
+    *counter = counters[which];
+    __enable_irq();
+}
+
+// zero all of them
+void prof_reset(void) {
+    __disable_irq();
+    for (int i=0; i<PROF_NUM_COUNTERS; i++) {
+        counters[i] = (prof_counter_t){0};
+    }
+    __enable_irq();
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_PROFILE_H
+#define SYSTEM_PROFILE_H
+
+#include <stdint.h>
+
+#include "system/timer.h"
+
+// this file keeps track of how long the jobs take to run
+// times come from the microsecond timer, so they include any time spent
+// in higher priority jobs that interrupted the one being measured
+
+typedef enum {
+    PROF_JOB_ACQUISITION=0,
+    PROF_JOB_MEASUREMENT,
+    PROF_JOB_SYSTEM,
+    PROF_JOB_10MS_TIMER,
+    PROF_JOB_WORK_HIGH,
+    PROF_JOB_WORK_NORMAL,
+    PROF_JOB_WORK_LOW,
+    PROF_NUM_COUNTERS
+} prof_counter_id_t;
+
+typedef struct {
+    // how many times it ran
+    uint32_t runs;
+    // how long it took last time, the longest it's ever taken,
+    // and how long it's taken all together
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t total_us;
+} prof_counter_t;
+
+// record that something started at start_us and ended now
+// each counter must only be updated from one job!
+void prof_record(prof_counter_id_t which, uint32_t start_us);
+
+// get a copy of a counter
+void prof_get(prof_counter_id_t which, prof_counter_t* counter);
+// zero all of them
+void prof_reset(void);
+
+#endif
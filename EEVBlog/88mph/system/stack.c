@@ -0,0 +1,50 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include "stm32l1xx.h"
+
+#include "system/stack.h"
+
+// from the linker script
+extern uint32_t _sdata, _edata, _sbss, _ebss, _sstack, _estack;
+extern uint8_t _Min_Heap_Size;
+
+// get the deepest the stack has ever been, in bytes
+// this looks through the painted area, so it takes a little while
+uint32_t stack_get_peak(void) {
+    // the stack grows down, so the first word that's not paint is as far as
+    // it's gotten. something could have written the paint back, but that's
+    // pretty unlikely.
+    uint32_t* p = &_sstack;
+    while (p < &_estack && *p == STACK_PAINT) {
+        p++;
+    }
+    return (uint32_t)&_estack - (uint32_t)p;
+}
+
+// get all of the above
+void stack_get_usage(stack_usage_t* usage) {
+    usage->data = (uint32_t)&_edata - (uint32_t)&_sdata;
+    usage->bss = (uint32_t)&_ebss - (uint32_t)&_sbss;
+    // it's a linker symbol, so its address is the number
+    usage->heap = (uint32_t)&_Min_Heap_Size;
+    usage->stack_size = (uint32_t)&_estack - (uint32_t)&_sstack;
+    usage->stack_peak = stack_get_peak();
+    usage->stack_now = (uint32_t)&_estack - __get_MSP();
+}
@@ -0,0 +1,54 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_STACK_H
+#define SYSTEM_STACK_H
+
+#include <stdint.h>
+
+// this file keeps an eye on how much RAM is used
+// everything runs on the one main stack, including every job, so the
+// deepest it gets is main plus the worst job at each priority level all
+// interrupting each other. the startup code paints the free RAM above the
+// heap with STACK_PAINT, and whatever hasn't been painted over since then
+// is RAM the stack has never needed.
+// tools/mem_report.py works out the same thing from the build, per job.
+
+// must match the startup code!
+#define STACK_PAINT (0xA5A5A5A5)
+
+typedef struct {
+    // the linker's idea of the RAM, in bytes
+    uint32_t data;
+    uint32_t bss;
+    uint32_t heap;
+    // everything above the heap is the stack's
+    uint32_t stack_size;
+    // the most of it that's ever been used
+    uint32_t stack_peak;
+    // how much is in use right now, by whoever asked
+    uint32_t stack_now;
+} stack_usage_t;
+
+// get the deepest the stack has ever been, in bytes
+// this looks through the painted area, so it takes a little while
+uint32_t stack_get_peak(void);
+// get all of the above
+void stack_get_usage(stack_usage_t* usage);
+
+#endif
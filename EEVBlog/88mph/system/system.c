@@ -24,38 +24,131 @@
 
 #include "system/job.h"
 #include "system/timer.h"
+#include "system/idle.h"
+#include "system/clock.h"
+#include "system/bench.h"
+#include "system/boot.h"
+#include "system/deadline.h"
+#include "system/health.h"
 #include "hardware/lcd.h"
+#include "hardware/lcd_segments.h"
 #include "hardware/buttons.h"
+#include "hardware/buzzer.h"
+#include "hardware/rtc.h"
 #include "measurement/measurement.h"
 #include "measurement/meas_modes.h"
+#include "measurement/bus.h"
+#include "measurement/minmax.h"
+#include "measurement/autohold.h"
+#include "measurement/relative.h"
+#include "measurement/decibel.h"
 #include "acquisition/acquisition.h"
 #include "acquisition/reading.h"
+#include "acquisition/capture.h"
+#include "comms/uart.h"
+#include "comms/stream.h"
+#include "comms/console.h"
+#include "storage/dump.h"
+#include "storage/logger.h"
 
 void sys_main_loop(void) {
     __enable_irq();
+    boot_mark(BOOT_MARK_MAIN_LOOP);
     job_init();
+    clock_init();
+    bench_init();
+    bus_init();
+    timer_init();
+    idle_init();
+    rtc_init();
+
+    // get something on the screen right away so it doesn't look dead
+    // while the HY3131 powers up
+    lcd_put_str(LCD_SCREEN_MAIN, "-----");
+    lcd_queue_update();
+    __disable_irq();
+    job_enable(JOB_10MS_TIMER);
+    job_enable(JOB_SYSTEM);
+    job_enable(JOB_WORK_HIGH);
+    job_enable(JOB_WORK_NORMAL);
+    job_enable(JOB_WORK_LOW);
+    __enable_irq();
+    boot_mark(BOOT_MARK_LCD);
+
     acq_init();
+    boot_mark(BOOT_MARK_HY_READY);
     meas_init();
-    timer_init();
 
-    // enable all the jobs so the system starts working
+    // the screen only ever wants the newest readings. some modes send a
+    // reading of each kind together, so keep room for all of them
+    bus_subscribe(BUS_SUB_DISPLAY, 1, 4, JOB_SYSTEM);
+    bus_subscribe(BUS_SUB_BARGRAPH, 1, 4, JOB_SYSTEM);
+
+    // enable the rest of the jobs so the system starts measuring
     // do this with interrupts disabled so we can ensure we get
     // a chance to turn them all on!
     __disable_irq();
-    job_enable(JOB_10MS_TIMER);
-    job_enable(JOB_SYSTEM);
     job_enable(JOB_MEASUREMENT);
     job_enable(JOB_ACQUISITION);
     __enable_irq();
 
     meas_set_mode(MEAS_MODE_VOLTS_DC);
 
+    // the UART and ADC are turned on after the first reading, but make
+    // sure that happens even if it never comes
+    idle_request_wakeup(BOOT_BACKGROUND_MAX_WAIT_MS);
+
     while (1) {
         // the main loop just sleeps
         // we trust an interrupt will arrive and wake us up
         // if there is something interesting to do
-        __WFI();
+        idle_sleep();
+    }
+}
+
+// which statistic the MIN MAX button has put on the sub screen
+typedef enum {
+    MINMAX_VIEW_OFF=0,
+    MINMAX_VIEW_MAX,
+    MINMAX_VIEW_MIN,
+    MINMAX_VIEW_AVG
+} minmax_view_t;
+
+// put the chosen statistic of the session on the sub screen
+static void show_minmax(minmax_view_t view) {
+    minmax_session_t s;
+    if (!minmax_session_get(&s)) {
+        lcd_put_str(LCD_SCREEN_SUB, "-----");
+        return;
+    }
+    reading_t r = {
+        // millicounts
+        (view == MINMAX_VIEW_MAX) ? s.mm.max :
+            (view == MINMAX_VIEW_MIN) ? s.mm.min : minmax_get_mean(&s.mm),
+        0, // time_ms
+        0, // time_us
+        s.unit, // unit
+        s.exponent, // exponent
+        s.decimal, // decimal
+        RDG_KIND_SUB, // kind
+        0 // mean_square
+    };
+    lcd_put_reading(LCD_SCREEN_SUB, r);
+}
+
+// put a reading on the main screen, relative to the REL reference if
+// there is one. dB goes on the sub screen since only it has the icon
+static void show_main(reading_t reading, bool show_db) {
+    reading_t db;
+    if (show_db) {
+        if (db_from_reading(&reading, &db)) {
+            lcd_put_reading(LCD_SCREEN_SUB, db);
+        } else {
+            lcd_put_str(LCD_SCREEN_SUB, "-----");
+        }
     }
+    rel_apply(&reading);
+    lcd_put_reading(LCD_SCREEN_MAIN, reading);
 }
 
 void sys_handle_job_system(void) {
@@ -64,37 +157,167 @@ void sys_handle_job_system(void) {
 
     static button_t curr_button = BTN_NONE;
     static button_t curr_state = BTN_RELEASED;
+    static button_t curr_rsw = BTN_NONE;
+    // the last mode that put something on the sub screen
+    static meas_mode_t sub_screen_mode = MEAS_NUM_MODES;
+    static minmax_view_t minmax_view = MINMAX_VIEW_OFF;
+    // HOLD freezes the main screen
+    static bool manual_hold = false;
+    // how many times auto hold had held something last time we looked
+    static uint32_t autohold_locks = 0;
 
+    // dB takes over the sub screen, unless MIN MAX is using it
+    bool show_db = (db_get_mode() != DB_MODE_OFF &&
+        minmax_view == MINMAX_VIEW_OFF);
+
+    // auto hold shows whatever it last held instead of the live reading
+    reading_t held;
+    uint32_t locks;
+    bool auto_held = autohold_is_enabled() &&
+        autohold_get_held(&held, &locks);
+    if (auto_held && locks != autohold_locks) {
+        // something new settled, so tell the user about it
+        autohold_locks = locks;
+        buzzer_beep(BUZZER_BEEP_10MS);
+        show_main(held, show_db);
+        lcd_queue_update();
+    }
+
+    // put the latest readings on the screen
     reading_t reading;
     bool got_new_reading = false;
-    // get the latest reading
-    while (meas_get_reading(&reading)) {
-        got_new_reading = true;
+    while (bus_get(BUS_SUB_DISPLAY, &reading)) {
+        // each kind has its own place to go
+        // the low-pass channel is just for the PC
+        if (reading.kind == RDG_KIND_MAIN) {
+            got_new_reading = true;
+            if (!manual_hold && !auto_held) {
+                show_main(reading, show_db);
+            }
+            boot_mark(BOOT_MARK_FIRST_READING);
+        } else if (reading.kind == RDG_KIND_SUB && !show_db) {
+            got_new_reading = true;
+            lcd_put_reading(LCD_SCREEN_SUB, reading);
+            sub_screen_mode = meas_get_mode();
+        }
+    }
+    while (bus_get(BUS_SUB_BARGRAPH, &reading)) {
+        // the bargraph goes with the main screen
+        if (reading.kind == RDG_KIND_MAIN) {
+            got_new_reading = true;
+            lcd_put_bargraph(reading);
+        }
+    }
+    if (got_new_reading && minmax_view != MINMAX_VIEW_OFF) {
+        show_minmax(minmax_view);
     }
-
-    // and put it on the screen
     if (got_new_reading) {
-        lcd_put_reading(LCD_SCREEN_MAIN, reading);
         lcd_queue_update();
     }
 
+    // the PC wants every reading, not just the latest one
+    stream_process();
+
+    // finish booting once there's something to look at
+    boot_process();
+
+    // see if the PC wants anything
+    console_process();
+    // and keep any capture or dump moving along
+    capture_process();
+    // and let the clock slow down if the acquisition doesn't need it
+    acq_process();
+    dump_process();
+    logger_process();
+    deadline_process();
+    health_process();
+
     button_state_t new_state;
     button_t new_button = btn_get_new(&new_state);
     if (new_button != BTN_NONE) {
         curr_button = new_button;
         curr_state = new_state;
+        // pressing anything stops the logger, since the console might
+        // be turned off
+        logger_stop();
+
+        // MIN MAX starts a fresh session and steps through max, min and
+        // average. holding it turns it off again
+        if (new_button == BTN_MIN_MAX && new_state == BTN_PRESSED) {
+            if (minmax_view == MINMAX_VIEW_OFF) {
+                minmax_session_reset();
+                minmax_view = MINMAX_VIEW_MAX;
+            } else if (minmax_view == MINMAX_VIEW_AVG) {
+                minmax_view = MINMAX_VIEW_MAX;
+            } else {
+                minmax_view++;
+            }
+            show_minmax(minmax_view);
+        } else if (new_button == BTN_MIN_MAX && new_state == BTN_HELD) {
+            minmax_view = MINMAX_VIEW_OFF;
+        }
+
+        // REL takes the next reading as the reference, and pressing it
+        // again goes back to the real readings
+        if (new_button == BTN_REL && new_state == BTN_PRESSED) {
+            if (rel_is_on()) {
+                rel_stop();
+            } else {
+                rel_start();
+            }
+        }
+
+        // MODE steps the sub screen through dBm, dBV and back to off
+        if (new_button == BTN_MODE && new_state == BTN_PRESSED) {
+            db_mode_t mode = db_get_mode();
+            db_set_mode((mode == DB_MODE_DBV) ? DB_MODE_OFF : mode+1);
+        }
+
+        // HOLD freezes the screen, and holding it down switches to auto
+        // hold instead. a hold press always comes after a normal one, so
+        // undo that first
+        if (new_button == BTN_HOLD && new_state == BTN_PRESSED) {
+            manual_hold = !manual_hold;
+        } else if (new_button == BTN_HOLD && new_state == BTN_HELD) {
+            manual_hold = !manual_hold;
+            autohold_enable(!autohold_is_enabled());
+        }
+    }
+
+    // follow the range switch into the modes that can measure so far
+    // positions without one leave whatever's running alone
+    button_t rsw = btn_get_rsw();
+    if (rsw != curr_rsw) {
+        curr_rsw = rsw;
+        if (rsw == BTN_RSW_V) {
+            meas_set_mode(MEAS_MODE_VOLTS_DC);
+        }
     }
 
+    LCD_SEGSET(SEG_ICON_MAX, minmax_view == MINMAX_VIEW_MAX);
+    LCD_SEGSET(SEG_ICON_MIN, minmax_view == MINMAX_VIEW_MIN);
+    LCD_SEGSET(SEG_ICON_AVG, minmax_view == MINMAX_VIEW_AVG);
+    LCD_SEGSET(SEG_ICON_HOLD, manual_hold || autohold_is_enabled());
+    LCD_SEGSET(SEG_ICON_AUTO_OF_HOLD, autohold_is_enabled());
+    LCD_SEGSET(SEG_ICON_REL, rel_is_on());
+
+    // the sub screen shows the buttons unless something else is using it
+    if (minmax_view != MINMAX_VIEW_OFF || db_get_mode() != DB_MODE_OFF ||
+            sub_screen_mode == meas_get_mode()) {
+        return;
+    }
     reading_t r = {
         // millicounts
         (((int32_t)curr_button) * 1000)+
         (((int32_t)curr_state) * 100000)+
-        (((int32_t)btn_get_rsw()) * 1000000),
+        (((int32_t)rsw) * 1000000),
         0, // time_ms
+        0, // time_us
         RDG_UNIT_NONE, // unit
         RDG_EXPONENT_NONE, // exponent
         RDG_DECIMAL_10000, // decimal
-        RDG_KIND_MAIN // kind
+        RDG_KIND_MAIN, // kind
+        0 // mean_square
     };
     lcd_put_reading(LCD_SCREEN_SUB, r);
 }
\ No newline at end of file
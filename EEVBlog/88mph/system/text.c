@@ -0,0 +1,47 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+
+#include "system/text.h"
+
+// write v in decimal to buf, which must have room for 10 chars
+// returns how many chars were written. no terminator is written!
+uint8_t text_put_uint(char* buf, uint32_t v) {
+    // digits come out backwards, so collect them first
+    char digits[10];
+    uint8_t n = 0;
+    do {
+        digits[n++] = (v % 10) + '0';
+        v /= 10;
+    } while (v);
+    for (uint8_t i=0; i<n; i++) {
+        buf[i] = digits[n-1-i];
+    }
+    return n;
+}
+
+// same, but signed, so there must be room for 11 chars
+uint8_t text_put_int(char* buf, int32_t v) {
+    if (v < 0) {
+        buf[0] = '-';
+        // negate as unsigned so INT32_MIN works
+        return 1 + text_put_uint(buf+1, -(uint32_t)v);
+    }
+    return text_put_uint(buf, v);
+}
@@ -0,0 +1,33 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_TEXT_H
+#define SYSTEM_TEXT_H
+
+#include <stdint.h>
+
+// this file has some tiny helpers for turning numbers into text
+// printf would drag in far too much of the C library
+
+// write v in decimal to buf, which must have room for 10 chars
+// returns how many chars were written. no terminator is written!
+uint8_t text_put_uint(char* buf, uint32_t v);
+// same, but signed, so there must be room for 11 chars
+uint8_t text_put_int(char* buf, int32_t v);
+
+#endif
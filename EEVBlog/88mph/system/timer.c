@@ -23,8 +23,10 @@
 #include "system/timer.h"
 
 #include "system/job.h"
+#include "system/deadline.h"
 #include "hardware/buttons.h"
 #include "hardware/lcd.h"
+#include "hardware/buzzer.h"
 
 // number of milliseconds since timer was inited
 volatile uint32_t timer_1ms_ticks = 0;
@@ -33,6 +35,27 @@ volatile uint32_t timer_10ms_ticks = 0;
 
 static volatile bool timer_is_inited = false;
 
+// HAL's millisecond count. it doesn't put this in a header
+extern __IO uint32_t uwTick;
+
+// set if TIM6 was stopped along with SysTick
+static bool ticks_10ms_suspended = false;
+// leftover microseconds from the last time the ticks were suspended
+// that didn't add up to a full tick
+static uint32_t carry_1ms_us = 0;
+static uint32_t carry_10ms_us = 0;
+
+// APB1 is never divided, so the timers run at the same speed as HCLK
+// this gets the TIM6 reload value for 10ms, with its prescaler of 64
+static uint32_t tim6_reload(void) {
+    return HAL_RCC_GetPCLK1Freq()/100/64 - 1;
+}
+
+// and the TIM5 prescaler for a microsecond per count
+static uint32_t tim5_prescale(void) {
+    return HAL_RCC_GetPCLK1Freq()/1000000 - 1;
+}
+
 void timer_init(void) {
     // 1ms timer is already set up by HAL
     // so just turn on the flag
@@ -44,7 +67,6 @@ void timer_init(void) {
     __enable_irq();
 
     // set up TIM6 to interrupt at a 10ms interval
-    // this happens every 120000 system clock cycles
 
     // power up timer and bring it out of reset
     __HAL_RCC_TIM6_FORCE_RESET();
@@ -53,15 +75,29 @@ void timer_init(void) {
 
     // we want 1 timer cycle per 64 clock cycles
     TIM6->PSC = 64-1;
-
-    // automatically reload with 120000/64
-    TIM6->ARR = 120000/64;
+    // and the reload value depends on the clock speed
+    TIM6->ARR = tim6_reload();
 
     TIM6->DIER = TIM_DIER_UIE; // enable interrupt on update
     TIM6->CR1 = TIM_CR1_URS | // only trigger update on overflow
                 TIM_CR1_CEN; // turn on counting
 
     // the timer will be enabled when its job is enabled
+
+    // set up TIM5 to count microseconds forever
+    // it's used to timestamp readings, so it never interrupts
+
+    __HAL_RCC_TIM5_FORCE_RESET();
+    __HAL_RCC_TIM5_CLK_ENABLE();
+    __HAL_RCC_TIM5_RELEASE_RESET();
+
+    // we want 1 timer cycle per microsecond
+    TIM5->PSC = tim5_prescale();
+    // count through all 32 bits before wrapping
+    TIM5->ARR = 0xFFFFFFFF;
+    // the prescaler is only loaded on an update event, so force one now
+    TIM5->EGR = TIM_EGR_UG;
+    TIM5->CR1 = TIM_CR1_CEN; // turn on counting
 }
 
 void timer_deinit(void) {
@@ -74,28 +110,86 @@ void timer_deinit(void) {
     // turn off the timer job
     job_disable(JOB_10MS_TIMER);
 
-    // and turn off the timer hardware clock
+    // and turn off the timer hardware clocks
     __HAL_RCC_TIM6_CLK_DISABLE();
+    __HAL_RCC_TIM5_CLK_DISABLE();
 }
 
-// callback for 1ms timer
-// eventually this will just be the systick handler
-// but for now HAL needs it too and it stops us overriding
-// so we get called by HAL, with some performance penalty
-void HAL_SYSTICK_Callback(void) {
+// handler for 1ms timer
+// this replaces the cube-generated handler, which called HAL_IncTick and
+// then went through HAL_SYSTICK_IRQHandler just to call us back
+void SysTick_Handler(void) {
     // HAL needs to be running all the time or we will hang
-    // so only do our work if we are inited
+    HAL_IncTick();
+    // but only do our work if we are inited
     if (!timer_is_inited) return;
     timer_1ms_ticks++;
 }
 
+// the system clock changed speed, so make the timers count at the same
+// rate as before. called with interrupts disabled.
+void timer_clock_changed(void) {
+    // ARR isn't buffered, so it takes effect right away
+    TIM6->ARR = tim6_reload();
+    if (TIM6->CNT > TIM6->ARR) {
+        TIM6->CNT = 0;
+    }
+    // the prescaler is only loaded on an update event, but forcing one
+    // zeros the count, so put the count back after
+    uint32_t cnt = TIM5->CNT;
+    TIM5->PSC = tim5_prescale();
+    TIM5->EGR = TIM_EGR_UG;
+    TIM5->CNT = cnt;
+}
+
+// stop SysTick, and TIM6 too if suspend_10ms is set, so they don't wake
+// the core up while it's idle. interrupts must be disabled until the ticks
+// are resumed!
+void timer_suspend_ticks(bool suspend_10ms) {
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (suspend_10ms) {
+        TIM6->CR1 &= ~TIM_CR1_CEN;
+    }
+    ticks_10ms_suspended = suspend_10ms;
+}
+
+// start the ticks again, moving the counts forward by the elapsed_us they
+// were stopped for. the counters pick up partway through their period
+// where they left off, so only the time they were stopped needs adding.
+void timer_resume_ticks(uint32_t elapsed_us) {
+    uint32_t us = elapsed_us + carry_1ms_us;
+    uint32_t ms = us/1000;
+    carry_1ms_us = us%1000;
+    uwTick += ms;
+    if (timer_is_inited) {
+        timer_1ms_ticks += ms;
+    }
+
+    if (ticks_10ms_suspended) {
+        us = elapsed_us + carry_10ms_us;
+        timer_10ms_ticks += us/10000;
+        carry_10ms_us = us%10000;
+        TIM6->CR1 |= TIM_CR1_CEN;
+        ticks_10ms_suspended = false;
+    }
+
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+}
+
 void timer_handle_job_10ms_timer(void) {
+    uint32_t start = TIMER_US_NOW();
     // acknowledge interrupt
     TIM6->SR = 0;
 
     timer_10ms_ticks++;
 
     btn_process();
+    buzzer_10ms();
 
     lcd_10ms_update_if_necessary();
+
+    // if the timer's gone off again already, we took too long
+    if (TIM6->SR & TIM_SR_UIF) {
+        deadline_record(DEADLINE_10MS_OVERRUN, TIMER_US_NOW() - start);
+    }
 }
\ No newline at end of file
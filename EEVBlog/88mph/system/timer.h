@@ -20,21 +20,42 @@
 #define SYSTEM_TIMER_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
 
-// this file handles the two system timers
-// 1ms and 10ms
+// this file handles the system timers
+// 1ms and 10ms, plus a free-running microsecond timestamp counter
 
 void timer_init(void);
 void timer_deinit(void);
 
-// callback for 1ms timer
-void HAL_SYSTICK_Callback(void);
+// handler for 1ms timer
+// we handle SysTick ourselves instead of going through the HAL's callback
+void SysTick_Handler(void);
 // callback for 10ms timer
 void timer_handle_job_10ms_timer(void);
 
+// the system clock changed speed, so make the timers count at the same
+// rate as before. called with interrupts disabled.
+void timer_clock_changed(void);
+
+// stop SysTick, and TIM6 too if suspend_10ms is set, so they don't wake
+// the core up while it's idle. interrupts must be disabled until the ticks
+// are resumed!
+void timer_suspend_ticks(bool suspend_10ms);
+// start the ticks again, moving the counts forward by the elapsed_us they
+// were stopped for
+void timer_resume_ticks(uint32_t elapsed_us);
+
 // number of milliseconds since timer was inited
 extern volatile uint32_t timer_1ms_ticks;
 // number of 10 millisecond periods since timer was inited
 extern volatile uint32_t timer_10ms_ticks;
 
+// the microsecond timer is TIM5, which is a full 32 bit counter on this chip
+// so we don't need to chain two 16 bit timers together. it runs freely and
+// wraps around about every 71.6 minutes, so only differences are meaningful.
+// reading it is a single load, so it's safe to use from any job.
+#define TIMER_US_NOW() (TIM5->CNT)
+
 #endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx.h"
+
+#include "system/trace.h"
+
+#include "system/timer.h"
+#include "system/clock.h"
+#include "system/text.h"
+#include "storage/dump.h"
+
+#define TRACE_MASK (TRACE_BUF_SIZE-1)
+
+static trace_entry_t trace_buf[TRACE_BUF_SIZE];
+// how many events have been recorded all together. the newest is one
+// before this in the ring
+static uint32_t trace_total = 0;
+static volatile bool tracing = false;
+
+// start recording. the ring keeps the newest events, so it's fine to leave
+// it going until something interesting happens
+void trace_start(void) {
+    tracing = true;
+}
+
+// stop recording so the ring can be looked at
+void trace_stop(void) {
+    tracing = false;
+}
+
+// throw away everything recorded
+void trace_clear(void) {
+    __disable_irq();
+    trace_total = 0;
+    __enable_irq();
+}
+
+bool trace_is_running(void) {
+    return tracing;
+}
+
+// record an event. safe from any job, even with interrupts disabled
+HOT_FUNC void trace_event(trace_id_t id, uint32_t arg) {
+    if (!tracing) {
+        return;
+    }
+    // this might be called with interrupts already off, e.g. by
+    // idle_sleep, so put them back how they were
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    trace_entry_t* e = &trace_buf[trace_total++ & TRACE_MASK];
+    e->time_us = TIMER_US_NOW();
+    e->id = (uint16_t)id;
+    e->arg = (uint16_t)arg;
+    __set_PRIMASK(primask);
+}
+
+// how many events are in the ring, and how many fell off the end
+uint32_t trace_get_count(void) {
+    uint32_t total = trace_total;
+    return total > TRACE_BUF_SIZE ? TRACE_BUF_SIZE : total;
+}
+
+uint32_t trace_get_lost(void) {
+    uint32_t total = trace_total;
+    return total > TRACE_BUF_SIZE ? total - TRACE_BUF_SIZE : 0;
+}
+
+// event number index, counting from the oldest one still in the ring
+static const trace_entry_t* get_entry(uint32_t index) {
+    return &trace_buf[(trace_get_lost() + index) & TRACE_MASK];
+}
+
+// records for the dumper are a trace_entry_t, little endian
+// tracing is stopped while dumping, so they're never gone
+static bool dump_get_record(uint32_t index, uint8_t* record) {
+    const trace_entry_t* e = get_entry(index);
+    for (int bi=0; bi<4; bi++) {
+        record[bi] = (uint8_t)(e->time_us >> (8*bi));
+    }
+    record[4] = (uint8_t)e->id;
+    record[5] = (uint8_t)(e->id >> 8);
+    record[6] = (uint8_t)e->arg;
+    record[7] = (uint8_t)(e->arg >> 8);
+    return true;
+}
+
+static uint8_t dump_format_record(uint32_t index, char* text) {
+    const trace_entry_t* e = get_entry(index);
+    uint8_t n = text_put_uint(text, e->time_us);
+    text[n++] = ',';
+    n += text_put_uint(text+n, e->id);
+    text[n++] = ',';
+    n += text_put_uint(text+n, e->arg);
+    text[n++] = '\n';
+    return n;
+}
+
+static dump_source_t trace_dump_source = {
+    DUMP_ID_TRACE, // id
+    "TRACE.CSV", // filename
+    "time_us,event,arg\n", // csv_header
+    0, // count
+    0, // marker
+    sizeof(trace_entry_t), // record_size
+    dump_get_record, // get_record
+    dump_format_record // format_record
+};
+
+// send the ring out with the dumper, oldest first. stops tracing first.
+// returns false if the dumper is busy with something else.
+bool trace_dump(dump_dest_t dest) {
+    // the dump would trace itself otherwise
+    trace_stop();
+    trace_dump_source.count = trace_get_count();
+    trace_dump_source.marker = trace_get_lost();
+    return dump_start(&trace_dump_source, dest);
+}
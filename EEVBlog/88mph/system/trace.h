@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+#ifndef SYSTEM_TRACE_H
+#define SYSTEM_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "storage/dump.h"
+
+// this file keeps a timeline of what the firmware is doing
+// interesting places call trace_event, which puts a little record into a
+// ring in RAM. once tracing is stopped, the ring can be dumped and turned
+// into something a trace viewer understands with tools/trace2chrome.py.
+
+// events are stamped with the microsecond timer. the cycle counter would
+// be finer, but it stops while we sleep and changes speed with the clock.
+
+// must be power of 2!!
+// each event is 8 bytes, so this is 4KB
+#define TRACE_BUF_SIZE (512)
+
+// do not change the values!! the host tool knows them
+typedef enum {
+    // a job started or finished. arg is its job_t
+    TRACE_JOB_BEGIN = 1,
+    TRACE_JOB_END = 2,
+    // work was posted. arg is the job_level_t
+    TRACE_WORK_POST = 3,
+    // a reading was published on the bus. arg is its sequence number
+    TRACE_BUS_PUBLISH = 4,
+    // a subscriber got a reading. arg is the bus_sub_t
+    TRACE_BUS_GET = 5,
+    // the acquisition engine queued a reading. arg is the queue depth
+    TRACE_ACQ_PUT = 6,
+    // talking to the HY3131 started or finished. arg is the first
+    // register, shifted left 8, plus how many. the top bit is set for
+    // writes.
+    TRACE_HY_BEGIN = 7,
+    TRACE_HY_END = 8,
+    // the modes changed. arg is the acq mode shifted left 8 plus the
+    // submode, or the meas mode
+    TRACE_ACQ_MODE = 9,
+    TRACE_MEAS_MODE = 10,
+    // the clock changed. arg is the clock_level_t
+    TRACE_CLOCK = 11,
+    // going to sleep, arg is the idle_state_t, and waking up again
+    TRACE_SLEEP = 12,
+    TRACE_WAKE = 13,
+    // for whatever you're chasing today
+    TRACE_MARK = 14,
+    // the continuity beeper turned on, arg is the us since the HY's interrupt
+    TRACE_BEEP = 15
+} trace_id_t;
+
+typedef struct {
+    uint32_t time_us;
+    uint16_t id;
+    uint16_t arg;
+} trace_entry_t;
+
+// start recording. the ring keeps the newest events, so it's fine to leave
+// it going until something interesting happens
+void trace_start(void);
+// stop recording so the ring can be looked at
+void trace_stop(void);
+// throw away everything recorded
+void trace_clear(void);
+bool trace_is_running(void);
+
+// record an event. safe from any job, even with interrupts disabled
+void trace_event(trace_id_t id, uint32_t arg);
+
+// how many events are in the ring, and how many fell off the end
+uint32_t trace_get_count(void);
+uint32_t trace_get_lost(void);
+
+// send the ring out with the dumper, oldest first. stops tracing first.
+// returns false if the dumper is busy with something else.
+bool trace_dump(dump_dest_t dest);
+
+#endif
@@ -80,9 +80,9 @@ void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_DMA_Init(void);
 static void MX_LCD_Init(void);
-static void MX_SDIO_SD_Init(void);
-static void MX_USART2_UART_Init(void);
-static void MX_ADC_Init(void);
+void MX_SDIO_SD_Init(void);
+void MX_USART2_UART_Init(void);
+void MX_ADC_Init(void);
 static void MX_RTC_Init(void);
 
 /* USER CODE BEGIN PFP */
@@ -138,10 +138,6 @@ int main(void)
   MX_GPIO_Init();
   MX_DMA_Init();
   MX_LCD_Init();
-  MX_SDIO_SD_Init();
-  MX_FATFS_Init();
-  MX_USART2_UART_Init();
-  MX_ADC_Init();
   MX_RTC_Init();
   /* USER CODE BEGIN 2 */
 
@@ -231,7 +227,7 @@ void SystemClock_Config(void)
 }
 
 /* ADC init function */
-static void MX_ADC_Init(void)
+void MX_ADC_Init(void)
 {
 
   ADC_ChannelConfTypeDef sConfig;
@@ -325,7 +321,7 @@ static void MX_RTC_Init(void)
 }
 
 /* SDIO init function */
-static void MX_SDIO_SD_Init(void)
+void MX_SDIO_SD_Init(void)
 {
 
   hsd.Instance = SDIO;
@@ -339,7 +335,7 @@ static void MX_SDIO_SD_Init(void)
 }
 
 /* USART2 init function */
-static void MX_USART2_UART_Init(void)
+void MX_USART2_UART_Init(void)
 {
 
   huart2.Instance = USART2;
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+#  Copyright 2018 Thomas Watson
+#
+#  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+# talk to the meter's command console (see 88mph/comms/console.h)
+# type commands, and the replies get printed. readings are hidden unless
+# -r is given. try "help" first.
+
+# usage: console.py [-r] PORT [BAUD]
+
+import sys
+import threading
+
+import serial
+
+from stream_decode import Decoder, decode_reading, \
+    FRAME_READING, FRAME_CONSOLE
+
+def main():
+    args = sys.argv[1:]
+    show_readings = "-r" in args
+    args = [a for a in args if a != "-r"]
+    if not args:
+        print("usage: console.py [-r] PORT [BAUD]", file=sys.stderr)
+        sys.exit(1)
+    port = serial.Serial(args[0], int(args[1]) if len(args) > 1 else 115200,
+        timeout=0.1)
+
+    def reader():
+        dec = Decoder()
+        while True:
+            for ftype, seq, payload in dec.feed(port.read(256)):
+                if ftype == FRAME_CONSOLE:
+                    print(payload.decode("ascii", "replace"))
+                elif ftype == FRAME_READING and show_readings:
+                    print("{},{:.6g},{},{},{}".format(
+                        *decode_reading(payload)))
+
+    threading.Thread(target=reader, daemon=True).start()
+
+    for line in sys.stdin:
+        port.write(line.strip().encode("ascii") + b"\n")
+
+if __name__ == "__main__":
+    main()
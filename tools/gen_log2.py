@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+#  Copyright 2018 Thomas Watson
+#
+#  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+
+# generate the constants behind fix_log2() (see 88mph/system/fixmath.c) and
+# the dB readings built on it (see 88mph/measurement/decibel.c). fix_log2
+# takes the whole part from the top bit and interpolates the fraction in a
+# table of log2(1+i/64). decibel.c multiplies that by 20*log10(2).
+
+# usage: gen_log2.py [--check]
+# rewrites log2_table in fixmath.c and DB_PER_LOG2 in decibel.c. --check
+# makes sure the files have what this would write, then runs the firmware's
+# integer math over a sweep of values and compares it to libm. it fails if
+# fix_log2 is off by more than TOLERANCE_LOG_LSB or a dB reading is off by
+# more than TOLERANCE_DB.
+
+import math
+import os
+import re
+import sys
+
+# same as FIX_LOG_FRAC
+FRAC = 16
+# the table has (1<<TABLE_BITS)+1 entries, so interpolating the last one
+# has an entry to go to
+TABLE_BITS = 6
+ENTRIES = (1 << TABLE_BITS) + 1
+
+# fixmath.h promises 4 LSBs, and decibel.h about 0.001dB
+TOLERANCE_LOG_LSB = 4
+TOLERANCE_DB = 0.001
+
+# the dBm reference impedances worth checking. 600 is the default
+REF_OHMS = [1, 4, 8, 50, 75, 600, 1000, 10000]
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SRC_DIR = os.path.join(HERE, "..", "EEVBlog", "88mph")
+FIXMATH_C = os.path.join(SRC_DIR, "system", "fixmath.c")
+DECIBEL_C = os.path.join(SRC_DIR, "measurement", "decibel.c")
+
+TABLE_RE = re.compile(
+    r"(static const uint32_t log2_table\[\d+\] = \{\n)(.*?)(\n\};)", re.S)
+DB_RE = re.compile(r"(#define DB_PER_LOG2 \()(\d+)(\))")
+
+def make_table():
+    return [round(math.log2(1 + i/(1 << TABLE_BITS)) * (1 << FRAC))
+        for i in range(ENTRIES)]
+
+def make_db_per_log2():
+    return round(20*math.log10(2) * (1 << FRAC))
+
+def format_table(table):
+    rows = []
+    for i in range(0, len(table), 8):
+        rows.append("    " + ", ".join(str(t) for t in table[i:i+8]))
+    return ",\n".join(rows)
+
+# the same integer math as fix_log2()
+def fix_log2(table, v):
+    whole = v.bit_length() - 1
+    if whole >= 30:
+        m = v >> (whole-30)
+    else:
+        m = v << (30-whole)
+    i = (m >> 24) & 63
+    frac = (m >> 8) & 0xFFFF
+    l0 = table[i]
+    l = l0 + (((table[i+1]-l0)*frac + 0x8000) >> 16)
+    return (whole << FRAC) + l
+
+# and the same as log_db() and db_from_reading() in decibel.c. p is the
+# power of 10 a millicount is worth
+def log_db(table, db_per_log2, v):
+    return (fix_log2(table, v)*db_per_log2) >> FRAC
+
+def db_millicounts(table, db_per_log2, mc, p, ohms):
+    level = log_db(table, db_per_log2, mc) + ((20*p) << FRAC)
+    if ohms is not None:
+        level += (30 << FRAC) - log_db(table, db_per_log2, ohms)//2
+    return (level*100000 + (1 << (FRAC-1))) >> FRAC
+
+def log2_values():
+    # every small value, where the fraction comes from shifting up
+    yield from range(1, 1 << 16)
+    # and a spread of mantissas at every whole part above that, including
+    # the table points and the values right around them
+    for whole in range(16, 64):
+        base = 1 << whole
+        for k in range(0, 1 << 12):
+            yield base + ((k*base) >> 12)
+            yield base + ((k*base) >> 12) + ((2654435761*k) % base)
+        yield (base << 1) - 1
+
+def mc_values():
+    # the volts modes show up to 50000 counts, so millicounts go to 5e7
+    yield from range(1, 1 << 16)
+    v = 1 << 16
+    while v < 50000000:
+        yield v
+        v += v//4096 + 7
+
+def check(table, db_per_log2):
+    worst_log = 0
+    for v in log2_values():
+        err = abs(fix_log2(table, v) - math.log2(v)*(1 << FRAC))
+        worst_log = max(worst_log, err)
+    worst_dbv = worst_dbm = 0
+    # the 10^p part is exact, so one p is enough to check the log
+    p = -7
+    for mc in mc_values():
+        dbv = 20*math.log10(mc) + 20*p
+        got = db_millicounts(table, db_per_log2, mc, p, None)/100000
+        worst_dbv = max(worst_dbv, abs(got - dbv))
+    for ohms in REF_OHMS:
+        for mc in range(1, 50000000, 9973):
+            dbm = 20*math.log10(mc) + 20*p + 30 - 10*math.log10(ohms)
+            got = db_millicounts(table, db_per_log2, mc, p, ohms)/100000
+            worst_dbm = max(worst_dbm, abs(got - dbm))
+    print("worst fix_log2 error: {:.2f} LSB".format(worst_log))
+    print("worst dBV error: {:.5f} dB".format(worst_dbv))
+    print("worst dBm error: {:.5f} dB".format(worst_dbm))
+    return worst_log <= TOLERANCE_LOG_LSB and \
+        worst_dbv <= TOLERANCE_DB and worst_dbm <= TOLERANCE_DB
+
+def read(path):
+    with open(path) as f:
+        return f.read()
+
+def write(path, text):
+    with open(path, "w") as f:
+        f.write(text)
+
+def check_files(table, db_per_log2):
+    good = True
+    m = TABLE_RE.search(read(FIXMATH_C))
+    if m is None or m.group(2) != format_table(table):
+        print("fixmath.c: log2_table doesn't match")
+        good = False
+    m = DB_RE.search(read(DECIBEL_C))
+    if m is None or int(m.group(2)) != db_per_log2:
+        print("decibel.c: DB_PER_LOG2 should be {}".format(db_per_log2))
+        good = False
+    return good
+
+def write_files(table, db_per_log2):
+    text, n = TABLE_RE.subn(
+        lambda m: m.group(1) + format_table(table) + m.group(3),
+        read(FIXMATH_C))
+    if n != 1:
+        sys.exit("can't find log2_table in fixmath.c")
+    write(FIXMATH_C, text)
+    text, n = DB_RE.subn(
+        lambda m: m.group(1) + str(db_per_log2) + m.group(3),
+        read(DECIBEL_C))
+    if n != 1:
+        sys.exit("can't find DB_PER_LOG2 in decibel.c")
+    write(DECIBEL_C, text)
+
+def main():
+    args = sys.argv[1:]
+    if args not in ([], ["--check"]):
+        print("usage: gen_log2.py [--check]", file=sys.stderr)
+        sys.exit(2)
+    table = make_table()
+    db_per_log2 = make_db_per_log2()
+    if args:
+        files_good = check_files(table, db_per_log2)
+        math_good = check(table, db_per_log2)
+        sys.exit(0 if files_good and math_good else 1)
+    write_files(table, db_per_log2)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+#  Copyright 2018 Thomas Watson
+#
+#  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+
+# generate the type K thermocouple table (see 88mph/acquisition/thermocouple.h)
+# the table is the temperature at evenly spaced EMFs, so the firmware finds
+# its spot with a shift and interpolates between two entries. the EMFs come
+# from the NIST ITS-90 reference function, inverted here with bisection.
+
+# usage: gen_typek.py [--check]
+# writes typek_table.h and typek_table.c into 88mph/acquisition. --check
+# runs the firmware's integer math over every microvolt in the table and
+# compares it to the reference function and to NIST's own inverse
+# polynomials, and fails if it's off by more than TOLERANCE_MDEGC.
+
+import math
+import os
+import sys
+
+# NIST ITS-90 type K reference function, temperature in C to EMF in mV
+# -270C to 0C
+COEF_NEG = [
+    0.000000000000E+00, 0.394501280250E-01, 0.236223735980E-04,
+    -0.328589067840E-06, -0.499048287770E-08, -0.675090591730E-10,
+    -0.574103274280E-12, -0.310888728940E-14, -0.104516093650E-16,
+    -0.198892668780E-19, -0.163226974860E-22,
+]
+# 0C to 1372C, plus the exponential term
+COEF_POS = [
+    -0.176004136860E-01, 0.389212049750E-01, 0.185587700320E-04,
+    -0.994575928740E-07, 0.318409457190E-09, -0.560728448890E-12,
+    0.560750590590E-15, -0.320207200030E-18, 0.971511471520E-22,
+    -0.121047212750E-25,
+]
+EXP_A = (0.118597600000E+00, -0.118343200000E-03, 0.126968600000E+03)
+
+# NIST's inverse polynomials, EMF in mV to temperature in C, with the EMF
+# range each one covers. they're only good to about 0.05C themselves
+INVERSE = [
+    (-5.891, 0.0, [
+        0.0, 2.5173462E+01, -1.1662878E+00, -1.0833638E+00,
+        -8.9773540E-01, -3.7342377E-01, -8.6632643E-02, -1.0450598E-02,
+        -5.1920577E-04]),
+    (0.0, 20.644, [
+        0.0, 2.508355E+01, 7.860106E-02, -2.503131E-01, 8.315270E-02,
+        -1.228034E-02, 9.804036E-04, -4.413030E-05, 1.057734E-06,
+        -1.052755E-08]),
+    (20.644, 54.886, [
+        -1.318058E+02, 4.830222E+01, -1.646031E+00, 5.464731E-02,
+        -9.650715E-04, 8.802193E-06, -3.110810E-08]),
+]
+
+# the table covers -200C to 1372C, which is what NIST's tables cover
+MIN_UV = -5888
+MAX_UV = 54886
+# 64uV between entries keeps linear interpolation within 0.025C even down
+# at -200C where the curve bends the most
+SHIFT = 6
+ENTRIES = ((MAX_UV - MIN_UV) >> SHIFT) + 2
+
+TOLERANCE_MDEGC = 50
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+OUT_DIR = os.path.join(HERE, "..", "EEVBlog", "88mph", "acquisition")
+
+def emf_uv(t):
+    if t < 0:
+        e = sum(c*t**i for i, c in enumerate(COEF_NEG))
+    else:
+        e = sum(c*t**i for i, c in enumerate(COEF_POS))
+        e += EXP_A[0]*math.exp(EXP_A[1]*(t-EXP_A[2])**2)
+    return e*1000
+
+def temp_c(uv):
+    # the last entry is a bit past 1372C, so let the bisection go further
+    lo, hi = -270.0, 1500.0
+    for _ in range(64):
+        mid = (lo+hi)/2
+        if emf_uv(mid) < uv:
+            lo = mid
+        else:
+            hi = mid
+    return (lo+hi)/2
+
+def nist_inverse_c(uv):
+    mv = uv/1000
+    for lo, hi, coefs in INVERSE:
+        if lo <= mv <= hi:
+            return sum(c*mv**i for i, c in enumerate(coefs))
+    return None
+
+def make_table():
+    return [round(temp_c(MIN_UV + (i << SHIFT))*1000) for i in range(ENTRIES)]
+
+# the same integer math as tc_uv_to_mdegc() and tc_mdegc_to_uv()
+def uv_to_mdegc(table, uv):
+    if uv <= MIN_UV:
+        return table[0]
+    if uv >= MAX_UV:
+        uv = MAX_UV
+    off = uv - MIN_UV
+    i = off >> SHIFT
+    frac = off & ((1 << SHIFT)-1)
+    return table[i] + (((table[i+1]-table[i])*frac) >> SHIFT)
+
+def mdegc_to_uv(table, mdegc):
+    if mdegc <= table[0]:
+        return MIN_UV
+    lo, hi = 0, ENTRIES-1
+    while hi - lo > 1:
+        mid = (lo+hi)//2
+        if table[mid] <= mdegc:
+            lo = mid
+        else:
+            hi = mid
+    span = table[hi] - table[lo]
+    frac = min(mdegc - table[lo], span)
+    return MIN_UV + (lo << SHIFT) + (frac << SHIFT)//span
+
+def check(table):
+    worst_ref = worst_nist = 0
+    for uv in range(MIN_UV, MAX_UV+1):
+        t = uv_to_mdegc(table, uv)
+        worst_ref = max(worst_ref, abs(t - temp_c(uv)*1000))
+        nist = nist_inverse_c(uv)
+        if nist is not None:
+            worst_nist = max(worst_nist, abs(t - nist*1000))
+    worst_cj = 0
+    for mdegc in range(-40000, 125001, 100):
+        uv = mdegc_to_uv(table, mdegc)
+        worst_cj = max(worst_cj, abs(uv - emf_uv(mdegc/1000)))
+    print("worst error against the reference function: {:.0f} mC".format(
+        worst_ref))
+    print("worst difference from the NIST inverse: {:.0f} mC".format(
+        worst_nist))
+    print("worst cold junction error: {:.1f} uV".format(worst_cj))
+    # the inverse polynomials are only good to 0.05C, so allow for that too
+    return worst_ref <= TOLERANCE_MDEGC and \
+        worst_nist <= TOLERANCE_MDEGC + 50 and worst_cj <= 2
+
+HEADER = """\
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// generated by tools/gen_typek.py, don't edit!
+"""
+
+def write_files(table):
+    with open(os.path.join(OUT_DIR, "typek_table.h"), "w") as f:
+        f.write(HEADER)
+        f.write("\n#ifndef ACQUISITION_TYPEK_TABLE_H\n")
+        f.write("#define ACQUISITION_TYPEK_TABLE_H\n\n")
+        f.write("#include <stdint.h>\n\n")
+        f.write("// type K temperature in thousandths of a degree C at every\n")
+        f.write("// (1<<TC_TYPEK_SHIFT) microvolts from TC_TYPEK_MIN_UV\n")
+        f.write("#define TC_TYPEK_MIN_UV ({})\n".format(MIN_UV))
+        f.write("#define TC_TYPEK_MAX_UV ({})\n".format(MAX_UV))
+        f.write("#define TC_TYPEK_SHIFT ({})\n".format(SHIFT))
+        f.write("#define TC_TYPEK_ENTRIES ({})\n\n".format(ENTRIES))
+        f.write("extern const int32_t tc_typek_mdegc[TC_TYPEK_ENTRIES];\n\n")
+        f.write("#endif")
+    with open(os.path.join(OUT_DIR, "typek_table.c"), "w") as f:
+        f.write(HEADER)
+        f.write("\n#include <stdint.h>\n\n")
+        f.write('#include "acquisition/typek_table.h"\n\n')
+        f.write("const int32_t tc_typek_mdegc[TC_TYPEK_ENTRIES] = {\n")
+        for i in range(0, len(table), 8):
+            row = ", ".join(str(t) for t in table[i:i+8])
+            f.write("    {},\n".format(row))
+        f.write("};")
+
+def main():
+    args = sys.argv[1:]
+    if args not in ([], ["--check"]):
+        print("usage: gen_typek.py [--check]", file=sys.stderr)
+        sys.exit(2)
+    table = make_table()
+    if args:
+        sys.exit(0 if check(table) else 1)
+    write_files(table)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+#  Copyright 2018 Thomas Watson
+#
+#  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+
+# build and run the firmware's host tests
+# each test_*.c in this directory is a program that links against some of
+# the firmware's .c files, listed on a "// sources:" line near the top, and
+# exits with 0 if everything passed. they're built with the host's gcc, with
+# stubs/ in front of the include path so the bits that touch the Cortex-M3
+# core (turning interrupts on and off) compile to nothing. a "// cflags:"
+# line adds flags of its own, like the ones that turn on the peripheral
+# register stubs.
+
+# usage: run.py [TEST...]
+# TEST is a test's name without test_ or .c, like autohold. with no TEST,
+# everything is run. tests run in this directory, so they can find traces/.
+
+import glob
+import os
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FIRMWARE = os.path.join(HERE, "..", "..", "EEVBlog", "88mph")
+
+CFLAGS = ["-std=gnu11", "-O2", "-g", "-Wall", "-Wno-unused-function",
+    "-DHOST_TEST", "-I" + os.path.join(HERE, "stubs"), "-I" + FIRMWARE]
+
+def line_of(path, tag):
+    with open(path) as f:
+        for line in f:
+            if line.startswith("// {}:".format(tag)):
+                return line.split(":", 1)[1].split()
+    return []
+
+def sources_of(path):
+    return [os.path.join(FIRMWARE, s) for s in line_of(path, "sources")]
+
+def run_test(name, build_dir):
+    src = os.path.join(HERE, "test_{}.c".format(name))
+    exe = os.path.join(build_dir, name)
+    cmd = ["gcc"] + CFLAGS + line_of(src, "cflags") + ["-o", exe, src] + \
+        sources_of(src) + ["-lm"]
+    if subprocess.run(cmd).returncode != 0:
+        print("{}: didn't build".format(name))
+        return False
+    ok = subprocess.run([exe], cwd=HERE).returncode == 0
+    print("{}: {}".format(name, "passed" if ok else "FAILED"))
+    return ok
+
+def main():
+    names = sys.argv[1:]
+    if not names:
+        names = sorted(os.path.basename(p)[5:-2]
+            for p in glob.glob(os.path.join(HERE, "test_*.c")))
+    with tempfile.TemporaryDirectory() as build_dir:
+        results = [run_test(name, build_dir) for name in names]
+    sys.exit(0 if all(results) else 1)
+
+if __name__ == "__main__":
+    main()
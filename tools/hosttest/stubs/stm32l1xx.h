@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// stand in for the device header when building the host tests
+// there's only one thread on the host, so turning interrupts off is nothing
+
+#ifndef HOSTTEST_STM32L1XX_H
+#define HOSTTEST_STM32L1XX_H
+
+#include <stdint.h>
+
+#define __disable_irq()
+#define __enable_irq()
+#define NVIC_EnableIRQ(irq)
+#define NVIC_DisableIRQ(irq)
+#define NVIC_ClearPendingIRQ(irq)
+
+// the interrupts system/job.h names its jobs after
+typedef enum {
+    EXTI3_IRQn = 9,
+    USB_HP_IRQn = 19,
+    USB_LP_IRQn = 20,
+    TIM6_IRQn = 43,
+    SPI3_IRQn = 47,
+    UART4_IRQn = 48,
+    UART5_IRQn = 49,
+    // and the ones comms/uart.c uses
+    DMA1_Channel6_IRQn = 16,
+    DMA1_Channel7_IRQn = 17,
+    USART2_IRQn = 38
+} IRQn_Type;
+
+// the peripherals are plain memory. a test that uses one builds with
+// -DHOSTTEST_PERIPHERALS, defines the hosttest_ variable behind it and pokes
+// at the registers itself. they're kept out of the other tests since names
+// like CR1 clash with the host's termios.h
+#ifdef HOSTTEST_PERIPHERALS
+typedef struct {
+    volatile uint32_t SR, DR, BRR, CR1, CR2, CR3, GTPR;
+} USART_TypeDef;
+
+typedef struct {
+    volatile uint32_t CCR, CNDTR, CPAR, CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+    volatile uint32_t ISR, IFCR;
+} DMA_TypeDef;
+
+extern USART_TypeDef hosttest_usart2;
+extern DMA_Channel_TypeDef hosttest_dma1_channel6;
+extern DMA_Channel_TypeDef hosttest_dma1_channel7;
+extern DMA_TypeDef hosttest_dma1;
+#define USART2 (&hosttest_usart2)
+#define DMA1_Channel6 (&hosttest_dma1_channel6)
+#define DMA1_Channel7 (&hosttest_dma1_channel7)
+#define DMA1 (&hosttest_dma1)
+
+#define USART_SR_IDLE (0x10U)
+#define USART_SR_TC (0x40U)
+#define USART_SR_TXE (0x80U)
+#define USART_CR1_IDLEIE (0x10U)
+#define USART_CR1_TCIE (0x40U)
+#define USART_CR1_UE (0x2000U)
+#define USART_CR1_OVER8 (0x8000U)
+#define USART_CR3_DMAR (0x40U)
+#define USART_CR3_DMAT (0x80U)
+
+#define DMA_CCR_EN (0x1U)
+#define DMA_CCR_TCIE (0x2U)
+#define DMA_CCR_HTIE (0x4U)
+#define DMA_CCR_DIR (0x10U)
+#define DMA_CCR_CIRC (0x20U)
+#define DMA_CCR_MINC (0x80U)
+#define DMA_IFCR_CGIF6 (0x100000U)
+#define DMA_IFCR_CGIF7 (0x1000000U)
+
+// the bits of the HAL that are used
+#define __HAL_RCC_DMA1_CLK_ENABLE()
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// sources: acquisition/acq_mode_ac.c measurement/meas_mode_ac.c system/fixmath.c
+
+// runs synthetic waveforms through the RMS path, from the HY's mean square
+// register through the acquisition and measurement modes, and checks the
+// displayed RMS against the exact root of the averaged, calibrated register
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "acquisition/acq_mode_ac.h"
+#include "measurement/meas_mode_ac.h"
+
+#include "acquisition/acquisition.h"
+#include "measurement/measurement.h"
+#include "hardware/hy3131.h"
+#include "system/timer.h"
+
+// samples the HY averages into each mean square
+#define SAMPLES (500)
+// the biggest the 40 bit register can hold
+#define MS_MAX ((1LL << 40)-1)
+
+static int failures = 0;
+
+volatile uint32_t timer_1ms_ticks = 0;
+
+// what the modes tell the rest of the firmware
+static reading_t acq_out;
+static int acq_outs = 0;
+static reading_t meas_out;
+static int meas_outs = 0;
+static uint8_t filter = 1;
+
+void acq_put_reading(reading_t* reading) {
+    acq_out = *reading;
+    acq_outs++;
+}
+
+void meas_put_reading(reading_t* reading) {
+    meas_out = *reading;
+    meas_outs++;
+}
+
+void acq_clear_readings(void) {
+}
+
+void acq_set_int_mask(uint8_t mask) {
+}
+
+uint32_t acq_get_irq_time_us(void) {
+    return 0;
+}
+
+void acq_set_mode(acq_mode_t mode, acq_submode_t submode) {
+}
+
+void acq_set_submode(acq_submode_t submode) {
+}
+
+void hy_write_regs(uint8_t start, uint8_t count, const uint8_t* data) {
+}
+
+uint8_t meas_get_filter(void) {
+    return filter;
+}
+
+uint8_t meas_get_range(void) {
+    return 0;
+}
+
+// one RMS interrupt's worth of a waveform, as the HY would square and average
+// it. also adds the calibrated mean square to *true_ms
+typedef double (*wave_t)(double phase);
+
+static double wave_sine(double phase) {
+    return sin(2*M_PI*phase);
+}
+
+static double wave_square(double phase) {
+    return (phase < 0.5) ? 1 : -1;
+}
+
+static double wave_triangle(double phase) {
+    return (phase < 0.5) ? 4*phase-1 : 3-4*phase;
+}
+
+// a sine riding on half its amplitude of dc
+static double wave_offset(double phase) {
+    return 0.5 + sin(2*M_PI*phase);
+}
+
+static int64_t hy_mean_square(wave_t wave, double amplitude, double cycles,
+        double* true_ms) {
+    int64_t sum = 0;
+    for (int si=0; si<SAMPLES; si++) {
+        double phase = fmod(cycles*si/SAMPLES, 1);
+        int64_t x = (int64_t)lrint(amplitude*wave(phase));
+        sum += x*x;
+    }
+    // the register doesn't have any fraction, so that's lost before the
+    // firmware ever sees it. calibrate like DC, squared
+    int64_t ms = sum/SAMPLES;
+    *true_ms += ms*(100.0/6)*(100.0/6);
+    return ms;
+}
+
+// run intervals mean squares through volts ac and check what comes out
+static void check(const char* name, wave_t wave, double amplitude,
+        double step) {
+    for (int fi=1; fi<=64; fi*=4) {
+        filter = (uint8_t)fi;
+        meas_mode_func_volts_ac(MEAS_EVENT_START, NULL);
+        acq_mode_func_volts_ac(ACQ_EVENT_START, 0);
+        meas_outs = 0;
+        double true_ms = 0;
+        for (int ai=0; ai<filter; ai++) {
+            // the amplitude can change between intervals
+            double a = amplitude*(1 + step*ai);
+            int64_t ms = hy_mean_square(wave, a, 7.3, &true_ms);
+            acq_outs = 0;
+            acq_mode_func_volts_ac(ACQ_EVENT_NEW_RMS, ms);
+            if (acq_outs != 1 || acq_out.millicounts != 0) {
+                printf("%s: acquisition didn't hand over a mean square\n",
+                    name);
+                failures++;
+                return;
+            }
+            meas_mode_func_volts_ac(MEAS_EVENT_NEW_ACQ, &acq_out);
+        }
+        if (meas_outs != 1) {
+            printf("%s: filter %d gave %d readings\n",
+                name, filter, meas_outs);
+            failures++;
+            continue;
+        }
+        double want = sqrt(true_ms/filter);
+        double err = meas_out.millicounts - want;
+        // the roots and divides all floor, and the calibration is off
+        // by a hair, so allow a couple millicounts plus a few ppm
+        if (fabs(err) > 2 + want*5e-6) {
+            printf("%s: amplitude %.0f filter %d: got %d, wanted %.1f\n",
+                name, amplitude, filter, meas_out.millicounts, want);
+            failures++;
+        }
+    }
+}
+
+int main(void) {
+    // from a few counts up to what fills the 40 bit register
+    double amplitudes[] = {7, 600, 60000, 1000000};
+    for (int ai=0; ai<4; ai++) {
+        double a = amplitudes[ai];
+        check("sine", wave_sine, a, 0);
+        check("square", wave_square, a, 0);
+        check("triangle", wave_triangle, a, 0);
+        check("offset", wave_offset, a/2, 0);
+        // a growing sine, where averaging the roots would be wrong
+        check("ramp", wave_sine, a/4, 0.05);
+    }
+
+    // the biggest mean square, through the longest filter
+    filter = 255;
+    meas_mode_func_volts_ac(MEAS_EVENT_START, NULL);
+    meas_outs = 0;
+    for (int ai=0; ai<filter; ai++) {
+        acq_mode_func_volts_ac(ACQ_EVENT_NEW_RMS, MS_MAX);
+        meas_mode_func_volts_ac(MEAS_EVENT_NEW_ACQ, &acq_out);
+    }
+    double want = sqrt((double)MS_MAX)*100/6;
+    if (meas_outs != 1 || fabs(meas_out.millicounts - want) > 2) {
+        printf("max: got %d, wanted %.1f\n", meas_out.millicounts, want);
+        failures++;
+    }
+
+    // dual mode puts the ac on the sub screen through the same path
+    filter = 1;
+    meas_mode_func_volts_dual(MEAS_EVENT_START, NULL);
+    acq_mode_func_volts_dual(ACQ_EVENT_START, 0);
+    meas_outs = 0;
+    double true_ms = 0;
+    acq_mode_func_volts_dual(ACQ_EVENT_NEW_RMS,
+        hy_mean_square(wave_sine, 60000, 3, &true_ms));
+    meas_mode_func_volts_dual(MEAS_EVENT_NEW_ACQ, &acq_out);
+    want = sqrt(true_ms);
+    if (meas_outs != 1 || meas_out.kind != RDG_KIND_SUB ||
+            fabs(meas_out.millicounts - want) > 2) {
+        printf("dual: got %d, wanted %.1f\n", meas_out.millicounts, want);
+        failures++;
+    }
+
+    if (failures) {
+        printf("%d failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// sources: measurement/autohold.c
+
+// checks the auto hold detector against a plain one that looks at the whole
+// window every time, on made up sequences and on logger traces in traces/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "measurement/autohold.h"
+
+#include "system/job.h"
+
+static int failures = 0;
+
+void job_schedule(job_t job) {
+}
+
+// the slow but obvious version
+typedef struct {
+    int32_t values[AUTOHOLD_MAX_WINDOW];
+    uint32_t count;
+    uint8_t window;
+    int32_t band;
+    bool settled;
+    uint32_t locks;
+    int32_t held;
+} ref_t;
+
+static void ref_init(ref_t* r, uint8_t window, int32_t band) {
+    memset(r, 0, sizeof(*r));
+    r->window = window;
+    r->band = band;
+}
+
+static void ref_put(ref_t* r, int32_t v) {
+    r->values[r->count % r->window] = v;
+    r->count++;
+    if (r->count < r->window) {
+        return;
+    }
+    int32_t max = INT32_MIN, min = INT32_MAX;
+    int64_t sum = 0;
+    for (int i=0; i<r->window; i++) {
+        int32_t x = r->values[i];
+        max = (x > max) ? x : max;
+        min = (x < min) ? x : min;
+        sum += x;
+    }
+    int32_t avg = (int32_t)(sum/r->window);
+    if (!r->settled && max-min <= r->band) {
+        if (avg >= AUTOHOLD_MIN_MILLICOUNTS ||
+                avg <= -AUTOHOLD_MIN_MILLICOUNTS) {
+            r->settled = true;
+            r->locks++;
+            r->held = avg;
+        }
+    } else if (r->settled && max-min > 2*r->band) {
+        r->settled = false;
+    }
+}
+
+// run both over the same values and complain the first time they disagree
+// returns how many times it locked
+static uint32_t compare(const char* what, const int32_t* values, int n,
+        uint8_t window, int32_t band) {
+    ref_t ref;
+    ref_init(&ref, window, band);
+    autohold_enable(false);
+    autohold_configure(window, band);
+    autohold_enable(true);
+    uint32_t start_locks;
+    reading_t held;
+    autohold_get_held(&held, &start_locks);
+    for (int i=0; i<n; i++) {
+        reading_t r = {values[i], (uint32_t)i, 0, RDG_UNIT_VOLTS,
+            RDG_EXPONENT_NONE, RDG_DECIMAL_1d0000, RDG_KIND_MAIN};
+        autohold_put(&r);
+        ref_put(&ref, values[i]);
+        uint32_t locks;
+        bool have = autohold_get_held(&held, &locks);
+        if (locks-start_locks != ref.locks ||
+                (have && ref.locks && held.millicounts != ref.held)) {
+            printf("%s window %d: reading %d: %u locks holding %d, "
+                "should be %u holding %d\n", what, window, i,
+                locks-start_locks, held.millicounts, ref.locks, ref.held);
+            failures++;
+            return ref.locks;
+        }
+    }
+    return ref.locks;
+}
+
+// a signal that never stops moving must never be held
+static void test_ramp(void) {
+    static int32_t ramp[200];
+    for (int i=0; i<200; i++) {
+        ramp[i] = 100000000 - i*1000000;
+    }
+    for (int w=2; w<=AUTOHOLD_MAX_WINDOW; w++) {
+        if (compare("ramp", ramp, 200, (uint8_t)w, 10000) != 0) {
+            printf("the reference held a ramp?\n");
+            failures++;
+        }
+    }
+}
+
+// noise around steps, which settles and unsettles over and over
+static void test_random(void) {
+    static int32_t values[5000];
+    srand(88);
+    int32_t level = 0;
+    for (int i=0; i<5000; i++) {
+        if (i % 97 == 0) {
+            level = (rand() % 4000001) - 2000000;
+        }
+        values[i] = level + (rand() % 20001) - 10000;
+    }
+    for (int w=2; w<=AUTOHOLD_MAX_WINDOW; w++) {
+        compare("random", values, 5000, (uint8_t)w, 15000);
+    }
+}
+
+// logger CSVs, where the readings are the fourth column. a line starting
+// with "# locks N" says how many times the default settings should lock
+static void test_trace(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("%s: can't open\n", path);
+        failures++;
+        return;
+    }
+    static int32_t values[100000];
+    int n = 0;
+    long expect = -1;
+    char line[256];
+    while (fgets(line, sizeof(line), f) && n < 100000) {
+        if (!strncmp(line, "# locks ", 8)) {
+            expect = strtol(line+8, NULL, 10);
+            continue;
+        }
+        if (line[0] < '0' || line[0] > '9') {
+            continue;
+        }
+        char* col = line;
+        for (int c=0; c<3 && col; c++) {
+            col = strchr(col, ',');
+            col = col ? col+1 : NULL;
+        }
+        if (col) {
+            values[n++] = (int32_t)strtol(col, NULL, 10);
+        }
+    }
+    fclose(f);
+
+    uint32_t locks = compare(path, values, n,
+        AUTOHOLD_DEFAULT_WINDOW, AUTOHOLD_DEFAULT_BAND);
+    for (int w=2; w<=AUTOHOLD_MAX_WINDOW; w++) {
+        compare(path, values, n, (uint8_t)w, AUTOHOLD_DEFAULT_BAND);
+    }
+    if (expect >= 0 && locks != (uint32_t)expect) {
+        printf("%s: locked %u times, should be %ld\n", path, locks, expect);
+        failures++;
+    }
+}
+
+int main(void) {
+    test_ramp();
+    test_random();
+
+    DIR* d = opendir("traces");
+    struct dirent* e;
+    while (d && (e = readdir(d))) {
+        size_t len = strlen(e->d_name);
+        if (!strncmp(e->d_name, "autohold_", 9) && len > 4 &&
+                !strcmp(e->d_name+len-4, ".csv")) {
+            char path[300];
+            snprintf(path, sizeof(path), "traces/%s", e->d_name);
+            test_trace(path);
+        }
+    }
+    if (d) {
+        closedir(d);
+    }
+
+    return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,270 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// sources: acquisition/acq_mode_cap.c acquisition/acq_mode_freq.c
+// cflags: -no-pie -Wno-int-to-pointer-cast
+
+// plays the HY's counter to the capacitance mode for made up capacitors,
+// and checks that it settles on a sensible charge current, how long the
+// range stepping takes, and that the cycle time turns into the right
+// number of farads. the mode passes the counter around as a 32 bit
+// pointer, so this is linked without PIE to keep that pointer low.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "acquisition/acq_mode_cap.h"
+
+#include "acquisition/acq_mode_freq.h"
+#include "acquisition/acquisition.h"
+#include "acquisition/reading.h"
+#include "hardware/hy3131.h"
+#include "system/timer.h"
+
+// the HY hands over the counter this often. its real gate hasn't been
+// captured either, so this is just a plausible one
+#define HY_GATE_MS (20)
+
+static int failures = 0;
+
+volatile uint32_t timer_1ms_ticks = 0;
+
+// the simulated time, in seconds
+static double now = 0;
+// the charge current the HY is set to, and when its counter started
+static const uint8_t* range0_regs = NULL;
+static int range = 0;
+static double count_start = 0;
+
+// what the mode tells the rest of the firmware
+static reading_t out;
+static int outs = 0;
+static int out_range = 0;
+
+void acq_put_reading(reading_t* reading) {
+    out = *reading;
+    outs++;
+    out_range = range;
+}
+
+void acq_clear_readings(void) {
+}
+
+void acq_set_int_mask(uint8_t mask) {
+}
+
+uint32_t acq_get_irq_time_us(void) {
+    return 0;
+}
+
+void hy_write_regs(uint8_t start, uint8_t count, const uint8_t* data) {
+    // until they're captured, every current has the same registers, so
+    // tell them apart by where they are in the table. the mode starts out
+    // on the smallest current, which is the first thing it writes
+    if (range0_regs == NULL) {
+        range0_regs = data;
+    }
+    range = (int)(data - range0_regs)/20;
+    // and writing them restarts the counter
+    count_start = now;
+}
+
+// the nominal currents, in picofarads per second of cycle time
+static double pf_per_s(int r) {
+    return 1e6*pow(10, r);
+}
+
+static double cycle_s(double pf) {
+    return pf/pf_per_s(range);
+}
+
+// one HY gate of a capacitor that takes cycle_s() to charge and discharge
+static void gate(double pf) {
+    static acq_ct_t ct;
+    double period = cycle_s(pf);
+    double t0 = now;
+    now += HY_GATE_MS/1000.0;
+    timer_1ms_ticks = (uint32_t)lround(now*1000);
+    // the whole cycles that finished during the gate, and the reference
+    // clock during them
+    double c0 = floor((t0-count_start)/period + 1e-9);
+    double c1 = floor((now-count_start)/period + 1e-9);
+    ct.cta = (uint32_t)(c1-c0);
+    ct.ctb = (uint32_t)llround(ct.cta*period*FREQ_REF_HZ);
+    ct.ctc = 0;
+    acq_mode_func_cap(ACQ_EVENT_NEW_CT, (int64_t)(uintptr_t)&ct);
+}
+
+// run gates until the mode has put out a reading from the range it
+// settles in, or max_ms go by. returns how long that took in ms, or -1
+static double settle(double pf, double max_ms) {
+    double start = now;
+    int prev_range = -1;
+    while ((now-start)*1000 < max_ms) {
+        outs = 0;
+        gate(pf);
+        if (outs == 0) {
+            continue;
+        }
+        // a reading that didn't move the range is from the one it stays in
+        if (out_range == range && out_range == prev_range) {
+            return (now-start)*1000;
+        }
+        prev_range = out_range;
+    }
+    return -1;
+}
+
+// check the reading against the capacitor. one count on the display is
+// 10^(3*exponent+decimal-1) pF, since the exponents start at nano and are
+// 1000x apart, and each decimal place is 10x
+static void check_reading(const char* name, double pf) {
+    double count_pf = pow(10, 3*(int)out.exponent + (int)out.decimal - 1);
+    double counts = out.millicounts/1000.0;
+    double got = counts*count_pf;
+    if (out.unit != RDG_UNIT_FARADS) {
+        printf("%s: reading isn't in farads\n", name);
+        failures++;
+    }
+    // counting whole reference cycles is good to a few ppm, plus the count
+    // that's cut off
+    if (fabs(got-pf) > count_pf + pf*1e-5) {
+        printf("%s: got %.6gpF, wanted %.6gpF\n", name, got, pf);
+        failures++;
+    }
+    // the finest format that fits has 5 whole digits, unless the value is
+    // too small for even the first one
+    bool first = (out.exponent == RDG_EXPONENT_NANO &&
+        out.decimal == RDG_DECIMAL_10d000);
+    if (counts >= 100000 || (counts < 10000 && !first)) {
+        printf("%s: %.3f counts isn't the finest format\n", name, counts);
+        failures++;
+    }
+}
+
+// the range it settled in should have a cycle between the limits, unless
+// there isn't a current that gets it there
+static void check_range(const char* name, double pf) {
+    double period = cycle_s(pf);
+    bool too_short = period < CAP_RANGE_DOWN_US/1e6 && range > 0;
+    bool too_long = period > CAP_RANGE_UP_MS/1e3 && range < CAP_NUM_RANGES-1;
+    if (too_short || too_long) {
+        printf("%s: settled on range %d with a %.3gs cycle\n",
+            name, range, period);
+        failures++;
+    }
+}
+
+static void check_sweep(void) {
+    // from well under the smallest range to over the biggest, going up so
+    // each one starts from the last one's range
+    static const double pfs[] = {
+        100, 1e3, 4.7e3, 22e3, 100e3, 330e3, 1e6, 4.7e6, 10e6, 47e6,
+        100e6, 470e6, 1e9, 2.2e9
+    };
+    for (int ci=0; ci<(int)(sizeof(pfs)/sizeof(pfs[0])); ci++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%gpF", pfs[ci]);
+        acq_mode_func_cap(ACQ_EVENT_START, 0);
+        if (settle(pfs[ci], 10000) < 0) {
+            printf("%s: never settled\n", name);
+            failures++;
+            continue;
+        }
+        check_reading(name, pfs[ci]);
+        check_range(name, pfs[ci]);
+        acq_mode_func_cap(ACQ_EVENT_STOP, 0);
+    }
+}
+
+// how long the stepping takes, going all the way up and all the way down
+static void check_stepping(void) {
+    // start on the smallest current
+    acq_mode_func_cap(ACQ_EVENT_START, 0);
+    settle(1e3, 10000);
+    if (range != 0) {
+        printf("1nF: settled on range %d\n", range);
+        failures++;
+    }
+
+    // a 470uF capacitor would take minutes on the smallest current, so
+    // each step up only waits CAP_RANGE_UP_MS for a cycle. then it needs
+    // the minimum gate and a cycle to finish it, and one more to be sure
+    double period = 470e6/pf_per_s(CAP_NUM_RANGES-1);
+    double want = (CAP_NUM_RANGES-1)*(CAP_RANGE_UP_MS+HY_GATE_MS) +
+        2*(CAP_MIN_GATE_MS + period*1000 + HY_GATE_MS);
+    double took = settle(470e6, 10000);
+    if (took < 0 || took > want) {
+        printf("up: took %.0fms, wanted %.0fms\n", took, want);
+        failures++;
+    }
+    check_reading("up", 470e6);
+
+    // and back down, a minimum gate per step
+    want = (CAP_NUM_RANGES+1)*(CAP_MIN_GATE_MS+HY_GATE_MS);
+    took = settle(1e3, 10000);
+    if (took < 0 || took > want) {
+        printf("down: took %.0fms, wanted %.0fms\n", took, want);
+        failures++;
+    }
+    check_reading("down", 1e3);
+    acq_mode_func_cap(ACQ_EVENT_STOP, 0);
+
+    // the range survives restarting the mode, so the same capacitor
+    // doesn't have to step up again
+    acq_mode_func_cap(ACQ_EVENT_START, 0);
+    settle(100e6, 10000);
+    acq_mode_func_cap(ACQ_EVENT_STOP, 0);
+    int old_range = range;
+    acq_mode_func_cap(ACQ_EVENT_START, 0);
+    outs = 0;
+    double start = now;
+    while (outs == 0 && (now-start)*1000 < 10000) {
+        gate(100e6);
+    }
+    period = cycle_s(100e6);
+    want = CAP_MIN_GATE_MS + period*1000 + 2*HY_GATE_MS;
+    took = (now-start)*1000;
+    if (out_range != old_range || took > want) {
+        printf("restart: range %d->%d, took %.0fms, wanted %.0fms\n",
+            old_range, out_range, took, want);
+        failures++;
+    }
+    check_reading("restart", 100e6);
+    acq_mode_func_cap(ACQ_EVENT_STOP, 0);
+}
+
+int main(void) {
+    // the counter is handed over as a 32 bit pointer, which only works if
+    // it's down there
+    static acq_ct_t probe;
+    if ((uintptr_t)&probe > UINT32_MAX) {
+        printf("statics aren't below 4GB, was this built with -no-pie?\n");
+        return 1;
+    }
+
+    check_sweep();
+    check_stepping();
+
+    if (failures) {
+        printf("%d failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
\ No newline at end of file
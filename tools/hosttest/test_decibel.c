@@ -0,0 +1,143 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// sources: measurement/decibel.c system/fixmath.c
+
+// checks the integer logs against libm: fix_log2 over every whole part and
+// a spread of mantissas, and the dBV and dBm readings over the millicounts,
+// decimal points and exponents a volts reading can have
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "measurement/decibel.h"
+
+#include "system/fixmath.h"
+
+// what fixmath.h and decibel.h promise
+#define LOG2_TOLERANCE_LSB (4.0)
+#define DB_TOLERANCE (0.001)
+
+static int failures = 0;
+static double worst_log2 = 0;
+static double worst_db = 0;
+
+static void check_log2(uint64_t v) {
+    double want = log2l((long double)v)*(1 << FIX_LOG_FRAC);
+    double err = fabs(fix_log2(v) - want);
+    if (err > worst_log2) {
+        worst_log2 = err;
+    }
+    if (err > LOG2_TOLERANCE_LSB) {
+        printf("fix_log2(%llu) = %d, should be %.1f\n",
+            (unsigned long long)v, fix_log2(v), want);
+        failures++;
+    }
+}
+
+static void test_log2(void) {
+    // every small value, where the fraction comes from shifting up
+    for (uint64_t v=1; v<(1 << 16); v++) {
+        check_log2(v);
+    }
+    // and a spread of mantissas at every whole part above that
+    for (int whole=16; whole<64; whole++) {
+        uint64_t base = 1ULL << whole;
+        for (uint64_t k=0; k<4096; k++) {
+            check_log2(base + (base >> 12)*k);
+            check_log2(base + (base >> 12)*k + (k*2654435761ULL) % base);
+        }
+        check_log2(base + (base-1));
+    }
+}
+
+static void check_db(int32_t mc, rdg_decimal_t decimal,
+        rdg_exponent_t exponent, db_mode_t mode, uint32_t ohms) {
+    reading_t volts = {mc, 0, 0, RDG_UNIT_VOLTS, exponent, decimal,
+        RDG_KIND_MAIN, 0};
+    reading_t db;
+    db_set_mode(mode);
+    db_set_ref_ohms(ohms);
+    if (!db_from_reading(&volts, &db)) {
+        printf("no dB for %d millicounts\n", mc);
+        failures++;
+        return;
+    }
+    int p = (int)decimal - 7 + 3*((int)exponent - RDG_EXPONENT_NONE);
+    double want = 20*log10(fabs((double)mc)) + 20*p;
+    if (mode == DB_MODE_DBM) {
+        want += 30 - 10*log10(ohms);
+    }
+    double got = db.millicounts/100000.0;
+    double err = fabs(got - want);
+    if (err > worst_db) {
+        worst_db = err;
+    }
+    if (err > DB_TOLERANCE || db.unit != RDG_UNIT_dB ||
+            db.decimal != RDG_DECIMAL_100d00) {
+        printf("%d millicounts dp %d exp %d mode %d ohms %u: %.5fdB, "
+            "should be %.5fdB\n", mc, decimal, exponent, mode, ohms, got,
+            want);
+        failures++;
+    }
+}
+
+static void test_db(void) {
+    static const uint32_t ohms[] = {1, 4, 8, 50, 75, 600, 1000, 10000};
+    for (int dp=RDG_DECIMAL_1d0000; dp<=RDG_DECIMAL_10000; dp++) {
+        for (int exp=RDG_EXPONENT_MICRO; exp<=RDG_EXPONENT_KILO; exp++) {
+            // the volts modes show up to 50000 counts
+            for (int32_t mc=1; mc<50000000; mc += 1 + mc/512) {
+                check_db(mc, (rdg_decimal_t)dp, (rdg_exponent_t)exp,
+                    DB_MODE_DBV, DB_DEFAULT_REF_OHMS);
+                check_db(-mc, (rdg_decimal_t)dp, (rdg_exponent_t)exp,
+                    DB_MODE_DBV, DB_DEFAULT_REF_OHMS);
+            }
+        }
+    }
+    for (int oi=0; oi<sizeof(ohms)/sizeof(ohms[0]); oi++) {
+        for (int32_t mc=1; mc<50000000; mc += 1 + mc/256) {
+            check_db(mc, RDG_DECIMAL_1d0000, RDG_EXPONENT_NONE,
+                DB_MODE_DBM, ohms[oi]);
+        }
+    }
+    // 0 volts has no level, and only volts have one at all
+    reading_t zero = {0, 0, 0, RDG_UNIT_VOLTS, RDG_EXPONENT_NONE,
+        RDG_DECIMAL_1d0000, RDG_KIND_MAIN, 0};
+    reading_t amps = {1000, 0, 0, RDG_UNIT_AMPS, RDG_EXPONENT_NONE,
+        RDG_DECIMAL_1d0000, RDG_KIND_MAIN, 0};
+    reading_t db;
+    db_set_mode(DB_MODE_DBV);
+    if (db_from_reading(&zero, &db) || db_from_reading(&amps, &db)) {
+        printf("dB of 0 volts or of amps\n");
+        failures++;
+    }
+}
+
+int main(void) {
+    test_log2();
+    test_db();
+    printf("worst fix_log2 error %.2f LSB, worst dB error %.5fdB\n",
+        worst_log2, worst_db);
+    if (failures) {
+        printf("%d failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// sources: comms/stream.c
+
+// loopback through a pseudo-terminal: the firmware's stream goes in one
+// end, with the UART failing now and then, and tools/stream_decode.py reads
+// the other. the decoder has to get every frame that was sent, with no
+// sequence gaps and no CRC errors, and the stats have to agree.
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "comms/stream.h"
+
+#include "comms/uart.h"
+#include "measurement/bus.h"
+
+// how many readings are offered
+#define READINGS (300)
+// every this many UART writes fails
+#define FAIL_EVERY (7)
+
+static int failures = 0;
+
+static int pty_fd;
+static int writes = 0;
+static int failed_writes = 0;
+// time_us of every reading that made it into the pseudo-terminal
+static uint32_t sent_times[READINGS];
+static int sent = 0;
+
+void bus_subscribe(bus_sub_t sub, uint8_t decimation, uint8_t depth,
+        job_t job) {
+}
+
+bool bus_get(bus_sub_t sub, reading_t* reading) {
+    return false;
+}
+
+uint16_t uart_tx_free(void) {
+    return UART_TX_BUF_SIZE-1;
+}
+
+// there's always room, but the write fails anyway sometimes, like it would
+// if another job got in between the check and the write
+bool uart_write(const uint8_t* data, uint16_t len) {
+    if (++writes % FAIL_EVERY == 0) {
+        failed_writes++;
+        return false;
+    }
+    // the readings' time_us is at offset 4 in the payload
+    sent_times[sent++] = data[8] | data[9] << 8 | data[10] << 16 |
+        (uint32_t)data[11] << 24;
+    while (len) {
+        ssize_t n = write(pty_fd, data, len);
+        if (n <= 0) {
+            perror("write");
+            exit(1);
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+int main(void) {
+    // don't hang forever if the decoder never answers
+    alarm(30);
+
+    // the decoder mustn't inherit either end, or hanging up won't work
+    pty_fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (pty_fd < 0 || grantpt(pty_fd) || unlockpt(pty_fd)) {
+        perror("posix_openpt");
+        return 1;
+    }
+    // the bytes have to get through untouched, and the decoder opens it
+    // as a plain file. keep this end open so nothing is lost before then
+    int slave_fd = open(ptsname(pty_fd), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    struct termios tio;
+    tcgetattr(slave_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave_fd, TCSANOW, &tio);
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "python3 -u ../stream_decode.py %s 2>&1",
+        ptsname(pty_fd));
+    FILE* decoder = popen(cmd, "r");
+
+    stream_init();
+    for (int ri=0; ri<READINGS; ri++) {
+        reading_t reading = {
+            ri*1000, // millicounts
+            0, // time_ms
+            1000000 + ri, // time_us
+            RDG_UNIT_VOLTS, // unit
+            RDG_EXPONENT_NONE, // exponent
+            RDG_DECIMAL_10000, // decimal point
+            RDG_KIND_MAIN, // kind
+            0 // mean_square
+        };
+        stream_put_reading(&reading);
+    }
+
+    // read back what the decoder made of it
+    char line[256];
+    int got = 0;
+    int crc_errors = -1, lost = -1;
+    while (fgets(line, sizeof(line), decoder)) {
+        uint32_t time_us;
+        if (sscanf(line, "%u,", &time_us) == 1) {
+            if (got >= sent || time_us != sent_times[got]) {
+                printf("reading %d: got time_us %u\n", got, time_us);
+                failures++;
+            }
+            got++;
+            if (got == sent) {
+                // that's everything, so hang up
+                close(pty_fd);
+                close(slave_fd);
+            }
+        } else {
+            sscanf(line, "# crc errors: %d, lost frames: %d",
+                &crc_errors, &lost);
+        }
+    }
+    pclose(decoder);
+
+    stream_stats_t stats;
+    stream_get_stats(&stats);
+    if (got != sent || crc_errors != 0 || lost != 0) {
+        printf("decoded %d of %d readings, %d crc errors, %d lost frames\n",
+            got, sent, crc_errors, lost);
+        failures++;
+    }
+    if (stats.frames_sent != sent || stats.frames_dropped != failed_writes) {
+        printf("stats say %u sent and %u dropped, wanted %d and %d\n",
+            stats.frames_sent, stats.frames_dropped, sent, failed_writes);
+        failures++;
+    }
+    if (failed_writes == 0) {
+        printf("no writes failed, so nothing was tested\n");
+        failures++;
+    }
+
+    if (failures) {
+        printf("%d failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
\ No newline at end of file
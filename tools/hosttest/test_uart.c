@@ -0,0 +1,237 @@
+/*****************************************************************************
+ *  Copyright 2018 Thomas Watson                                             *
+ *                                                                           *
+ *  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/   *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *****************************************************************************/
+
+// sources: comms/uart.c
+// cflags: -DHOSTTEST_PERIPHERALS -Wno-pointer-to-int-cast
+
+// checks the baud rate divider the UART works out, against what the
+// reference manual says BRR should hold, over both oversampling modes, and
+// that rates the clock levels can't make are turned away. the registers
+// are plain memory, so the test plays the DMA and the USART.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "comms/uart.h"
+
+#include "system/job.h"
+#include "system/idle.h"
+#include "system/clock.h"
+
+USART_TypeDef hosttest_usart2;
+DMA_Channel_TypeDef hosttest_dma1_channel6;
+DMA_Channel_TypeDef hosttest_dma1_channel7;
+DMA_TypeDef hosttest_dma1;
+
+static uint32_t pclk;
+static int failures = 0;
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return pclk;
+}
+
+void MX_USART2_UART_Init(void) {
+}
+
+void job_schedule(job_t job) {
+}
+
+void idle_hold(idle_hold_t hold) {
+}
+
+void idle_release(idle_hold_t hold) {
+}
+
+static uint32_t level_hclks[CLOCK_NUM_LEVELS];
+static bool clock_held = false;
+
+uint32_t clock_get_level_hclk(clock_level_t level) {
+    return level_hclks[level];
+}
+
+void clock_request(clock_req_t req) {
+    if (req == CLOCK_REQ_UART) {
+        clock_held = true;
+    }
+}
+
+void clock_release(clock_req_t req) {
+    if (req == CLOCK_REQ_UART) {
+        clock_held = false;
+    }
+}
+
+// the divider BRR gives, in 16ths of a bit time with 16x oversampling or
+// 8ths with 8x. both are pclk/baud
+static uint32_t brr_div(void) {
+    uint32_t brr = USART2->BRR;
+    if (USART2->CR1 & USART_CR1_OVER8) {
+        return (brr >> 4)*8 + (brr & 0x7U);
+    }
+    return brr;
+}
+
+// the last byte at the old rate has gone out
+static void finish_tx(void) {
+    USART2->SR |= USART_SR_TC;
+    USART2_IRQHandler();
+}
+
+// every level runs at clock, so the range is whatever that clock allows
+static void check_baud(uint32_t clock, uint32_t baud) {
+    pclk = clock;
+    for (int li=0; li<CLOCK_NUM_LEVELS; li++) {
+        level_hclks[li] = clock;
+    }
+    if (!uart_set_baud(baud)) {
+        printf("%u baud at %u Hz: refused\n", baud, clock);
+        failures++;
+    }
+    finish_tx();
+    double exact = (double)clock/baud;
+    bool over8 = (USART2->CR1 & USART_CR1_OVER8) != 0;
+    bool should_over8 = exact < 15.5;
+    if (over8 != should_over8 || (over8 && (USART2->BRR & 0x8U)) ||
+            fabs(brr_div() - exact) > 0.5 ||
+            !(USART2->CR1 & USART_CR1_UE)) {
+        printf("%u baud at %u Hz: BRR 0x%X OVER8 %d, divider should be "
+            "%.2f\n", baud, clock, USART2->BRR, over8, exact);
+        failures++;
+    }
+}
+
+// the numbers from the reference manual's examples
+static void check_brr(uint32_t clock, uint32_t baud, uint32_t brr) {
+    check_baud(clock, baud);
+    if (USART2->BRR != brr) {
+        printf("%u baud at %u Hz: BRR 0x%X, should be 0x%X\n",
+            baud, clock, USART2->BRR, brr);
+        failures++;
+    }
+}
+
+// the real levels, 4MHz, 12MHz and 24MHz
+static void set_levels(void) {
+    level_hclks[CLOCK_LEVEL_LOW] = 4000000;
+    level_hclks[CLOCK_LEVEL_NORMAL] = 12000000;
+    level_hclks[CLOCK_LEVEL_HIGH] = 24000000;
+}
+
+// rates have to work at every level, and ones the low level can't make
+// hold the clock up until the UART goes back to a slower one
+static void test_range(void) {
+    set_levels();
+    pclk = 12000000;
+    uint32_t min, max;
+    uart_get_baud_range(&min, &max);
+    if (min != 367 || max != 1500000) {
+        printf("range %u to %u, should be 367 to 1500000\n", min, max);
+        failures++;
+    }
+    uint32_t brr = USART2->BRR;
+    if (uart_set_baud(366) || uart_set_baud(1500001) ||
+            uart_set_baud(UINT32_MAX) || USART2->BRR != brr) {
+        printf("out of range rate taken\n");
+        failures++;
+    }
+    uart_set_baud(500000);
+    finish_tx();
+    if (clock_held) {
+        printf("500000 baud held the clock\n");
+        failures++;
+    }
+    uart_set_baud(921600);
+    finish_tx();
+    if (!clock_held) {
+        printf("921600 baud didn't hold the clock\n");
+        failures++;
+    }
+    uart_set_baud(115200);
+    if (!clock_held) {
+        printf("clock let go before the old rate was done\n");
+        failures++;
+    }
+    finish_tx();
+    if (clock_held) {
+        printf("115200 baud still holding the clock\n");
+        failures++;
+    }
+}
+
+// bytes written before a change go out at the old rate
+static void test_change_waits(void) {
+    set_levels();
+    pclk = 16000000;
+    uart_set_baud(115200);
+    finish_tx();
+    uint32_t old_brr = USART2->BRR;
+    uint8_t data[10] = {0};
+    uart_write(data, sizeof(data));
+    uart_set_baud(921600);
+    if (USART2->BRR != old_brr || uart_get_baud() != 921600) {
+        printf("baud changed before the old bytes went out\n");
+        failures++;
+    }
+    // the DMA has handed the USART everything, but it's still sending
+    DMA1_Channel7_IRQHandler();
+    if (USART2->BRR != old_brr || !(USART2->CR1 & USART_CR1_TCIE)) {
+        printf("baud change not waiting for TX complete\n");
+        failures++;
+    }
+    finish_tx();
+    if (USART2->BRR == old_brr || (USART2->CR1 & USART_CR1_TCIE)) {
+        printf("baud didn't change after TX complete\n");
+        failures++;
+    }
+}
+
+int main(void) {
+    set_levels();
+    pclk = 12000000;
+    uart_init();
+
+    check_brr(12000000, 921600, 0x15);
+    check_brr(12000000, 115200, 0x68);
+    check_brr(16000000, 2000000, 0x10);
+    check_brr(32000000, 3000000, 0x13);
+
+    static const uint32_t clocks[] = {
+        2097152, 4194304, 8000000, 12000000, 16000000, 24000000, 32000000
+    };
+    static const uint32_t bauds[] = {
+        1200, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600,
+        1000000, 1500000, 2000000, 3000000, 4000000
+    };
+    for (unsigned ci=0; ci<sizeof(clocks)/sizeof(clocks[0]); ci++) {
+        for (unsigned bi=0; bi<sizeof(bauds)/sizeof(bauds[0]); bi++) {
+            if (bauds[bi] <= clocks[ci]/8) {
+                check_baud(clocks[ci], bauds[bi]);
+            }
+        }
+    }
+
+    test_range();
+    test_change_waits();
+
+    if (failures) {
+        printf("%d failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+#  Copyright 2018 Thomas Watson
+#
+#  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+
+# show where the RAM goes and how deep the stack can get, from a build
+# (see 88mph/system/stack.h for the runtime side, the "mem" command)
+# the RAM map is the size of every variable, added up by the file it's
+# defined in. the stack report adds up the frames along the deepest call
+# chain from each interrupt handler, then stacks the worst handler at each
+# priority level on top of main, since that's what can happen when they all
+# interrupt each other.
+
+# usage: mem_report.py [-p PREFIX] ELF [SU_DIR]
+# ELF is the built .elf, like Debug/EEVBlog.elf. the compiler writes a .su
+# file next to each object (the project builds with -fstack-usage), and
+# they're looked for under SU_DIR, which is the ELF's directory by default.
+# PREFIX is the toolchain prefix, arm-none-eabi- by default.
+
+# frame sizes are the larger of what the .su files say and what the
+# function's prologue actually pushes, because LTO inlines things after the
+# .su files are written. calls through function pointers (the work queues,
+# the mode tables, the console commands) can't be followed directly, so the
+# "indirect" column assumes they can go to any function whose address is
+# stored somewhere. that's a safe upper bound but usually a pessimistic one.
+
+import os
+import re
+import subprocess
+import sys
+
+# the interrupts that run code, with their priorities. mirrors job_init in
+# 88mph/system/job.c and MX_DMA_Init in main.c
+HANDLERS = [
+    ("SysTick_Handler", 0),
+    ("DMA2_Channel4_IRQHandler", 0),
+    ("TIM6_IRQHandler", 1),
+    ("DMA1_Channel7_IRQHandler", 2),
+    ("EXTI3_IRQHandler", 5),
+    ("UART4_IRQHandler", 6),
+    ("USB_LP_IRQHandler", 7),
+    ("UART5_IRQHandler", 8),
+    ("DMA1_Channel6_IRQHandler", 9),
+    ("USART2_IRQHandler", 9),
+    ("RTC_Alarm_IRQHandler", 9),
+    ("DMA1_Channel1_IRQHandler", 9),
+    ("USB_HP_IRQHandler", 10),
+    ("SPI3_IRQHandler", 14),
+]
+
+RAM_START = 0x20000000
+
+# the CPU pushes 8 registers when it takes an interrupt, and maybe another
+# word to keep the stack 8 byte aligned
+EXCEPTION_FRAME = 36
+
+def run(prefix, tool, *args):
+    return subprocess.run([prefix+tool] + list(args), check=True,
+        stdout=subprocess.PIPE, universal_newlines=True).stdout
+
+# shorten a source path to something readable
+def module_name(path):
+    path = path.replace("\\", "/")
+    for top in ("88mph/", "Src/", "Drivers/", "Middlewares/"):
+        at = path.rfind(top)
+        if at >= 0:
+            return path[at:]
+    return os.path.basename(path)
+
+def read_symbols(prefix, elf):
+    symbols = []
+    out = run(prefix, "nm", "-S", "-l", "--defined-only", elf)
+    for line in out.splitlines():
+        parts = line.split("\t")
+        fields = parts[0].split()
+        if len(fields) == 4:
+            addr, size, kind, name = fields
+            size = int(size, 16)
+        elif len(fields) == 3:
+            addr, kind, name = fields
+            size = 0
+        else:
+            continue
+        where = None
+        if len(parts) > 1:
+            where = module_name(parts[1].rsplit(":", 1)[0])
+        symbols.append((int(addr, 16), size, kind, name, where))
+    return symbols
+
+def ram_report(symbols):
+    linker = {}
+    modules = {}
+    biggest = []
+    for addr, size, kind, name, where in symbols:
+        linker[name] = addr
+        # HOT_FUNC code gets copied into RAM along with the data
+        if kind in "tT" and addr >= RAM_START:
+            kind = "d"
+        if kind not in "bBdD" or size == 0:
+            continue
+        if where is None:
+            where = "(no debug info)"
+        data, bss = modules.get(where, (0, 0))
+        if kind in "dD":
+            data += size
+        else:
+            bss += size
+        modules[where] = (data, bss)
+        biggest.append((size, name, where))
+
+    print("RAM by module")
+    print("{:>7} {:>7} {:>7}  {}".format("data", "bss", "total", "module"))
+    total_data = total_bss = 0
+    for where, (data, bss) in sorted(modules.items(),
+            key=lambda m: -(m[1][0]+m[1][1])):
+        print("{:7} {:7} {:7}  {}".format(data, bss, data+bss, where))
+        total_data += data
+        total_bss += bss
+    print("{:7} {:7} {:7}  total".format(total_data, total_bss,
+        total_data+total_bss))
+
+    print()
+    print("biggest variables")
+    for size, name, where in sorted(biggest, reverse=True)[:12]:
+        print("{:7}  {} ({})".format(size, name, where))
+
+    print()
+    try:
+        print("linker: data {} bss {} heap {} stack {}".format(
+            linker["_edata"]-linker["_sdata"],
+            linker["_ebss"]-linker["_sbss"],
+            linker["_Min_Heap_Size"],
+            linker["_estack"]-linker["_sstack"]))
+    except KeyError as e:
+        print("linker: no symbol {}".format(e))
+    return linker
+
+def read_su(su_dir):
+    frames = {}
+    for root, dirs, files in os.walk(su_dir):
+        for fn in files:
+            if not fn.endswith(".su"):
+                continue
+            with open(os.path.join(root, fn)) as f:
+                for line in f:
+                    parts = line.rstrip("\n").split("\t")
+                    if len(parts) < 3:
+                        continue
+                    name = parts[0].rsplit(":", 1)[-1]
+                    size = int(parts[1])
+                    dynamic = "dynamic" in parts[2]
+                    old_size, old_dynamic = frames.get(name, (0, False))
+                    frames[name] = (max(size, old_size),
+                        dynamic or old_dynamic)
+    return frames
+
+re_func = re.compile(r"^([0-9a-f]+) <([^>]+)>:$")
+re_insn = re.compile(r"^\s*([0-9a-f]+):\s+(\S+)\s*(.*)$")
+re_target = re.compile(r"^([0-9a-f]+) <([^>+]+)>$")
+re_imm = re.compile(r"#(\d+)")
+
+# count the registers in a push's {list}, which might have ranges
+def count_regs(operands):
+    inside = operands[operands.find("{")+1:operands.find("}")]
+    count = 0
+    for reg in inside.split(","):
+        reg = reg.strip()
+        if "-" in reg:
+            lo, hi = reg.split("-")
+            count += int(hi.strip()[1:]) - int(lo.strip()[1:]) + 1
+        elif reg:
+            count += 1
+    return count
+
+class Function:
+    def __init__(self, name, addr):
+        self.name = name
+        self.addr = addr
+        self.prologue = 0
+        self.calls = set()
+        self.indirect = False
+        self.insns = 0
+
+def disassemble(prefix, elf):
+    funcs = {}
+    words = set()
+    func = None
+    out = run(prefix, "objdump", "-d", "--no-show-raw-insn", elf)
+    for line in out.splitlines():
+        m = re_func.match(line)
+        if m:
+            func = Function(m.group(2), int(m.group(1), 16))
+            funcs[func.name] = func
+            # the frame is set up in the first few instructions
+            in_prologue = True
+            continue
+        m = re_insn.match(line)
+        if not m or func is None:
+            continue
+        insn, operands = m.group(2), m.group(3).split(";")[0].strip()
+        if insn == ".word":
+            words.add(int(operands, 16))
+            continue
+        func.insns += 1
+        if in_prologue and func.insns > 16:
+            in_prologue = False
+        if in_prologue:
+            if insn in ("push", "push.w") or (insn.startswith("stmdb") and
+                    operands.startswith("sp!")):
+                func.prologue += 4*count_regs(operands)
+                continue
+            elif insn.split(".")[0] in ("sub", "subw") and \
+                    operands.startswith("sp,"):
+                imm = re_imm.search(operands)
+                if imm:
+                    func.prologue += int(imm.group(1))
+                continue
+        if not insn.startswith("b") or insn.startswith("bi") or \
+                insn.startswith("bf"):
+            continue
+        # only branches from here on
+        in_prologue = False
+        target = re_target.match(operands)
+        if target:
+            if target.group(2) != func.name:
+                # a call, or a tail call that reuses our frame. counting
+                # it as a call is a little pessimistic but simple
+                func.calls.add(target.group(2))
+        elif insn.startswith("blx") or (insn.startswith("bx") and
+                operands != "lr"):
+            func.indirect = True
+    return funcs, words
+
+def read_data_words(prefix, elf):
+    words = set()
+    try:
+        out = run(prefix, "objdump", "-s", "-j", ".rodata", "-j", ".data",
+            elf)
+    except subprocess.CalledProcessError:
+        return words
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) < 2 or not re.match(r"^[0-9a-f]{8}$", fields[1]):
+            continue
+        for group in fields[1:5]:
+            if len(group) != 8 or not re.match(r"^[0-9a-f]+$", group):
+                break
+            words.add(int.from_bytes(bytes.fromhex(group), "little"))
+    return words
+
+class StackCalc:
+    def __init__(self, funcs, frames, pointed_to, indirect):
+        self.funcs = funcs
+        self.frames = frames
+        self.pointed_to = pointed_to
+        self.indirect = indirect
+        self.memo = {}
+        self.path = []
+        self.recursive = set()
+        self.dynamic = set()
+        self.unknown = set()
+
+    def frame(self, name):
+        su, dynamic = self.frames.get(name.split(".")[0], (0, False))
+        if dynamic:
+            self.dynamic.add(name)
+        func = self.funcs.get(name)
+        return max(su, func.prologue if func else 0)
+
+    # returns (bytes, deepest call chain, whether anything under it calls
+    # through a pointer)
+    def worst(self, name):
+        if name in self.memo:
+            return self.memo[name]
+        if name in self.path:
+            self.recursive.add(name)
+            return 0, [name+" (recursion)"], False
+        func = self.funcs.get(name)
+        if func is None:
+            self.unknown.add(name)
+            return 0, [name+" (?)"], False
+        self.path.append(name)
+        callees = set(func.calls)
+        if self.indirect and func.indirect:
+            callees |= self.pointed_to
+        best, best_chain = 0, []
+        has_indirect = func.indirect
+        for callee in sorted(callees):
+            depth, chain, callee_indirect = self.worst(callee)
+            has_indirect = has_indirect or callee_indirect
+            if depth > best:
+                best, best_chain = depth, chain
+        self.path.pop()
+        result = (self.frame(name) + best, [name] + best_chain, has_indirect)
+        self.memo[name] = result
+        return result
+
+def stack_report(funcs, frames, pointed_to):
+    direct = StackCalc(funcs, frames, pointed_to, False)
+    indirect = StackCalc(funcs, frames, pointed_to, True)
+    print("worst case stack in bytes, including the interrupt's frame")
+    print("{:>4} {:>7} {:>8}  {}".format("prio", "direct", "indirect",
+        "handler"))
+    roots = [("main", None)] + HANDLERS
+    worst_direct = {}
+    worst_indirect = {}
+    chains = []
+    for name, prio in roots:
+        if name not in funcs:
+            print("{:>4} {:>7} {:>8}  {} (not in the build)".format(
+                "" if prio is None else prio, "", "", name))
+            continue
+        extra = 0 if prio is None else EXCEPTION_FRAME
+        d, d_chain, has_indirect = direct.worst(name)
+        i = indirect.worst(name)[0]
+        d += extra
+        i += extra
+        print("{:>4} {:7} {:8}  {}{}".format("" if prio is None else prio,
+            d, i, name, " *" if has_indirect else ""))
+        worst_direct[prio] = max(worst_direct.get(prio, 0), d)
+        worst_indirect[prio] = max(worst_indirect.get(prio, 0), i)
+        chains.append((name, d_chain))
+
+    print()
+    print("everything at once: direct {} indirect {}".format(
+        sum(worst_direct.values()), sum(worst_indirect.values())))
+    print("(* means a function pointer call was left out of the direct "
+        "number)")
+
+    print()
+    print("deepest direct call chains")
+    for name, chain in chains:
+        print("{}: {}".format(name, " > ".join(
+            "{}({})".format(c, direct.frame(c)) for c in chain)))
+
+    for what, names in (("recursion", direct.recursive | indirect.recursive),
+            ("variable sized frames", direct.dynamic | indirect.dynamic),
+            ("calls to unknown functions", direct.unknown)):
+        if names:
+            print()
+            print("{}: {}".format(what, " ".join(sorted(names))))
+
+def main():
+    args = sys.argv[1:]
+    prefix = "arm-none-eabi-"
+    if len(args) >= 2 and args[0] == "-p":
+        prefix = args[1]
+        args = args[2:]
+    if len(args) < 1:
+        print("usage: mem_report.py [-p PREFIX] ELF [SU_DIR]",
+            file=sys.stderr)
+        sys.exit(1)
+    elf = args[0]
+    su_dir = args[1] if len(args) > 1 else os.path.dirname(elf) or "."
+
+    ram_report(read_symbols(prefix, elf))
+    print()
+
+    frames = read_su(su_dir)
+    if not frames:
+        print("no .su files in {}, using prologues only".format(su_dir))
+    funcs, words = disassemble(prefix, elf)
+    words |= read_data_words(prefix, elf)
+    # thumb function pointers have the low bit set
+    pointed_to = set(f.name for f in funcs.values() if f.addr|1 in words)
+    stack_report(funcs, frames, pointed_to)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+#  Copyright 2018 Thomas Watson
+#
+#  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+# decode the binary reading stream the meter sends out of its UART
+# (see 88mph/comms/stream.h for the frame format) and print it as CSV
+
+# usage: stream_decode.py PORT [BAUD]
+# PORT can be a serial port (needs pyserial), or a file or pseudo-terminal
+# with data in it. use - for stdin.
+
+import struct
+import sys
+
+SYNC = 0x88
+
+FRAME_READING = 1
+FRAME_CONSOLE = 2
+FRAME_DUMP = 3
+
+DUMP_CAPTURE = 1
+DUMP_TRACE = 2
+
+UNITS = ["", "A", "%", "F", "Hz", "s", "Ohm", "V", "degC", "degF", "dB"]
+EXPONENTS = [-9, -6, -3, 0, 3, 6]
+KINDS = ["main", "sub"]
+
+def crc16(data, crc=0xFFFF):
+    # CRC-16/CCITT-FALSE
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+            else:
+                crc = (crc << 1) & 0xFFFF
+    return crc
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.last_seq = None
+        self.crc_errors = 0
+        self.lost_frames = 0
+
+    # feed in some bytes, get back a list of (type, seq, payload)
+    def feed(self, data):
+        self.buf.extend(data)
+        frames = []
+        while True:
+            start = self.buf.find(bytes([SYNC]))
+            if start < 0:
+                self.buf.clear()
+                break
+            del self.buf[:start]
+            if len(self.buf) < 4:
+                break
+            length = self.buf[3]
+            if len(self.buf) < length+6:
+                break
+            frame = bytes(self.buf[:length+6])
+            crc, = struct.unpack("<H", frame[-2:])
+            if crc16(frame[1:-2]) != crc:
+                # that wasn't really a frame start, so resync on the
+                # next sync byte
+                self.crc_errors += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:length+6]
+            ftype, seq = frame[1], frame[2]
+            if self.last_seq is not None:
+                self.lost_frames += (seq - self.last_seq - 1) & 0xFF
+            self.last_seq = seq
+            frames.append((ftype, seq, frame[4:-2]))
+        return frames
+
+def decode_reading(payload):
+    millicounts, time_us, unit, exponent, decimal, kind, decimation = \
+        struct.unpack("<iIBBBBB", payload[:13])
+    # millicounts are thousandths of the least significant digit, and the
+    # decimal point is 4-decimal digits from the right of 5 digits
+    value = millicounts/1000 * 10**(decimal-4) * 10**EXPONENTS[exponent]
+    return time_us, value, UNITS[unit], KINDS[kind], 1 << decimation
+
+# returns (source id, marker, [(record index, record bytes)])
+def decode_dump(payload):
+    src, size, index, count, marker = struct.unpack("<BBIII", payload[:14])
+    records = payload[14:]
+    return src, marker, [(index+i, records[i*size:(i+1)*size])
+        for i in range(len(records)//size)]
+
+def open_port(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    try:
+        import serial
+        return serial.Serial(path, baud, timeout=0.1)
+    except (ImportError, ValueError, OSError):
+        return open(path, "rb", buffering=0)
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: stream_decode.py PORT [BAUD]", file=sys.stderr)
+        sys.exit(1)
+    port = open_port(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2
+        else 115200)
+    dec = Decoder()
+    print("time_us,value,unit,kind,decimation")
+    while True:
+        try:
+            data = port.read(256)
+        except OSError:
+            # the other end of a pseudo-terminal hung up
+            break
+        if not data:
+            if not hasattr(port, "in_waiting"):
+                break # end of file
+            continue
+        for ftype, seq, payload in dec.feed(data):
+            if ftype == FRAME_READING:
+                print("{},{:.6g},{},{},{}".format(*decode_reading(payload)))
+            elif ftype == FRAME_CONSOLE:
+                print("# " + payload.decode("ascii", "replace"))
+            elif ftype == FRAME_DUMP:
+                src, marker, records = decode_dump(payload)
+                for index, record in records:
+                    if src == DUMP_CAPTURE:
+                        # same as CAPTURE.CSV on the SD card
+                        ad1, time_us = struct.unpack("<iI", record)
+                        print("# capture {},{},{}".format(
+                            index-marker, time_us, ad1))
+                    elif src == DUMP_TRACE:
+                        # same as TRACE.CSV, see trace2chrome.py
+                        time_us, event, arg = struct.unpack("<IHH", record)
+                        print("# trace {},{},{}".format(time_us, event, arg))
+    print("# crc errors: {}, lost frames: {}".format(
+        dec.crc_errors, dec.lost_frames), file=sys.stderr)
+
+if __name__ == "__main__":
+    main()
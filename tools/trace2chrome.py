@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+#  Copyright 2018 Thomas Watson
+#
+#  This file is a part of 88mph: https://github.com/tpwrules/121gw-88mph/
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+# turn a trace dump (see 88mph/system/trace.h) into JSON for chrome://tracing
+# or https://ui.perfetto.dev. each job gets its own track, ordered by
+# priority, so you can see which ones interrupted which.
+
+# usage: trace2chrome.py TRACE.CSV [OUT.JSON]
+# the input is either TRACE.CSV from the SD card, or the output of
+# stream_decode.py after "trace uart", which has the same lines behind
+# "# trace ". use - for stdin. the JSON goes to stdout if OUT isn't given.
+
+import json
+import sys
+
+# trace_id_t
+JOB_BEGIN = 1
+JOB_END = 2
+WORK_POST = 3
+BUS_PUBLISH = 4
+BUS_GET = 5
+ACQ_PUT = 6
+HY_BEGIN = 7
+HY_END = 8
+ACQ_MODE = 9
+MEAS_MODE = 10
+CLOCK = 11
+SLEEP = 12
+WAKE = 13
+MARK = 14
+BEEP = 15
+
+# job_t is the interrupt number. (name, priority) from the table in job.c
+JOBS = {
+    43: ("10ms", 1),
+    9: ("acquisition", 5),
+    48: ("work_hi", 6),
+    20: ("measurement", 7),
+    49: ("work", 8),
+    19: ("system", 10),
+    47: ("work_lo", 14),
+}
+# the main loop is below all of them
+MAIN_TID = 100
+
+INSTANTS = {
+    WORK_POST: ("work post", "level", ["hi", "normal", "lo"]),
+    BUS_PUBLISH: ("bus publish", "seq", None),
+    BUS_GET: ("bus get", "sub", ["disp", "bar", "stream", "log"]),
+    ACQ_PUT: ("acq put", "depth", None),
+    ACQ_MODE: ("acq mode", "mode", None),
+    MEAS_MODE: ("meas mode", "mode", ["off", "vdc", "vac", "aac", "hz", "vdual", "cont", "temp", "cap"]),
+    CLOCK: ("clock", "level", ["low", "normal", "high"]),
+    MARK: ("mark", "arg", None),
+    BEEP: ("beep", "latency_us", None),
+}
+SLEEP_STATES = ["run", "sleep", "tickless", "stop"]
+
+def read_events(f):
+    events = []
+    for line in f:
+        line = line.strip()
+        if line.startswith("# trace "):
+            line = line[len("# trace "):]
+        elif not line or not line[0].isdigit():
+            # the CSV header, or something else stream_decode printed
+            continue
+        time_us, event, arg = (int(x) for x in line.split(","))
+        events.append((time_us, event, arg))
+    return events
+
+def convert(events):
+    out = []
+    for job, (name, prio) in JOBS.items():
+        out.append({"ph": "M", "pid": 1, "tid": prio, "name": "thread_name",
+            "args": {"name": "{} ({})".format(name, prio)}})
+        out.append({"ph": "M", "pid": 1, "tid": prio,
+            "name": "thread_sort_index", "args": {"sort_index": prio}})
+    out.append({"ph": "M", "pid": 1, "tid": MAIN_TID, "name": "thread_name",
+        "args": {"name": "main loop"}})
+    out.append({"ph": "M", "pid": 1, "tid": MAIN_TID,
+        "name": "thread_sort_index", "args": {"sort_index": MAIN_TID}})
+
+    # the timer wraps every 71 minutes, so unwrap it
+    base = 0
+    last = None
+    # interrupts nest, so whatever began last is what's running now
+    running = []
+    for time_us, event, arg in events:
+        if last is not None and time_us < last:
+            base += 1 << 32
+        last = time_us
+        ts = base + time_us
+        tid = JOBS[running[-1]][1] if running else MAIN_TID
+
+        if event == JOB_BEGIN and arg in JOBS:
+            running.append(arg)
+            out.append({"ph": "B", "pid": 1, "tid": JOBS[arg][1],
+                "ts": ts, "name": JOBS[arg][0]})
+        elif event == JOB_END and arg in JOBS:
+            # the ring might have started in the middle of a job
+            if arg in running:
+                while running.pop() != arg:
+                    pass
+            out.append({"ph": "E", "pid": 1, "tid": JOBS[arg][1], "ts": ts})
+        elif event == HY_BEGIN:
+            what = "hy write" if arg & 0x8000 else "hy read"
+            out.append({"ph": "B", "pid": 1, "tid": tid, "ts": ts,
+                "name": what, "args": {"reg": (arg >> 8) & 0x7F,
+                "count": arg & 0xFF}})
+        elif event == HY_END:
+            out.append({"ph": "E", "pid": 1, "tid": tid, "ts": ts})
+        elif event == SLEEP:
+            state = SLEEP_STATES[arg] if arg < len(SLEEP_STATES) else arg
+            out.append({"ph": "B", "pid": 1, "tid": MAIN_TID, "ts": ts,
+                "name": state})
+        elif event == WAKE:
+            out.append({"ph": "E", "pid": 1, "tid": MAIN_TID, "ts": ts})
+        elif event in INSTANTS:
+            name, argname, names = INSTANTS[event]
+            if event == ACQ_MODE:
+                value = "{}.{}".format(arg >> 8, arg & 0xFF)
+            elif names is not None and arg < len(names):
+                value = names[arg]
+            else:
+                value = arg
+            out.append({"ph": "i", "s": "t", "pid": 1, "tid": tid, "ts": ts,
+                "name": name, "args": {argname: value}})
+        else:
+            out.append({"ph": "i", "s": "t", "pid": 1, "tid": tid, "ts": ts,
+                "name": "event {}".format(event), "args": {"arg": arg}})
+    return out
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: trace2chrome.py TRACE.CSV [OUT.JSON]", file=sys.stderr)
+        sys.exit(1)
+    if sys.argv[1] == "-":
+        events = read_events(sys.stdin)
+    else:
+        with open(sys.argv[1]) as f:
+            events = read_events(f)
+    trace = {"traceEvents": convert(events), "displayTimeUnit": "ms"}
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+    print("{} events".format(len(events)), file=sys.stderr)
+
+if __name__ == "__main__":
+    main()